@@ -19,6 +19,10 @@ void busDir(uint32_t mask, uint8_t mode);
 
 inline void ST7789::spi_begin(void)
 {
+  if (_offscreen)
+    return;
+  if (_dmaActive)
+    dmaWait(); // the registers belong to the DMA transfer until it is done
   if (locked)
   {
     locked = false;
@@ -28,6 +32,8 @@ inline void ST7789::spi_begin(void)
 
 inline void ST7789::spi_end(void)
 {
+  if (_offscreen)
+    return;
   if (!inTransaction)
   {
     if (!locked)
@@ -767,10 +773,16 @@ void ST7789::pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, const uint1
 
 /***************************************************************************************
 ** Function name:           pushImage
-** Description:             plot 8 bit image or sprite using a line buffer
+** Description:             plot 8 or 1 bit image or sprite using a line buffer
 ***************************************************************************************/
 void ST7789::pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, uint8_t *data, bool bpp8)
 {
+  if (bpp8)
+  {
+    pushImage(x, y, w, h, (const uint8_t *)data, palette_332());
+    return;
+  }
+
   if ((x >= (int32_t)_width) || (y >= (int32_t)_height))
     return;
 
@@ -808,86 +820,43 @@ void ST7789::pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, uint8_t *da
   // Line buffer makes plotting faster
   uint16_t lineBuf[dw];
 
-  if (bpp8)
+  while (dh--)
   {
-    uint8_t blue[] = {0, 11, 21, 31}; // blue 2 to 5 bit colour lookup table
-
-    _lastColor = -1; // Set to illegal value
-
-    // Used to store last shifted colour
-    uint8_t msbColor = 0;
-    uint8_t lsbColor = 0;
+    w = (w + 7) & 0xFFF8;
 
-    data += dx + dy * w;
-    while (dh--)
+    int32_t len = dw;
+    uint8_t *ptr = data;
+    uint8_t *linePtr = (uint8_t *)lineBuf;
+    uint8_t bits = 8;
+    while (len > 0)
     {
-      uint32_t len = dw;
-      uint8_t *ptr = data;
-      uint8_t *linePtr = (uint8_t *)lineBuf;
-
-      while (len--)
+      if (len < 8)
+        bits = len;
+      uint32_t xp = dx;
+      for (uint16_t i = 0; i < bits; i++)
       {
-        uint32_t color = *ptr++;
-
-        // Shifts are slow so check if colour has changed first
-        if (color != _lastColor)
+        uint8_t col = (ptr[(xp + dy * w) >> 3] << (xp & 0x7)) & 0x80;
+        if (col)
         {
-          //          =====Green=====     ===============Red==============
-          msbColor = (color & 0x1C) >> 2 | (color & 0xC0) >> 3 | (color & 0xE0);
-          //          =====Green=====    =======Blue======
-          lsbColor = (color & 0x1C) << 3 | blue[color & 0x03];
-          _lastColor = color;
+          *linePtr++ = bitmap_fg >> 8;
+          *linePtr++ = (uint8_t)bitmap_fg;
         }
-
-        *linePtr++ = msbColor;
-        *linePtr++ = lsbColor;
-      }
-
-      pushColors(lineBuf, dw, false);
-
-      data += w;
-    }
-  }
-  else
-  {
-    while (dh--)
-    {
-      w = (w + 7) & 0xFFF8;
-
-      int32_t len = dw;
-      uint8_t *ptr = data;
-      uint8_t *linePtr = (uint8_t *)lineBuf;
-      uint8_t bits = 8;
-      while (len > 0)
-      {
-        if (len < 8)
-          bits = len;
-        uint32_t xp = dx;
-        for (uint16_t i = 0; i < bits; i++)
+        else
         {
-          uint8_t col = (ptr[(xp + dy * w) >> 3] << (xp & 0x7)) & 0x80;
-          if (col)
-          {
-            *linePtr++ = bitmap_fg >> 8;
-            *linePtr++ = (uint8_t)bitmap_fg;
-          }
-          else
-          {
-            *linePtr++ = bitmap_bg >> 8;
-            *linePtr++ = (uint8_t)bitmap_bg;
-          }
-          //if (col) drawPixel((dw-len)+xp,h-dh,bitmap_fg);
-          //else     drawPixel((dw-len)+xp,h-dh,bitmap_bg);
-          xp++;
+          *linePtr++ = bitmap_bg >> 8;
+          *linePtr++ = (uint8_t)bitmap_bg;
         }
-        *ptr++;
-        len -= 8;
+        //if (col) drawPixel((dw-len)+xp,h-dh,bitmap_fg);
+        //else     drawPixel((dw-len)+xp,h-dh,bitmap_bg);
+        xp++;
       }
+      *ptr++;
+      len -= 8;
+    }
 
-      pushColors(lineBuf, dw, false);
+    pushColors(lineBuf, dw, false);
 
-      dy++;
-    }
+    dy++;
   }
 
   CS_H;
@@ -943,21 +912,12 @@ void ST7789::pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, uint8_t *da
   {
     data += dx + dy * w;
 
-    uint8_t blue[] = {0, 11, 21, 31}; // blue 2 to 5 bit colour lookup table
-
-    _lastColor = -1; // Set to illegal value
-
-    // Used to store last shifted colour
-    uint8_t msbColor = 0;
-    uint8_t lsbColor = 0;
-
-    //int32_t spx = x, spy = y;
+    const uint16_t *lut = palette_332()->lut; // in bus byte order
 
     while (dh--)
     {
       int32_t len = dw;
       uint8_t *ptr = data;
-      uint8_t *linePtr = (uint8_t *)lineBuf;
 
       int32_t px = x;
       boolean move = true;
@@ -972,20 +932,7 @@ void ST7789::pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, uint8_t *da
             move = false;
             setAddrWindow(px, y, xe, ye);
           }
-          uint8_t color = *ptr;
-
-          // Shifts are slow so check if colour has changed first
-          if (color != _lastColor)
-          {
-            //          =====Green=====     ===============Red==============
-            msbColor = (color & 0x1C) >> 2 | (color & 0xC0) >> 3 | (color & 0xE0);
-            //          =====Green=====    =======Blue======
-            lsbColor = (color & 0x1C) << 3 | blue[color & 0x03];
-            _lastColor = color;
-          }
-          *linePtr++ = msbColor;
-          *linePtr++ = lsbColor;
-          np++;
+          lineBuf[np++] = lut[*ptr];
         }
         else
         {
@@ -993,7 +940,6 @@ void ST7789::pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, uint8_t *da
           if (np)
           {
             pushColors(lineBuf, np, false);
-            linePtr = (uint8_t *)lineBuf;
             np = 0;
           }
         }
@@ -1065,6 +1011,66 @@ void ST7789::pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, uint8_t *da
   spi_end();
 }
 
+/***************************************************************************************
+** Function name:           pushImage
+** Description:             plot 8 or 4 bit indexed image through a palette
+***************************************************************************************/
+void ST7789::pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, const uint8_t *data, const palette_t *palette)
+{
+  if ((x >= (int32_t)_width) || (y >= (int32_t)_height))
+    return;
+
+  int32_t dx = 0;
+  int32_t dy = 0;
+  int32_t dw = w;
+  int32_t dh = h;
+
+  if (x < 0)
+  {
+    dw += x;
+    dx = -x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    dh += y;
+    dy = -y;
+    y = 0;
+  }
+
+  if ((x + w) > _width)
+    dw = _width - x;
+  if ((y + h) > _height)
+    dh = _height - y;
+
+  if (dw < 1 || dh < 1)
+    return;
+
+  spi_begin();
+  inTransaction = true;
+
+  setAddrWindow(x, y, x + dw - 1, y + dh - 1); // Sets CS low and sent RAMWR
+
+  uint16_t line[PALETTE_LINE_PIXELS];
+  uint32_t stride = palette_stride(palette, w);
+  data += dy * stride;
+  while (dh--)
+  {
+    for (int32_t k = 0; k < dw; k += PALETTE_LINE_PIXELS)
+    {
+      int32_t n = (dw - k < PALETTE_LINE_PIXELS) ? dw - k : PALETTE_LINE_PIXELS;
+      palette_line(palette, data, dx + k, n, line);
+      pushColors(line, n, false);
+    }
+    data += stride;
+  }
+
+  CS_H;
+
+  inTransaction = false;
+  spi_end();
+}
+
 /***************************************************************************************
 ** Function name:           setSwapBytes
 ** Description:             Used by 16 bit pushImage() to swap byte order in colours
@@ -1186,80 +1192,40 @@ void ST7789::drawCircleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t cornern
 ** Function name:           fillCircle
 ** Description:             draw a filled circle
 ***************************************************************************************/
-// Optimised midpoint circle algorithm, changed to horizontal lines (faster in sprites)
+// Optimised midpoint circle algorithm, sent as one window per run of equal scanlines
 void ST7789::fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color)
 {
-  int32_t x = 0;
-  int32_t dx = 1;
-  int32_t dy = r + r;
-  int32_t p = -(r >> 1);
-
-  spi_begin();
-  inTransaction = true;
-
-  drawFastHLine(x0 - r, y0, dy + 1, color);
-
-  while (x < r)
+  raster_spans_t spans;
+  for (int32_t top = y0 - r; spanBegin(&spans, top, y0 + r); top = spans.top + spans.rows)
   {
-
-    if (p >= 0)
-    {
-      dy -= 2;
-      p -= dy;
-      r--;
-    }
-
-    dx += 2;
-    p += dx;
-
-    x++;
-
-    drawFastHLine(x0 - r, y0 + x, 2 * r + 1, color);
-    drawFastHLine(x0 - r, y0 - x, 2 * r + 1, color);
-    drawFastHLine(x0 - x, y0 + r, 2 * x + 1, color);
-    drawFastHLine(x0 - x, y0 - r, 2 * x + 1, color);
+    raster_fill_circle(raster_spans_rect, &spans, x0, y0, r);
+    spanFill(&spans, color);
   }
+}
 
-  inTransaction = false;
-  spi_end();
+// Whole bounding box rows in one window, the corners outside the circle in "bg"
+void ST7789::fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color, uint32_t bg)
+{
+  raster_spans_t spans;
+  for (int32_t top = y0 - r; spanBegin(&spans, top, y0 + r); top = spans.top + spans.rows)
+  {
+    raster_fill_circle(raster_spans_rect, &spans, x0, y0, r);
+    spanFill(&spans, color, bg);
+  }
 }
 
 /***************************************************************************************
 ** Function name:           fillCircleHelper
 ** Description:             Support function for filled circle drawing
 ***************************************************************************************/
-// Used to support drawing roundrects, changed to horizontal lines (faster in sprites)
+// Used to support drawing roundrects
 void ST7789::fillCircleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t cornername, int32_t delta, uint32_t color)
 {
-  int32_t f = 1 - r;
-  int32_t ddF_x = 1;
-  int32_t ddF_y = -r - r;
-  int32_t y = 0;
-
-  delta++;
-  while (y < r)
+  raster_spans_t spans;
+  for (int32_t top = y0 - r; spanBegin(&spans, top, y0 + r); top = spans.top + spans.rows)
   {
-    if (f >= 0)
-    {
-      r--;
-      ddF_y += 2;
-      f += ddF_y;
-    }
-    y++;
-    //x++;
-    ddF_x += 2;
-    f += ddF_x;
-
-    if (cornername & 0x1)
-    {
-      drawFastHLine(x0 - r, y0 + y, r + r + delta, color);
-      drawFastHLine(x0 - y, y0 + r, y + y + delta, color);
-    }
-    if (cornername & 0x2)
-    {
-      drawFastHLine(x0 - r, y0 - y, r + r + delta, color); // 11995, 1090
-      drawFastHLine(x0 - y, y0 - r, y + y + delta, color);
-    }
+    raster_fill_circle_helper(raster_spans_rect, &spans, x0, y0, r, cornername, delta);
+    spanFill(&spans, color);
   }
 }
 
@@ -1325,48 +1291,22 @@ void ST7789::drawEllipse(int16_t x0, int16_t y0, int32_t rx, int32_t ry, uint16_
 ***************************************************************************************/
 void ST7789::fillEllipse(int16_t x0, int16_t y0, int32_t rx, int32_t ry, uint16_t color)
 {
-  if (rx < 2)
-    return;
-  if (ry < 2)
-    return;
-  int32_t x, y;
-  int32_t rx2 = rx * rx;
-  int32_t ry2 = ry * ry;
-  int32_t fx2 = 4 * rx2;
-  int32_t fy2 = 4 * ry2;
-  int32_t s;
-
-  spi_begin();
-  inTransaction = true;
-
-  for (x = 0, y = ry, s = 2 * ry2 + rx2 * (1 - 2 * ry); ry2 * x <= rx2 * y; x++)
+  raster_spans_t spans;
+  for (int32_t top = y0 - ry; spanBegin(&spans, top, y0 + ry); top = spans.top + spans.rows)
   {
-    drawFastHLine(x0 - x, y0 - y, x + x + 1, color);
-    drawFastHLine(x0 - x, y0 + y, x + x + 1, color);
-
-    if (s >= 0)
-    {
-      s += fx2 * (1 - y);
-      y--;
-    }
-    s += ry2 * ((4 * x) + 6);
+    raster_fill_ellipse(raster_spans_rect, &spans, x0, y0, rx, ry);
+    spanFill(&spans, color);
   }
+}
 
-  for (x = rx, y = 0, s = 2 * rx2 + ry2 * (1 - 2 * rx); rx2 * y <= ry2 * x; y++)
+void ST7789::fillEllipse(int16_t x0, int16_t y0, int32_t rx, int32_t ry, uint16_t color, uint16_t bg)
+{
+  raster_spans_t spans;
+  for (int32_t top = y0 - ry; spanBegin(&spans, top, y0 + ry); top = spans.top + spans.rows)
   {
-    drawFastHLine(x0 - x, y0 - y, x + x + 1, color);
-    drawFastHLine(x0 - x, y0 + y, x + x + 1, color);
-
-    if (s >= 0)
-    {
-      s += fy2 * (1 - x);
-      x--;
-    }
-    s += rx2 * ((4 * y) + 6);
+    raster_fill_ellipse(raster_spans_rect, &spans, x0, y0, rx, ry);
+    spanFill(&spans, color, bg);
   }
-
-  inTransaction = false;
-  spi_end();
 }
 
 /***************************************************************************************
@@ -1426,21 +1366,25 @@ void ST7789::drawRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r
 ** Function name:           fillRoundRect
 ** Description:             Draw a rounded corner filled rectangle
 ***************************************************************************************/
-// Fill a rounded rectangle, changed to horizontal lines (faster in sprites)
+// Fill a rounded rectangle, the straight middle part is a single run
 void ST7789::fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color)
 {
-  spi_begin();
-  inTransaction = true;
-
-  // smarter version
-  fillRect(x, y + r, w, h - r - r, color);
-
-  // draw four corners
-  fillCircleHelper(x + r, y + h - r - 1, r, 1, w - r - r - 1, color);
-  fillCircleHelper(x + r, y + r, r, 2, w - r - r - 1, color);
+  raster_spans_t spans;
+  for (int32_t top = y; spanBegin(&spans, top, y + h - 1); top = spans.top + spans.rows)
+  {
+    raster_fill_round_rect(raster_spans_rect, &spans, x, y, w, h, r);
+    spanFill(&spans, color);
+  }
+}
 
-  inTransaction = false;
-  spi_end();
+void ST7789::fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color, uint32_t bg)
+{
+  raster_spans_t spans;
+  for (int32_t top = y; spanBegin(&spans, top, y + h - 1); top = spans.top + spans.rows)
+  {
+    raster_fill_round_rect(raster_spans_rect, &spans, x, y, w, h, r);
+    spanFill(&spans, color, bg);
+  }
 }
 
 /***************************************************************************************
@@ -1465,97 +1409,20 @@ void ST7789::drawTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_
 ** Function name:           fillTriangle
 ** Description:             Draw a filled triangle using 3 arbitrary points
 ***************************************************************************************/
-// Fill a triangle - original Adafruit function works well and code footprint is small
+// Fill a triangle - original Adafruit scanline walk, sent as runs of equal scanlines
 void ST7789::fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color)
 {
-  int32_t a, b, y, last;
-
-  // Sort coordinates by Y order (y2 >= y1 >= y0)
-  if (y0 > y1)
-  {
-    swap_coord(y0, y1);
-    swap_coord(x0, x1);
-  }
-  if (y1 > y2)
-  {
-    swap_coord(y2, y1);
-    swap_coord(x2, x1);
-  }
-  if (y0 > y1)
-  {
-    swap_coord(y0, y1);
-    swap_coord(x0, x1);
-  }
-
-  if (y0 == y2)
-  { // Handle awkward all-on-same-line case as its own thing
-    a = b = x0;
-    if (x1 < a)
-      a = x1;
-    else if (x1 > b)
-      b = x1;
-    if (x2 < a)
-      a = x2;
-    else if (x2 > b)
-      b = x2;
-    drawFastHLine(a, y0, b - a + 1, color);
-    return;
-  }
-
-  spi_begin();
-  inTransaction = true;
-
-  int32_t
-      dx01 = x1 - x0,
-      dy01 = y1 - y0,
-      dx02 = x2 - x0,
-      dy02 = y2 - y0,
-      dx12 = x2 - x1,
-      dy12 = y2 - y1,
-      sa = 0,
-      sb = 0;
-
-  // For upper part of triangle, find scanline crossings for segments
-  // 0-1 and 0-2.  If y1=y2 (flat-bottomed triangle), the scanline y1
-  // is included here (and second loop will be skipped, avoiding a /0
-  // error there), otherwise scanline y1 is skipped here and handled
-  // in the second loop...which also avoids a /0 error here if y0=y1
-  // (flat-topped triangle).
-  if (y1 == y2)
-    last = y1; // Include y1 scanline
-  else
-    last = y1 - 1; // Skip it
+  int32_t ys = min(y0, min(y1, y2));
+  int32_t ye = (y0 > y1) ? y0 : y1;
+  if (y2 > ye)
+    ye = y2;
 
-  for (y = y0; y <= last; y++)
+  raster_spans_t spans;
+  for (int32_t top = ys; spanBegin(&spans, top, ye); top = spans.top + spans.rows)
   {
-    a = x0 + sa / dy01;
-    b = x0 + sb / dy02;
-    sa += dx01;
-    sb += dx02;
-
-    if (a > b)
-      swap_coord(a, b);
-    drawFastHLine(a, y, b - a + 1, color);
-  }
-
-  // For lower part of triangle, find scanline crossings for segments
-  // 0-2 and 1-2.  This loop is skipped if y1=y2.
-  sa = dx12 * (y - y1);
-  sb = dx02 * (y - y0);
-  for (; y <= y2; y++)
-  {
-    a = x1 + sa / dy12;
-    b = x0 + sb / dy02;
-    sa += dx12;
-    sb += dx02;
-
-    if (a > b)
-      swap_coord(a, b);
-    drawFastHLine(a, y, b - a + 1, color);
+    raster_fill_triangle(raster_spans_rect, &spans, x0, y0, x1, y1, x2, y2);
+    spanFill(&spans, color);
   }
-
-  inTransaction = false;
-  spi_end();
 }
 
 /***************************************************************************************
@@ -1881,78 +1748,14 @@ void ST7789::drawChar(int32_t x, int32_t y, unsigned char c, uint32_t color, uin
     return;
 
 #ifdef LOAD_GLCD
-  boolean fillbg = (bg != color);
-
-  if ((size == 1) && fillbg)
-  {
-    uint8_t column[6];
-    uint8_t mask = 0x1;
-    spi_begin();
-    //inTransaction = true;
-    setAddrWindow(x, y, x + 5, y + 8);
-    for (int8_t i = 0; i < 5; i++)
-      column[i] = pgm_read_byte(font + (c * 5) + i);
-    column[5] = 0;
-
-    for (int8_t j = 0; j < 8; j++)
-    {
-      for (int8_t k = 0; k < 5; k++)
-      {
-        if (column[k] & mask)
-        {
-          tft_Write_Color(color);
-        }
-        else
-        {
-          tft_Write_Color(bg);
-        }
-      }
-      mask <<= 1;
-      tft_Write_Color(bg);
-    }
-
-    CS_H;
-    //inTransaction = false;
-    spi_end();
-  }
+  glyph_t g;
+  glyph_glcd(&g, c);
+  if (bg != color)
+    glyphPush(&g, 1, x, y, size, color, bg);
   else
-  {
-    spi_begin();
-    inTransaction = true;
-    for (int8_t i = 0; i < 6; i++)
-    {
-      uint8_t line;
-      if (i == 5)
-        line = 0x0;
-      else
-        line = pgm_read_byte(font + (c * 5) + i);
-
-      if (size == 1) // default size
-      {
-        for (int8_t j = 0; j < 8; j++)
-        {
-          if (line & 0x1)
-            drawPixel(x + i, y + j, color);
-          line >>= 1;
-        }
-      }
-      else
-      { // big size
-        for (int8_t j = 0; j < 8; j++)
-        {
-          if (line & 0x1)
-            fillRect(x + (i * size), y + (j * size), size, size, color);
-          else if (fillbg)
-            fillRect(x + i * size, y + j * size, size, size, bg);
-          line >>= 1;
-        }
-      }
-    }
-    inTransaction = false;
-    spi_end();
-  }
-#endif
-}
+    glyphFill(&g, x, y, size, color);
+#endif
+}
 
 /***************************************************************************************
 ** Function name:           setWindow
@@ -1977,6 +1780,10 @@ inline void ST7789::setAddrWindow(int32_t xs, int32_t ys, int32_t xe, int32_t ye
 {
   //spi_begin();
 
+  // recorded drawing goes out ahead of whatever wants this window
+  if (_dl)
+    dlReplay();
+
 #ifdef CGRAM_OFFSET
   xs += colstart;
   xe += colstart;
@@ -2030,6 +1837,11 @@ void ST7789::drawPixel(uint32_t x, uint32_t y, uint32_t color)
   // Faster range checking, possible because x and y are unsigned
   if ((x >= _width) || (y >= _height))
     return;
+  if (_dl)
+  {
+    dlRecord(x, y, 1, 1, color);
+    return;
+  }
 
 #ifdef CGRAM_OFFSET
   x += colstart;
@@ -2186,6 +1998,12 @@ void ST7789::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t c
 ***************************************************************************************/
 void ST7789::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color)
 {
+  if (_dl)
+  {
+    dlRecord(x, y, 1, h, color);
+    return;
+  }
+
   // Rudimentary clipping
   if ((x >= _width) || (y >= _height) || (h < 1))
     return;
@@ -2209,6 +2027,12 @@ void ST7789::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color)
 ***************************************************************************************/
 void ST7789::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color)
 {
+  if (_dl)
+  {
+    dlRecord(x, y, w, 1, color);
+    return;
+  }
+
   // Rudimentary clipping
   if ((x >= _width) || (y >= _height) || (w < 1))
     return;
@@ -2231,6 +2055,12 @@ void ST7789::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color)
 ***************************************************************************************/
 void ST7789::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
 {
+  if (_dl)
+  {
+    dlRecord(x, y, w, h, color);
+    return;
+  }
+
   // rudimentary clipping (drawChar w/big text requires this)
   if ((x > _width) || (y > _height) || (w < 1) || (h < 1))
     return;
@@ -2239,6 +2069,14 @@ void ST7789::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color
   if ((y + h - 1) > _height)
     h = _height - y;
 
+  // large fills go out by DMA while this task sleeps, unless a shape holds the bus
+  if ((_dmaDev) && (_fillDMA) && (locked) && (!inTransaction) && ((uint32_t)w * h >= TFT_DMA_FILL_MIN))
+  {
+    fillRectDMA(x, y, w, h, color);
+    dmaWait();
+    return;
+  }
+
   spi_begin();
   setAddrWindow(x, y, x + w - 1, y + h - 1);
 
@@ -2394,129 +2232,19 @@ int16_t ST7789::drawChar(unsigned int uniCode, int x, int y, int font)
     return 0;
 
   int width = 0;
-  int height = 0;
-  uint32_t flash_address = 0;
-  uniCode -= 32;
-
-#ifdef LOAD_FONT2
-  if (font == 2)
-  {
-    // This is faster than using the fontdata structure
-    flash_address = pgm_read_dword(&chrtbl_f16[uniCode]);
-    width = pgm_read_byte(widtbl_f16 + uniCode);
-    height = chr_hgt_f16;
-  }
-#endif
-
-  int w = width;
-  int pX = 0;
-  int pY = y;
-  uint8_t line = 0;
 
 #ifdef LOAD_FONT2 // chop out code if we do not need it
-  if (font == 2)
+  glyph_t g;
+  if ((font == 2) && (glyph_font16(&g, uniCode)))
   {
-    w = w + 6; // Should be + 7 but we need to compensate for width increment
-    w = w / 8;
+    width = g.width;
     if (x + width * textsize >= (int16_t)_width)
       return width * textsize;
 
-    if (textcolor == textbgcolor || textsize != 1)
-    {
-      spi_begin();
-      inTransaction = true;
-
-      for (int i = 0; i < height; i++)
-      {
-        if (textcolor != textbgcolor)
-          fillRect(x, pY, width * textsize, textsize, textbgcolor);
-
-        for (int k = 0; k < w; k++)
-        {
-          line = pgm_read_byte((uint8_t *)flash_address + w * i + k);
-          if (line)
-          {
-            if (textsize == 1)
-            {
-              pX = x + k * 8;
-              if (line & 0x80)
-                drawPixel(pX, pY, textcolor);
-              if (line & 0x40)
-                drawPixel(pX + 1, pY, textcolor);
-              if (line & 0x20)
-                drawPixel(pX + 2, pY, textcolor);
-              if (line & 0x10)
-                drawPixel(pX + 3, pY, textcolor);
-              if (line & 0x08)
-                drawPixel(pX + 4, pY, textcolor);
-              if (line & 0x04)
-                drawPixel(pX + 5, pY, textcolor);
-              if (line & 0x02)
-                drawPixel(pX + 6, pY, textcolor);
-              if (line & 0x01)
-                drawPixel(pX + 7, pY, textcolor);
-            }
-            else
-            {
-              pX = x + k * 8 * textsize;
-              if (line & 0x80)
-                fillRect(pX, pY, textsize, textsize, textcolor);
-              if (line & 0x40)
-                fillRect(pX + textsize, pY, textsize, textsize, textcolor);
-              if (line & 0x20)
-                fillRect(pX + 2 * textsize, pY, textsize, textsize, textcolor);
-              if (line & 0x10)
-                fillRect(pX + 3 * textsize, pY, textsize, textsize, textcolor);
-              if (line & 0x08)
-                fillRect(pX + 4 * textsize, pY, textsize, textsize, textcolor);
-              if (line & 0x04)
-                fillRect(pX + 5 * textsize, pY, textsize, textsize, textcolor);
-              if (line & 0x02)
-                fillRect(pX + 6 * textsize, pY, textsize, textsize, textcolor);
-              if (line & 0x01)
-                fillRect(pX + 7 * textsize, pY, textsize, textsize, textcolor);
-            }
-          }
-        }
-        pY += textsize;
-      }
-
-      inTransaction = false;
-      spi_end();
-    }
+    if (textcolor != textbgcolor)
+      glyphPush(&g, 1, x, y, textsize, textcolor, textbgcolor);
     else
-    // Faster drawing of characters and background using block write
-    {
-      spi_begin();
-      setAddrWindow(x, y, (x + w * 8) - 1, y + height - 1);
-
-      uint8_t mask;
-      for (int i = 0; i < height; i++)
-      {
-        for (int k = 0; k < w; k++)
-        {
-          line = pgm_read_byte((uint8_t *)flash_address + w * i + k);
-          pX = x + k * 8;
-          mask = 0x80;
-          while (mask)
-          {
-            if (line & mask)
-            {
-              tft_Write_Color(textcolor);
-            }
-            else
-            {
-              tft_Write_Color(textbgcolor);
-            }
-            mask = mask >> 1;
-          }
-        }
-        pY += textsize;
-      }
-
-      CS_H;
-      spi_end();
-    }
+      glyphFill(&g, x, y, textsize, textcolor);
   }
 #endif //FONT2
 
@@ -2633,8 +2361,15 @@ int16_t ST7789::drawString(const char *string, int poX, int poY, int font)
 
   int8_t xo = 0;
 
-  while (*string)
-    sumX += drawChar(*(string++), poX + sumX, poY, font);
+  // text with a background goes out a whole string to a window
+  int16_t cached = textCacheDraw(string, poX, poY, font);
+  if (cached >= 0)
+    sumX = cached;
+  else if ((!_offscreen) && (textcolor != textbgcolor) && ((font == 1) || (font == 2)))
+    sumX = glyphString(string, poX, poY, font);
+  else
+    while (*string)
+      sumX += drawChar(*(string++), poX + sumX, poY, font);
 
   if ((padX > cwidth) && (textcolor != textbgcolor))
   {
@@ -2865,3 +2600,989 @@ inline void ST7789::writeBlock(uint16_t color, uint32_t repeat)
       ;
   }
 }
+
+/***************************************************************************************
+** Function name:           initDMA
+** Description:             set up asynchronous pushes with a buffer of "pixels" pixels
+***************************************************************************************/
+// The SPI master driver shares the host with the SPI library (and the SD card behind
+// it): the DMA task holds the SPI library transaction while pixels stream, then puts
+// back the registers the library expects.
+static const uint32_t tft_dma_regs[TFT_DMA_BUS_REGS] = {
+    SPI_USER_REG(SPI_NUM), SPI_USER1_REG(SPI_NUM), SPI_USER2_REG(SPI_NUM), SPI_CTRL_REG(SPI_NUM), SPI_CTRL2_REG(SPI_NUM),
+    SPI_CLOCK_REG(SPI_NUM), SPI_PIN_REG(SPI_NUM), SPI_MOSI_DLEN_REG(SPI_NUM), SPI_DMA_CONF_REG(SPI_NUM)};
+
+static void tft_dma_save(uint32_t *regs)
+{
+  for (int k = 0; k < TFT_DMA_BUS_REGS; k++)
+    regs[k] = READ_PERI_REG(tft_dma_regs[k]);
+}
+
+static void tft_dma_restore(const uint32_t *regs)
+{
+  WRITE_PERI_REG(SPI_DMA_OUT_LINK_REG(SPI_NUM), 0);
+  for (int k = 0; k < TFT_DMA_BUS_REGS; k++)
+    WRITE_PERI_REG(tft_dma_regs[k], regs[k]);
+}
+
+// Runs in the SPI interrupt before each transaction
+static void IRAM_ATTR tft_dma_pre(spi_transaction_t *t)
+{
+  if (((tft_dma_trans_t *)t->user)->command)
+  {
+    DC_C;
+  }
+  else
+  {
+    DC_D;
+  }
+}
+
+bool ST7789::initDMA(uint32_t pixels)
+{
+  if (_dmaDev)
+    return true;
+
+  _dmaBuf = (uint16_t *)heap_caps_malloc(pixels * 2, MALLOC_CAP_DMA);
+  _dmaFree = xQueueCreate(TFT_DMA_QUEUE, sizeof(tft_dma_trans_t *));
+  _dmaStart = xSemaphoreCreateBinary();
+  _dmaReady = xSemaphoreCreateBinary();
+  _dmaIdle = xSemaphoreCreateBinary();
+  _dmaFillQueued = xSemaphoreCreateBinary();
+  if ((!_dmaBuf) || (!_dmaFree) || (!_dmaStart) || (!_dmaReady) || (!_dmaIdle) || (!_dmaFillQueued))
+    return false;
+  for (int k = 0; k < TFT_DMA_QUEUE; k++)
+  {
+    tft_dma_trans_t *trans = &_dmaTrans[k];
+    xQueueSend(_dmaFree, &trans, 0);
+  }
+  xSemaphoreGive(_dmaIdle);
+  xSemaphoreGive(_dmaFillQueued);
+  _dmaSize = pixels;
+  _dmaHead = 0;
+
+  spi_bus_config_t buscfg;
+  memset(&buscfg, 0, sizeof(buscfg));
+  buscfg.mosi_io_num = TFT_MOSI;
+  buscfg.miso_io_num = TFT_MISO;
+  buscfg.sclk_io_num = TFT_SCLK;
+  buscfg.quadwp_io_num = -1;
+  buscfg.quadhd_io_num = -1;
+  buscfg.max_transfer_sz = pixels * 2;
+
+  spi_device_interface_config_t devcfg;
+  memset(&devcfg, 0, sizeof(devcfg));
+  devcfg.mode = TFT_SPI_MODE;
+  devcfg.clock_speed_hz = SPI_FREQUENCY;
+  devcfg.spics_io_num = -1; // CS stays a GPIO, low for a whole run of transactions
+  devcfg.flags = SPI_DEVICE_NO_DUMMY;
+  devcfg.queue_size = TFT_DMA_QUEUE;
+  devcfg.pre_cb = tft_dma_pre;
+
+  spi_device_handle_t dev = NULL;
+  spi_begin();
+  tft_dma_save(_dmaBus);
+  bool ok = (spi_bus_initialize(TFT_DMA_HOST, &buscfg, TFT_DMA_CHANNEL) == ESP_OK) &&
+            (spi_bus_add_device(TFT_DMA_HOST, &devcfg, &dev) == ESP_OK);
+  tft_dma_restore(_dmaBus);
+  spi_end();
+
+  if ((!ok) || (xTaskCreatePinnedToCore(dmaTask, "tftDma", TFT_DMA_TASK_STACK, this, TFT_DMA_TASK_PRIORITY, NULL, TFT_DMA_TASK_CORE) != pdPASS))
+    return false;
+  _dmaDev = dev;
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           dmaTask
+** Description:             hold the bus while transactions are pending
+***************************************************************************************/
+void ST7789::dmaTask(void *parameter)
+{
+  ST7789 *tft = (ST7789 *)parameter;
+  spi_transaction_t *t;
+
+  for (;;)
+  {
+    xSemaphoreTake(tft->_dmaStart, portMAX_DELAY);
+    SPI.beginTransaction(SPISettings(SPI_FREQUENCY, MSBFIRST, TFT_SPI_MODE));
+    tft_dma_save(tft->_dmaBus);
+    CS_L;
+    xSemaphoreGive(tft->_dmaReady);
+
+    bool active = true;
+    while (active)
+    {
+      if (spi_device_get_trans_result(tft->_dmaDev, &t, portMAX_DELAY) != ESP_OK)
+        continue;
+      tft_dma_trans_t *trans = (tft_dma_trans_t *)t->user;
+      if ((trans->fill) && (trans->fill == tft->_dmaFillId) && (tft->dmaRefill(trans)))
+        continue;
+      if (trans->callback)
+        trans->callback(trans->arg);
+      // a fill keeps its slot until the last chunk, so slots come back in any order
+      xQueueSend(tft->_dmaFree, &trans, 0);
+
+      portENTER_CRITICAL(&tft->_dmaMux);
+      active = --tft->_dmaPending > 0;
+      tft->_dmaActive = active;
+      portEXIT_CRITICAL(&tft->_dmaMux);
+    }
+
+    CS_H;
+    tft_dma_restore(tft->_dmaBus);
+    SPI.endTransaction();
+    xSemaphoreGive(tft->_dmaIdle);
+  }
+}
+
+/***************************************************************************************
+** Function name:           dmaStart
+** Description:             hand the bus to the DMA task for a run of transactions
+***************************************************************************************/
+void ST7789::dmaStart(uint8_t count)
+{
+  xSemaphoreTake(_dmaIdle, portMAX_DELAY);
+  portENTER_CRITICAL(&_dmaMux);
+  _dmaPending = count;
+  _dmaActive = true;
+  portEXIT_CRITICAL(&_dmaMux);
+  xSemaphoreGive(_dmaStart);
+  xSemaphoreTake(_dmaReady, portMAX_DELAY);
+}
+
+/***************************************************************************************
+** Function name:           dmaQueue
+** Description:             queue the transactions of one push, the callback on the last
+***************************************************************************************/
+// All of them are counted before the first is queued, so the DMA task cannot release
+// the bus (and CS) between the RAMWR command and its pixels
+void ST7789::dmaQueue(const tft_dma_part_t *parts, uint8_t count, tft_dma_callback_t callback, void *arg)
+{
+  tft_dma_trans_t *slots[TFT_DMA_QUEUE];
+  for (uint8_t k = 0; k < count; k++)
+    xQueueReceive(_dmaFree, &slots[k], portMAX_DELAY);
+
+  portENTER_CRITICAL(&_dmaMux);
+  bool active = _dmaActive;
+  if (active)
+    _dmaPending += count;
+  portEXIT_CRITICAL(&_dmaMux);
+  if (!active)
+    dmaStart(count);
+
+  for (uint8_t k = 0; k < count; k++)
+  {
+    tft_dma_trans_t *trans = slots[k];
+    memset(&trans->t, 0, sizeof(trans->t));
+    trans->t.length = parts[k].len * 8;
+    trans->t.user = trans;
+    trans->command = parts[k].command;
+    trans->fill = parts[k].fill ? _dmaFillId : 0;
+    trans->callback = (k == count - 1) ? callback : NULL;
+    trans->arg = arg;
+    if (parts[k].len <= 4)
+    {
+      trans->t.flags = SPI_TRANS_USE_TXDATA; // short ones carry their data inline
+      memcpy(trans->t.tx_data, parts[k].buf, parts[k].len);
+    }
+    else
+      trans->t.tx_buffer = parts[k].buf;
+
+    spi_device_queue_trans(_dmaDev, &trans->t, portMAX_DELAY);
+  }
+}
+
+/***************************************************************************************
+** Function name:           dmaWindow
+** Description:             window commands, same caching as setAddrWindowCore()
+***************************************************************************************/
+// "bytes" holds the command parameters, 8 bytes. Returns the parts used.
+uint8_t ST7789::dmaWindow(tft_dma_part_t *parts, uint8_t *bytes, int32_t xs, int32_t ys, int32_t xe, int32_t ye)
+{
+  static const uint8_t commands[3] = {TFT_CASET, TFT_PASET, TFT_RAMWR};
+  uint8_t count = 0;
+
+  // recorded drawing goes first and moves the window
+  if (_dl)
+    flushRecording();
+
+#ifdef CGRAM_OFFSET
+  xs += colstart;
+  xe += colstart;
+  ys += rowstart;
+  ye += rowstart;
+#endif
+
+  if ((addr_cs != xs) || (addr_ce != xe))
+  {
+    bytes[0] = xs >> 8;
+    bytes[1] = xs;
+    bytes[2] = xe >> 8;
+    bytes[3] = xe;
+    parts[count++] = {&commands[0], 1, true};
+    parts[count++] = {bytes, 4, false};
+    addr_cs = xs;
+    addr_ce = xe;
+  }
+
+  if ((addr_rs != ys) || (addr_re != ye))
+  {
+    bytes[4] = ys >> 8;
+    bytes[5] = ys;
+    bytes[6] = ye >> 8;
+    bytes[7] = ye;
+    parts[count++] = {&commands[1], 1, true};
+    parts[count++] = {bytes + 4, 4, false};
+    addr_rs = ys;
+    addr_re = ye;
+  }
+
+  parts[count++] = {&commands[2], 1, true};
+  return count;
+}
+
+/***************************************************************************************
+** Function name:           dmaAlloc
+** Description:             room for "len" pixels in the DMA buffer
+***************************************************************************************/
+uint16_t *ST7789::dmaAlloc(uint32_t len)
+{
+  if (!_dmaActive)
+    _dmaHead = 0; // everything sent
+  else if (_dmaHead + len > _dmaSize)
+  {
+    dmaWait();
+    _dmaHead = 0;
+  }
+  uint16_t *buf = _dmaBuf + _dmaHead;
+  _dmaHead += len;
+  return buf;
+}
+
+static void tft_dma_copy(uint16_t *dst, const uint16_t *src, uint32_t len, bool swap)
+{
+  if (!swap)
+  {
+    memcpy(dst, src, len * 2);
+    return;
+  }
+  while (len--)
+  {
+    uint16_t color = *src++;
+    *dst++ = (color >> 8) | (color << 8);
+  }
+}
+
+/***************************************************************************************
+** Function name:           pushImageDMA
+** Description:             plot 16 bit colour image without waiting for the SPI transfer
+***************************************************************************************/
+// Falls back to pushImage() when DMA is not set up or the image does not fit the buffer
+bool ST7789::pushImageDMA(int32_t x, int32_t y, uint32_t w, uint32_t h, const uint16_t *data, tft_dma_callback_t callback, void *arg)
+{
+  if ((x >= (int32_t)_width) || (y >= (int32_t)_height))
+    return false;
+
+  int32_t dx = 0;
+  int32_t dy = 0;
+  int32_t dw = w;
+  int32_t dh = h;
+
+  if (x < 0)
+  {
+    dw += x;
+    dx = -x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    dh += y;
+    dy = -y;
+    y = 0;
+  }
+
+  if ((x + w) > _width)
+    dw = _width - x;
+  if ((y + h) > _height)
+    dh = _height - y;
+
+  if (dw < 1 || dh < 1)
+    return false;
+
+  if ((!_dmaDev) || ((uint32_t)(dw * dh) > _dmaSize))
+  {
+    pushImage(x - dx, y - dy, w, h, (uint16_t *)data);
+    if (callback)
+      callback(arg);
+    return false;
+  }
+
+  dmaFillWait();
+  uint16_t *buf = dmaAlloc(dw * dh);
+  data += dx + dy * w;
+  for (int32_t row = 0; row < dh; row++)
+    tft_dma_copy(buf + row * dw, data + row * w, dw, _swapBytes);
+
+  tft_dma_part_t parts[6];
+  uint8_t bytes[8];
+  uint8_t count = dmaWindow(parts, bytes, x, y, x + dw - 1, y + dh - 1);
+  parts[count++] = {buf, (size_t)(dw * dh * 2), false};
+  dmaQueue(parts, count, callback, arg);
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           pushImageDMA
+** Description:             plot indexed image without waiting for the SPI transfer
+***************************************************************************************/
+// Rows are expanded straight into the DMA buffer, a band of rows at a time so the next
+// band is expanded while the last one goes out. Falls back to pushImage() when DMA is not
+// set up or a row does not fit half the buffer.
+bool ST7789::pushImageDMA(int32_t x, int32_t y, uint32_t w, uint32_t h, const uint8_t *data, const palette_t *palette, tft_dma_callback_t callback, void *arg)
+{
+  if ((x >= (int32_t)_width) || (y >= (int32_t)_height))
+    return false;
+
+  int32_t dx = 0;
+  int32_t dy = 0;
+  int32_t dw = w;
+  int32_t dh = h;
+
+  if (x < 0)
+  {
+    dw += x;
+    dx = -x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    dh += y;
+    dy = -y;
+    y = 0;
+  }
+
+  if ((x + w) > _width)
+    dw = _width - x;
+  if ((y + h) > _height)
+    dh = _height - y;
+
+  if (dw < 1 || dh < 1)
+    return false;
+
+  int32_t band = _dmaDev ? (_dmaSize / 2) / dw : 0;
+  if (band < 1)
+  {
+    pushImage(x - dx, y - dy, w, h, data, palette);
+    if (callback)
+      callback(arg);
+    return false;
+  }
+
+  dmaFillWait();
+  uint32_t stride = palette_stride(palette, w);
+  data += dy * stride;
+  for (int32_t row = 0; row < dh; row += band)
+  {
+    int32_t rows = (dh - row < band) ? dh - row : band;
+    uint16_t *buf = dmaAlloc(rows * dw);
+    for (int32_t k = 0; k < rows; k++)
+      palette_line(palette, data + (row + k) * stride, dx, dw, buf + k * dw);
+
+    // the columns are cached, each band after the first only moves the rows
+    tft_dma_part_t parts[6];
+    uint8_t bytes[8];
+    uint8_t count = dmaWindow(parts, bytes, x, y + row, x + dw - 1, y + row + rows - 1);
+    parts[count++] = {buf, (size_t)(rows * dw * 2), false};
+    dmaQueue(parts, count, (row + rows >= dh) ? callback : NULL, arg);
+  }
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           pushColorsDMA
+** Description:             push an array of pixels to the window set by setWindow()
+***************************************************************************************/
+bool ST7789::pushColorsDMA(const uint16_t *data, uint32_t len, bool swap, tft_dma_callback_t callback, void *arg)
+{
+  if ((!_dmaDev) || (len > _dmaSize))
+  {
+    pushColors((uint16_t *)data, len, swap);
+    if (callback)
+      callback(arg);
+    return false;
+  }
+
+  dmaFillWait();
+  uint16_t *buf = dmaAlloc(len);
+  tft_dma_copy(buf, data, len, swap);
+
+  static const uint8_t ramwr = TFT_RAMWR; // restart at the window origin
+  tft_dma_part_t parts[2] = {{&ramwr, 1, true}, {buf, len * 2, false}};
+  dmaQueue(parts, 2, callback, arg);
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           fillRectDMA
+** Description:             solid fill without waiting for the SPI transfer
+***************************************************************************************/
+// The SPI master driver builds its own descriptor list for each transaction, so the
+// colour buffer cannot be linked into a ring. Instead two transactions point at it and
+// the DMA task queues each again as it completes, one is always ready behind the other.
+bool ST7789::fillRectDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color, tft_dma_callback_t callback, void *arg)
+{
+  if (x < 0)
+  {
+    w += x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    h += y;
+    y = 0;
+  }
+  if ((x + w) > (int32_t)_width)
+    w = _width - x;
+  if ((y + h) > (int32_t)_height)
+    h = _height - y;
+  if ((w < 1) || (h < 1))
+  {
+    if (callback)
+      callback(arg);
+    return false;
+  }
+
+  if (!_dmaDev)
+  {
+    fillRect(x, y, w, h, color);
+    if (callback)
+      callback(arg);
+    return false;
+  }
+
+  // the chunks of the last fill must all be queued before anything goes behind them
+  xSemaphoreTake(_dmaFillQueued, portMAX_DELAY);
+
+  uint32_t pixels = (uint32_t)w * h;
+  uint32_t chunk = min(pixels, min((uint32_t)TFT_DMA_FILL_PIXELS, _dmaSize / 2));
+  uint16_t *buf = dmaAlloc(chunk);
+  uint16_t color16 = (color >> 8) | (color << 8);
+  for (uint32_t k = 0; k < chunk; k++)
+    buf[k] = color16;
+
+  tft_dma_part_t parts[7];
+  uint8_t bytes[8];
+  uint8_t count = dmaWindow(parts, bytes, x, y, x + w - 1, y + h - 1);
+  uint32_t first = chunk;
+  uint32_t second = min(pixels - first, chunk);
+  parts[count++] = {buf, first * 2, false, true};
+  if (second)
+    parts[count++] = {buf, second * 2, false, true};
+
+  // set before queueing, the DMA task reads them as soon as the first chunk is out.
+  // Chunks of earlier fills still in flight have another id and are left alone.
+  _dmaFillId = (_dmaFillId == 255) ? 1 : _dmaFillId + 1;
+  _dmaFillChunk = chunk * 2;
+  _dmaFillLeft = (pixels - first - second) * 2;
+  if (_dmaFillLeft)
+  {
+    _dmaFillCallback = callback;
+    _dmaFillArg = arg;
+    dmaQueue(parts, count, NULL, NULL);
+  }
+  else
+  {
+    dmaQueue(parts, count, callback, arg);
+    xSemaphoreGive(_dmaFillQueued);
+  }
+  return true;
+}
+
+void ST7789::setFillDMA(bool enable)
+{
+  _fillDMA = enable;
+}
+
+/***************************************************************************************
+** Function name:           dmaRefill
+** Description:             queue a finished fill transaction again, in the DMA task
+***************************************************************************************/
+// Returns false once the fill is all queued, the transaction is then collected as usual
+bool ST7789::dmaRefill(tft_dma_trans_t *trans)
+{
+  if (!_dmaFillLeft)
+    return false;
+
+  uint32_t len = min(_dmaFillLeft, _dmaFillChunk);
+  _dmaFillLeft -= len;
+  trans->t.length = len * 8;
+  if (!_dmaFillLeft)
+  {
+    // the last chunk out ends the fill
+    trans->callback = _dmaFillCallback;
+    trans->arg = _dmaFillArg;
+  }
+  spi_device_queue_trans(_dmaDev, &trans->t, portMAX_DELAY);
+  if (!_dmaFillLeft)
+    xSemaphoreGive(_dmaFillQueued);
+  return true;
+}
+
+void ST7789::dmaFillWait()
+{
+  xSemaphoreTake(_dmaFillQueued, portMAX_DELAY);
+  xSemaphoreGive(_dmaFillQueued);
+}
+
+/***************************************************************************************
+** Function name:           dmaBusy
+** Description:             true while asynchronous pushes are streaming
+***************************************************************************************/
+bool ST7789::dmaBusy()
+{
+  return _dmaDev && (uxSemaphoreGetCount(_dmaIdle) == 0);
+}
+
+/***************************************************************************************
+** Function name:           dmaWait
+** Description:             wait for the asynchronous pushes and the bus to be released
+***************************************************************************************/
+void ST7789::dmaWait()
+{
+  if (!_dmaDev)
+    return;
+  xSemaphoreTake(_dmaIdle, portMAX_DELAY);
+  xSemaphoreGive(_dmaIdle);
+}
+
+/***************************************************************************************
+** Function name:           startRecording
+** Description:             record primitives into "dl" instead of drawing them
+***************************************************************************************/
+void ST7789::startRecording(DisplayList *dl)
+{
+  if (_dl)
+    flushRecording();
+  if (dl)
+    dl->clear();
+  _dl = dl;
+}
+
+/***************************************************************************************
+** Function name:           endRecording
+** Description:             replay what is recorded and draw directly again
+***************************************************************************************/
+void ST7789::endRecording()
+{
+  if (!_dl)
+    return;
+  flushRecording();
+  _dl = NULL;
+}
+
+void ST7789::flushRecording()
+{
+  if ((!_dl) || (!_dl->count()))
+    return;
+  spi_begin();
+  dlReplay();
+  CS_H;
+  spi_end();
+}
+
+/***************************************************************************************
+** Function name:           dlRecord
+** Description:             clip a rectangle to the screen and add it to the list
+***************************************************************************************/
+void ST7789::dlRecord(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  if (x < 0)
+  {
+    w += x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    h += y;
+    y = 0;
+  }
+  if ((x + w) > (int32_t)_width)
+    w = _width - x;
+  if ((y + h) > (int32_t)_height)
+    h = _height - y;
+  if ((w < 1) || (h < 1))
+    return;
+
+  // full, make room by drawing what is there
+  if (!_dl->add(x, y, w, h, color))
+  {
+    flushRecording();
+    _dl->add(x, y, w, h, color);
+  }
+}
+
+/***************************************************************************************
+** Function name:           dlReplay
+** Description:             draw the list, the caller holds the bus
+***************************************************************************************/
+// Chip select stays low from one window to the next, sorting by address lets
+// setAddrWindowCore() skip the CASET or PASET a window shares with the one before
+void ST7789::dlReplay()
+{
+  DisplayList *dl = _dl;
+  _dl = NULL;
+
+  dl->optimize();
+  const dl_cmd_t *cmd = dl->cmds();
+  for (uint16_t k = 0; k < dl->count(); k++)
+  {
+    setAddrWindow(cmd[k].x, cmd[k].y, cmd[k].x + cmd[k].w - 1, cmd[k].y + cmd[k].h - 1);
+    writeBlock(cmd[k].color, (uint32_t)cmd[k].w * cmd[k].h);
+  }
+  dl->replayed();
+  dl->clear();
+
+  _dl = dl;
+}
+
+/***************************************************************************************
+** Function name:           spanBegin
+** Description:             spans for the rows of ys to ye on screen, false when none are
+***************************************************************************************/
+// Shapes taller than RASTER_MAX_ROWS are drawn in bands, the caller moves "ys" on
+bool ST7789::spanBegin(raster_spans_t *spans, int32_t ys, int32_t ye)
+{
+  if (ys < 0)
+    ys = 0;
+  if (ye >= (int32_t)_height)
+    ye = _height - 1;
+  raster_spans_begin(spans, ys, ye - ys + 1);
+  return spans->rows > 0;
+}
+
+/***************************************************************************************
+** Function name:           spanFill
+** Description:             draw the spans, one window per run of rows with the same span
+***************************************************************************************/
+void ST7789::spanFill(raster_spans_t *spans, uint32_t color)
+{
+  // sprites and recordings take the rectangles as they are
+  bool direct = (!_offscreen) && (!_dl);
+  raster_spans_clip(spans, _width);
+
+  if (direct)
+  {
+    spi_begin();
+    inTransaction = true;
+  }
+
+  int32_t k = 0;
+  while (k < spans->rows)
+  {
+    int32_t xs = spans->xs[k], xe = spans->xe[k];
+    int32_t n = 1;
+    while ((k + n < spans->rows) && (spans->xs[k + n] == xs) && (spans->xe[k + n] == xe))
+      n++;
+
+    if (xs <= xe)
+    {
+      int32_t y = spans->top + k;
+      if (direct)
+      {
+        setAddrWindow(xs, y, xe, y + n - 1);
+        writeBlock(color, (uint32_t)(xe - xs + 1) * n);
+      }
+      else
+        fillRect(xs, y, xe - xs + 1, n, color);
+    }
+    k += n;
+  }
+
+  if (direct)
+  {
+    CS_H;
+    inTransaction = false;
+    spi_end();
+  }
+}
+
+/***************************************************************************************
+** Function name:           spanFill
+** Description:             draw the spans and "bg" around them in one bounding box window
+***************************************************************************************/
+// For convex shapes over a plain background: the pixels sent for the background
+// cost less than a window for each span
+void ST7789::spanFill(raster_spans_t *spans, uint32_t color, uint32_t bg)
+{
+  bool direct = (!_offscreen) && (!_dl);
+  int32_t bx, be;
+  raster_spans_clip(spans, _width);
+  if (!raster_spans_bounds(spans, &bx, &be))
+    return;
+
+  if (direct)
+  {
+    spi_begin();
+    inTransaction = true;
+    setAddrWindow(bx, spans->top, be, spans->top + spans->rows - 1);
+  }
+
+  for (int32_t k = 0; k < spans->rows; k++)
+  {
+    int32_t xs = spans->xs[k], xe = spans->xe[k];
+    if (xs > xe)
+    {
+      // background only
+      xs = be + 1;
+      xe = be;
+    }
+
+    if (direct)
+    {
+      writeBlock(bg, xs - bx);
+      writeBlock(color, xe - xs + 1);
+      writeBlock(bg, be - xe);
+    }
+    else
+    {
+      int32_t y = spans->top + k;
+      fillRect(bx, y, xs - bx, 1, bg);
+      fillRect(xs, y, xe - xs + 1, 1, color);
+      fillRect(xe + 1, y, be - xe, 1, bg);
+    }
+  }
+
+  if (direct)
+  {
+    CS_H;
+    inTransaction = false;
+    spi_end();
+  }
+}
+
+/***************************************************************************************
+** Function name:           glyphPush
+** Description:             push glyphs side by side with their background in one window
+***************************************************************************************/
+// Each glyph row is expanded once into a line buffer and sent "size" times
+void ST7789::glyphPush(const glyph_t *glyphs, uint8_t count, int32_t x, int32_t y, uint8_t size, uint16_t fg, uint16_t bg)
+{
+  int32_t w = 0;
+  for (uint8_t k = 0; k < count; k++)
+    w += glyphs[k].width * size;
+
+  // a sprite has no window to stream to, the background is a fill
+  if (_offscreen)
+  {
+    fillRect(x, y, w, glyphs[0].height * size, bg);
+    for (uint8_t k = 0; k < count; k++)
+    {
+      glyphFill(&glyphs[k], x, y, size, fg);
+      x += glyphs[k].width * size;
+    }
+    return;
+  }
+
+  // the cell clipped to the screen
+  int32_t xs = (x < 0) ? 0 : x, xe = x + w - 1;
+  int32_t ys = (y < 0) ? 0 : y, ye = y + glyphs[0].height * size - 1;
+  if (xe >= (int32_t)_width)
+    xe = _width - 1;
+  if (xe - xs >= GLYPH_LINE_PIXELS)
+    xe = xs + GLYPH_LINE_PIXELS - 1;
+  if (ye >= (int32_t)_height)
+    ye = _height - 1;
+  if ((xs > xe) || (ys > ye))
+    return;
+
+  uint16_t line[GLYPH_LINE_PIXELS];
+  uint32_t len = (xe - xs + 1) << 1;
+  int32_t last = -1;
+
+  spi_begin();
+  inTransaction = true;
+  setAddrWindow(xs, ys, xe, ye);
+
+  for (int32_t py = ys; py <= ye; py++)
+  {
+    int32_t row = (py - y) / size;
+    if (row != last)
+    {
+      glyph_line(glyphs, count, x, size, row, (fg >> 8) | (fg << 8), (bg >> 8) | (bg << 8), xs, xe, line);
+      last = row;
+    }
+    SPI.writeBytes((uint8_t *)line, len);
+  }
+
+  CS_H;
+  inTransaction = false;
+  spi_end();
+}
+
+typedef struct
+{
+  ST7789 *tft;
+  uint32_t color;
+} glyph_fill_t;
+
+static void glyph_fill_rect(void *ctx, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+  glyph_fill_t *f = (glyph_fill_t *)ctx;
+  f->tft->fillRect(x, y, w, h, f->color);
+}
+
+/***************************************************************************************
+** Function name:           glyphFill
+** Description:             draw the foreground of a glyph only, one window per run
+***************************************************************************************/
+void ST7789::glyphFill(const glyph_t *g, int32_t x, int32_t y, uint8_t size, uint16_t color)
+{
+  glyph_fill_t f = {this, color};
+
+  spi_begin();
+  inTransaction = true;
+
+  glyph_rects(g, x, y, size, glyph_fill_rect, &f);
+
+  inTransaction = false;
+  spi_end();
+}
+
+/***************************************************************************************
+** Function name:           glyphString
+** Description:             draw a string in font 1 or 2 with its background
+***************************************************************************************/
+// Draws what drawChar() would for each character, GLYPH_MAX_STRING glyphs to a window
+int16_t ST7789::glyphString(const char *string, int32_t x, int32_t y, uint8_t f)
+{
+  glyph_t glyphs[GLYPH_MAX_STRING];
+  uint8_t count = 0;
+  int32_t sumX = 0, start = x;
+
+  while (*string)
+  {
+    unsigned char c = *(string++);
+    glyph_t *g = &glyphs[count];
+    int32_t advance = 0;
+
+#ifdef LOAD_GLCD
+    if (f == 1)
+    {
+      if (c < 32)
+        glyph_blank(g, 6, 8);
+      else
+        glyph_glcd(g, c);
+      advance = 6 * textsize;
+    }
+#endif
+#ifdef LOAD_FONT2
+    if ((f == 2) && (glyph_font16(g, c)))
+    {
+      advance = g->width * textsize;
+
+      // a glyph reaching the right edge is left out, and so is the rest
+      if (x + sumX + advance >= (int32_t)_width)
+      {
+        sumX += advance;
+        continue;
+      }
+    }
+#endif
+    if (!advance)
+      continue;
+
+    sumX += advance;
+    if (++count == GLYPH_MAX_STRING)
+    {
+      glyphPush(glyphs, count, start, y, textsize, textcolor, textbgcolor);
+      start = x + sumX;
+      count = 0;
+    }
+  }
+
+  if (count)
+    glyphPush(glyphs, count, start, y, textsize, textcolor, textbgcolor);
+  return sumX;
+}
+
+void ST7789::setTextCache(TextCache *cache)
+{
+  _textCache = cache;
+}
+
+TextCache *ST7789::getTextCache()
+{
+  return _textCache;
+}
+
+/***************************************************************************************
+** Function name:           textCacheDraw
+** Description:             draw a string from the text cache, -1 when it is not cached
+***************************************************************************************/
+// A miss renders the whole string into a new entry. Only strings that drawChar() draws
+// in full are kept: printable characters, all of the cell on screen.
+int16_t ST7789::textCacheDraw(const char *string, int32_t x, int32_t y, uint8_t f)
+{
+  if ((!_textCache) || (textcolor == textbgcolor) || ((f != 1) && (f != 2)) || (strlen(string) >= TEXT_CACHE_KEY))
+    return -1;
+
+  glyph_t glyphs[TEXT_CACHE_KEY];
+  uint8_t count = 0;
+  int32_t w = 0, h = 0;
+  for (const char *s = string; *s; s++)
+  {
+    unsigned char c = *s;
+    glyph_t *g = &glyphs[count++];
+    if (f == 1)
+    {
+#ifdef LOAD_GLCD
+      if (c < 32)
+        return -1;
+      glyph_glcd(g, c);
+#else
+      return -1;
+#endif
+    }
+    else
+    {
+#ifdef LOAD_FONT2
+      if (!glyph_font16(g, c))
+        return -1;
+#else
+      return -1;
+#endif
+    }
+    w += g->width * textsize;
+    h = g->height * textsize;
+  }
+
+  // drawChar() leaves out a font 2 glyph that reaches the last column
+  if ((!count) || (x < 0) || (y < 0) || (x + w > (int32_t)_width) || (y + h > (int32_t)_height) ||
+      ((f == 2) && (x + w == (int32_t)_width)))
+    return -1;
+
+  const text_cache_entry_t *e = _textCache->find(string, f, textsize, textcolor, textbgcolor);
+  if (!e)
+  {
+    text_cache_entry_t *n = _textCache->insert(string, f, textsize, textcolor, textbgcolor, w, h);
+    if (!n)
+      return -1;
+
+    // each glyph row once, the rows it is scaled to are copies
+    for (int32_t row = 0; row < glyphs[0].height; row++)
+    {
+      uint16_t *line = n->pixels + row * textsize * w;
+      glyph_line(glyphs, count, 0, textsize, row, textcolor, textbgcolor, 0, w - 1, line);
+      for (uint8_t k = 1; k < textsize; k++)
+        memcpy(line + k * w, line, w * 2);
+    }
+    e = n;
+  }
+
+  bool swap = _swapBytes;
+  _swapBytes = true;
+  pushImage(x, y, e->w, e->h, e->pixels);
+  _swapBytes = swap;
+  return w;
+}
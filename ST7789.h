@@ -417,6 +417,47 @@ const PROGMEM fontinfo fontdata[] = {
 #endif
 };
 
+#include <driver/spi_master.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
+#include "displaylist.h"
+#include "raster.h"
+#include "glyph.h"
+#include "textcache.h"
+#include "palette.h"
+
+// Asynchronous pushes: the pixels are copied, byte swapped when needed, into a DMA
+// capable buffer and streamed by the SPI master driver with linked descriptors
+#define TFT_DMA_HOST VSPI_HOST // host of SPI_NUM
+#define TFT_DMA_CHANNEL 1
+#define TFT_DMA_QUEUE 8 // transactions in flight, a push takes up to 6 and a fill 7
+#define TFT_DMA_BUS_REGS 9
+#define TFT_DMA_TASK_STACK 2048
+#define TFT_DMA_TASK_PRIORITY 2
+#define TFT_DMA_TASK_CORE 1 // with loop()
+#define TFT_DMA_FILL_PIXELS 2048 // colour buffer a fill sends over and over
+#define TFT_DMA_FILL_MIN 2048    // fillRect() polls smaller fills, they are done before DMA starts
+
+typedef void (*tft_dma_callback_t)(void *arg);
+
+typedef struct
+{
+  spi_transaction_t t;
+  bool command; // sent with DC low
+  uint8_t fill; // id of the fill it sends the colour buffer of, 0 for none
+  tft_dma_callback_t callback;
+  void *arg;
+} tft_dma_trans_t;
+
+// One transaction of a push, queued together with the others of the push
+typedef struct
+{
+  const void *buf;
+  size_t len;
+  bool command;
+  bool fill;
+} tft_dma_part_t;
+
 // Class functions and variables
 class ST7789 : public Print
 {
@@ -451,6 +492,7 @@ public:
   void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color),
       drawRoundRect(int32_t x0, int32_t y0, int32_t w, int32_t h, int32_t radius, uint32_t color),
       fillRoundRect(int32_t x0, int32_t y0, int32_t w, int32_t h, int32_t radius, uint32_t color),
+      fillRoundRect(int32_t x0, int32_t y0, int32_t w, int32_t h, int32_t radius, uint32_t color, uint32_t bg),
 
       setRotation(uint8_t r),
       invertDisplay(boolean i),
@@ -458,10 +500,12 @@ public:
       drawCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color),
       drawCircleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t cornername, uint32_t color),
       fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color),
+      fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color, uint32_t bg), // bounding box filled with bg
       fillCircleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t cornername, int32_t delta, uint32_t color),
 
       drawEllipse(int16_t x0, int16_t y0, int32_t rx, int32_t ry, uint16_t color),
       fillEllipse(int16_t x0, int16_t y0, int32_t rx, int32_t ry, uint16_t color),
+      fillEllipse(int16_t x0, int16_t y0, int32_t rx, int32_t ry, uint16_t color, uint16_t bg),
 
       drawTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color),
       fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color),
@@ -494,7 +538,8 @@ public:
   void pushRect(uint32_t x0, uint32_t y0, uint32_t w, uint32_t h, uint16_t *data);
 
   // These are used to render images or sprites stored in RAM arrays
-  void pushImage(int32_t x0, int32_t y0, uint32_t w, uint32_t h, uint16_t *data);
+  // virtual so text cache hits land in a sprite's canvas
+  virtual void pushImage(int32_t x0, int32_t y0, uint32_t w, uint32_t h, uint16_t *data);
   void pushImage(int32_t x0, int32_t y0, uint32_t w, uint32_t h, uint16_t *data, uint16_t transparent);
 
   // These are used to render images stored in FLASH (PROGMEM)
@@ -505,6 +550,35 @@ public:
   void pushImage(int32_t x0, int32_t y0, uint32_t w, uint32_t h, uint8_t *data, bool bpp8 = true);
   void pushImage(int32_t x0, int32_t y0, uint32_t w, uint32_t h, uint8_t *data, uint8_t transparent, bool bpp8 = true);
 
+  // 8 or 4 bit indexed images, rows expanded through the palette. See palette.h.
+  virtual void pushImage(int32_t x0, int32_t y0, uint32_t w, uint32_t h, const uint8_t *data, const palette_t *palette);
+
+  // Asynchronous versions, see initDMA(). They return once the pixels are copied, the
+  // callback runs in the DMA task when they are out. Any other drawing waits for them.
+  bool initDMA(uint32_t pixels);
+  bool pushImageDMA(int32_t x0, int32_t y0, uint32_t w, uint32_t h, const uint16_t *data, tft_dma_callback_t callback = NULL, void *arg = NULL);
+  bool pushImageDMA(int32_t x0, int32_t y0, uint32_t w, uint32_t h, const uint8_t *data, const palette_t *palette, tft_dma_callback_t callback = NULL, void *arg = NULL);
+  bool pushColorsDMA(const uint16_t *data, uint32_t len, bool swap = true, tft_dma_callback_t callback = NULL, void *arg = NULL);
+  // Solid fill from a small colour buffer sent repeatedly, the CPU is free while it runs.
+  // fillRect() and fillScreen() use it for large fills and wait, see setFillDMA().
+  bool fillRectDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color, tft_dma_callback_t callback = NULL, void *arg = NULL);
+  void setFillDMA(bool enable);
+  bool dmaBusy();
+  void dmaWait();
+
+  // Record/replay. While a list is set drawPixel(), drawFastHLine(), drawFastVLine() and
+  // fillRect() only record, so shapes and text built from them cost no bus time. The list
+  // is optimised and replayed in one transaction when it fills up, before anything else
+  // is drawn and at endRecording().
+  void startRecording(DisplayList *dl);
+  void endRecording();
+  void flushRecording();
+
+  // Font 1 and 2 strings drawn with a background are kept rendered in the cache, and
+  // drawn again with one pushImage(). NULL turns it off.
+  void setTextCache(TextCache *cache);
+  TextCache *getTextCache();
+
   // Swap the byte order for pushImage() - corrects endianness
   void setSwapBytes(bool swap);
   bool getSwapBytes(void);
@@ -583,6 +657,47 @@ private:
 
   void writeBlock(uint16_t color, uint32_t repeat);
 
+  static void dmaTask(void *parameter);
+  uint16_t *dmaAlloc(uint32_t len);
+  void dmaStart(uint8_t count);
+  void dmaQueue(const tft_dma_part_t *parts, uint8_t count, tft_dma_callback_t callback, void *arg);
+  uint8_t dmaWindow(tft_dma_part_t *parts, uint8_t *bytes, int32_t xs, int32_t ys, int32_t xe, int32_t ye);
+  bool dmaRefill(tft_dma_trans_t *trans);
+  void dmaFillWait();
+
+  void glyphPush(const glyph_t *glyphs, uint8_t count, int32_t x, int32_t y, uint8_t size, uint16_t fg, uint16_t bg);
+  void glyphFill(const glyph_t *g, int32_t x, int32_t y, uint8_t size, uint16_t color);
+  int16_t glyphString(const char *string, int32_t x, int32_t y, uint8_t f);
+  int16_t textCacheDraw(const char *string, int32_t x, int32_t y, uint8_t f);
+
+  bool spanBegin(raster_spans_t *spans, int32_t ys, int32_t ye);
+  void spanFill(raster_spans_t *spans, uint32_t color);
+  void spanFill(raster_spans_t *spans, uint32_t color, uint32_t bg);
+
+  void dlRecord(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+  void dlReplay();
+
+  DisplayList *_dl = NULL; // recording into
+  TextCache *_textCache = NULL;
+
+  spi_device_handle_t _dmaDev = NULL;
+  tft_dma_trans_t _dmaTrans[TFT_DMA_QUEUE];
+  QueueHandle_t _dmaFree = NULL; // of _dmaTrans, given back by the DMA task as each one completes
+  uint16_t *_dmaBuf = NULL;
+  uint32_t _dmaSize = 0, _dmaHead = 0; // pixels
+  volatile bool _dmaActive = false;    // the DMA task owns the bus
+  uint32_t _dmaPending = 0;            // transactions queued and not collected, under _dmaMux
+  portMUX_TYPE _dmaMux = portMUX_INITIALIZER_UNLOCKED;
+  SemaphoreHandle_t _dmaStart, _dmaReady, _dmaIdle;
+  SemaphoreHandle_t _dmaFillQueued;       // taken while a fill has chunks left to queue
+  volatile uint32_t _dmaFillLeft = 0;     // bytes of the fill not queued yet, DMA task only
+  uint32_t _dmaFillChunk = 0;             // bytes
+  volatile uint8_t _dmaFillId = 0;        // of the fill being queued
+  tft_dma_callback_t _dmaFillCallback = NULL;
+  void *_dmaFillArg = NULL;
+  bool _fillDMA = true;
+  uint32_t _dmaBus[TFT_DMA_BUS_REGS]; // SPI registers as the SPI library left them
+
 protected:
   int32_t win_xe, win_ye;
 
@@ -602,8 +717,7 @@ protected:
   bool locked, inTransaction; // Transaction and mutex lock flags for ESP32
 
   bool _booted;
-
-  uint32_t _lastColor;
+  bool _offscreen = false; // a TFT_eSprite, drawing never touches the bus
 }; // End of class ST7789
 
 #endif
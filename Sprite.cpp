@@ -0,0 +1,371 @@
+/***************************************************
+ * Sprite class in the style of TFT_eSprite from
+ * https://github.com/moononournation/TFT_eSPI
+ ****************************************************/
+
+#include "Sprite.h"
+
+/***************************************************************************************
+** Function name:           TFT_eSprite
+** Description:             Class constructor, "tft" is the display it is pushed to
+***************************************************************************************/
+TFT_eSprite::TFT_eSprite(ST7789 *tft) : ST7789(0, 0)
+{
+  _tft = tft;
+  _bpp = 16;
+  _img = NULL;
+  _stride = 0;
+  _capacity = 0;
+  _offscreen = true;
+  textwrapX = false;
+}
+
+TFT_eSprite::~TFT_eSprite()
+{
+  deleteSprite();
+}
+
+/***************************************************************************************
+** Function name:           setColorDepth
+** Description:             16, 8 or 1 bits per pixel, takes effect at createSprite()
+***************************************************************************************/
+void TFT_eSprite::setColorDepth(int8_t bpp)
+{
+  _bpp = (bpp == 1) || (bpp == 8) ? bpp : 16;
+}
+
+int8_t TFT_eSprite::getColorDepth(void)
+{
+  return _bpp;
+}
+
+/***************************************************************************************
+** Function name:           createSprite
+** Description:             allocate the canvas, cleared to black
+***************************************************************************************/
+// The buffer is kept when the new canvas fits in it, so resizing a sprite per use is cheap
+void *TFT_eSprite::createSprite(int16_t w, int16_t h)
+{
+  if ((w < 1) || (h < 1))
+  {
+    deleteSprite();
+    return NULL;
+  }
+
+  _stride = (_bpp == 16) ? w * 2 : (_bpp == 8) ? w : (w + 7) / 8;
+  if ((!_img) || (_stride * h > _capacity))
+  {
+    deleteSprite();
+    // drawing is faster in internal RAM, large canvases go to PSRAM
+    _img = (uint8_t *)malloc(_stride * h);
+    if (!_img)
+      _img = (uint8_t *)ps_malloc(_stride * h);
+    if (!_img)
+      return NULL;
+    _capacity = _stride * h;
+  }
+
+  memset(_img, 0, _stride * h);
+  _init_width = _width = w;
+  _init_height = _height = h;
+  return _img;
+}
+
+void TFT_eSprite::deleteSprite(void)
+{
+  free(_img);
+  _img = NULL;
+  _capacity = 0;
+  _width = _height = 0;
+}
+
+bool TFT_eSprite::created(void)
+{
+  return _img != NULL;
+}
+
+int16_t TFT_eSprite::width(void)
+{
+  return _width;
+}
+
+int16_t TFT_eSprite::height(void)
+{
+  return _height;
+}
+
+/***************************************************************************************
+** Function name:           fillSprite
+** Description:             fill the whole canvas with a colour
+***************************************************************************************/
+void TFT_eSprite::fillSprite(uint32_t color)
+{
+  fillRect(0, 0, _width, _height, color);
+}
+
+/***************************************************************************************
+** Function name:           readPixel
+** Description:             565 colour of a pixel
+***************************************************************************************/
+uint16_t TFT_eSprite::readPixel(int32_t x, int32_t y)
+{
+  if ((!_img) || (x < 0) || (y < 0) || (x >= (int32_t)_width) || (y >= (int32_t)_height))
+    return 0;
+
+  if (_bpp == 16)
+    return ((uint16_t *)(_img + y * _stride))[x];
+  if (_bpp == 8)
+    return color8to16(_img[y * _stride + x]);
+  return (_img[y * _stride + (x >> 3)] & (0x80 >> (x & 7))) ? bitmap_fg : bitmap_bg;
+}
+
+/***************************************************************************************
+** Function name:           drawPixel
+** Description:             plot a pixel into the canvas
+***************************************************************************************/
+void TFT_eSprite::drawPixel(uint32_t x, uint32_t y, uint32_t color)
+{
+  // Faster range checking, possible because x and y are unsigned
+  if ((!_img) || (x >= _width) || (y >= _height))
+    return;
+
+  if (_bpp == 16)
+    ((uint16_t *)(_img + y * _stride))[x] = color;
+  else if (_bpp == 8)
+    _img[y * _stride + x] = color16to8(color);
+  else if (color)
+    _img[y * _stride + (x >> 3)] |= 0x80 >> (x & 7);
+  else
+    _img[y * _stride + (x >> 3)] &= ~(0x80 >> (x & 7));
+}
+
+/***************************************************************************************
+** Function name:           fillRect
+** Description:             clipped rectangle fill, one row at a time
+***************************************************************************************/
+void TFT_eSprite::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  if (!_img)
+    return;
+  if (x < 0)
+  {
+    w += x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    h += y;
+    y = 0;
+  }
+  if ((x + w) > (int32_t)_width)
+    w = _width - x;
+  if ((y + h) > (int32_t)_height)
+    h = _height - y;
+  if ((w < 1) || (h < 1))
+    return;
+
+  if (_bpp == 16)
+  {
+    uint16_t *row = (uint16_t *)(_img + y * _stride) + x;
+    for (int32_t i = 0; i < w; i++)
+      row[i] = color;
+    // the other rows are copies of the first
+    for (int32_t j = 1; j < h; j++)
+      memcpy(row + j * (_stride >> 1), row, w * 2);
+  }
+  else if (_bpp == 8)
+  {
+    uint8_t color8 = color16to8(color);
+    for (int32_t j = 0; j < h; j++)
+      memset(_img + (y + j) * _stride + x, color8, w);
+  }
+  else
+  {
+    for (int32_t j = 0; j < h; j++)
+      for (int32_t i = 0; i < w; i++)
+        drawPixel(x + i, y + j, color);
+  }
+}
+
+void TFT_eSprite::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color)
+{
+  fillRect(x, y, 1, h, color);
+}
+
+void TFT_eSprite::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color)
+{
+  fillRect(x, y, w, 1, color);
+}
+
+/***************************************************************************************
+** Function name:           drawLine
+** Description:             draw a line between 2 arbitrary points
+***************************************************************************************/
+// Bresenham's algorithm, runs of pixels become fast lines
+void TFT_eSprite::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color)
+{
+  boolean steep = abs(y1 - y0) > abs(x1 - x0);
+  if (steep)
+  {
+    swap_coord(x0, y0);
+    swap_coord(x1, y1);
+  }
+
+  if (x0 > x1)
+  {
+    swap_coord(x0, x1);
+    swap_coord(y0, y1);
+  }
+
+  int32_t dx = x1 - x0, dy = abs(y1 - y0);
+  int32_t err = dx >> 1, ystep = (y0 < y1) ? 1 : -1, xs = x0, dlen = 0;
+
+  for (; x0 <= x1; x0++)
+  {
+    dlen++;
+    err -= dy;
+    if ((err < 0) || (x0 == x1))
+    {
+      if (steep)
+        drawFastVLine(y0, xs, dlen, color);
+      else
+        drawFastHLine(xs, y0, dlen, color);
+      dlen = 0;
+      y0 += ystep;
+      xs = x0 + 1;
+      err += dx;
+    }
+  }
+}
+
+/***************************************************************************************
+** Function name:           pushImage
+** Description:             copy a 16 bit image into the canvas
+***************************************************************************************/
+void TFT_eSprite::pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, const uint16_t *data)
+{
+  if (_bpp != 16)
+  {
+    for (uint32_t j = 0; j < h; j++)
+      for (uint32_t i = 0; i < w; i++)
+        drawPixel(x + i, y + j, data[j * w + i]);
+    return;
+  }
+
+  int32_t dx = (x < 0) ? -x : 0;
+  int32_t dy = (y < 0) ? -y : 0;
+  int32_t dw = w - dx, dh = h - dy;
+  if (x + dx + dw > (int32_t)_width)
+    dw = _width - x - dx;
+  if (y + dy + dh > (int32_t)_height)
+    dh = _height - y - dy;
+  if ((!_img) || (dw < 1) || (dh < 1))
+    return;
+
+  for (int32_t j = 0; j < dh; j++)
+    memcpy((uint16_t *)(_img + (y + dy + j) * _stride) + x + dx, data + (dy + j) * w + dx, dw * 2);
+}
+
+void TFT_eSprite::pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, uint16_t *data)
+{
+  pushImage(x, y, w, h, (const uint16_t *)data);
+}
+
+/***************************************************************************************
+** Function name:           pushImage
+** Description:             copy an 8 or 4 bit indexed image into the canvas
+***************************************************************************************/
+void TFT_eSprite::pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, const uint8_t *data, const palette_t *palette)
+{
+  uint16_t line[PALETTE_LINE_PIXELS];
+  uint32_t stride = palette_stride(palette, w);
+  for (uint32_t j = 0; j < h; j++, data += stride)
+  {
+    if ((y + (int32_t)j < 0) || (y + (int32_t)j >= (int32_t)_height))
+      continue;
+    for (uint32_t k = 0; k < w; k += PALETTE_LINE_PIXELS)
+    {
+      uint32_t n = (w - k < PALETTE_LINE_PIXELS) ? w - k : PALETTE_LINE_PIXELS;
+      palette_line(palette, data, k, n, line);
+      for (uint32_t i = 0; i < n; i++)
+        line[i] = (line[i] >> 8) | (line[i] << 8); // the canvas is in CPU byte order
+      pushImage(x + k, y + j, n, 1, (const uint16_t *)line);
+    }
+  }
+}
+
+/***************************************************************************************
+** Function name:           pushSprite
+** Description:             send the canvas to the display in one windowed transfer
+***************************************************************************************/
+void TFT_eSprite::pushSprite(int32_t x, int32_t y)
+{
+  if (!_img)
+    return;
+
+  if (_bpp == 16)
+  {
+    // the canvas holds 565 colours in CPU byte order
+    bool swap = _tft->getSwapBytes();
+    _tft->setSwapBytes(true);
+    _tft->pushImage(x, y, _width, _height, (uint16_t *)_img);
+    _tft->setSwapBytes(swap);
+  }
+  else if (_bpp == 8)
+    _tft->pushImage(x, y, _width, _height, _img, true);
+  else
+  {
+    // the colours of this sprite, not the display's
+    uint32_t fg = _tft->bitmap_fg, bg = _tft->bitmap_bg;
+    _tft->setBitmapColor(bitmap_fg, bitmap_bg);
+    _tft->pushImage(x, y, _width, _height, _img, false);
+    _tft->setBitmapColor(fg, bg);
+  }
+}
+
+void TFT_eSprite::pushSprite(int32_t x, int32_t y, uint16_t transparent)
+{
+  if (!_img)
+    return;
+
+  if (_bpp == 16)
+  {
+    bool swap = _tft->getSwapBytes();
+    _tft->setSwapBytes(true);
+    _tft->pushImage(x, y, _width, _height, (uint16_t *)_img, transparent);
+    _tft->setSwapBytes(swap);
+  }
+  else if (_bpp == 8)
+    _tft->pushImage(x, y, _width, _height, _img, color16to8(transparent), true);
+  else
+  {
+    uint32_t fg = _tft->bitmap_fg, bg = _tft->bitmap_bg;
+    _tft->setBitmapColor(bitmap_fg, bitmap_bg);
+    _tft->pushImage(x, y, _width, _height, _img, (uint8_t)(transparent ? 1 : 0), false);
+    _tft->setBitmapColor(fg, bg);
+  }
+}
+
+/***************************************************************************************
+** Function name:           pushSpriteDMA
+** Description:             as pushSprite(), the canvas can be redrawn once it returns
+***************************************************************************************/
+bool TFT_eSprite::pushSpriteDMA(int32_t x, int32_t y, tft_dma_callback_t callback, void *arg)
+{
+  if ((!_img) || (_bpp == 1))
+  {
+    pushSprite(x, y);
+    if (callback)
+      callback(arg);
+    return false;
+  }
+
+  if (_bpp == 8)
+    return _tft->pushImageDMA(x, y, _width, _height, _img, palette_332(), callback, arg);
+
+  bool swap = _tft->getSwapBytes();
+  _tft->setSwapBytes(true);
+  bool ok = _tft->pushImageDMA(x, y, _width, _height, (uint16_t *)_img, callback, arg);
+  _tft->setSwapBytes(swap);
+  return ok;
+}
@@ -0,0 +1,56 @@
+/***************************************************
+ * Sprite class in the style of TFT_eSprite from
+ * https://github.com/moononournation/TFT_eSPI
+ ****************************************************/
+
+#ifndef _SPRITEH_
+#define _SPRITEH_
+
+#include "ST7789.h"
+
+// Off screen canvas with the drawing API of ST7789. Drawing only touches RAM, pushSprite()
+// then sends the whole canvas in one windowed transfer. 16 bit sprites hold 565 colours,
+// 8 bit ones 332 colours and 1 bit ones bitmap_fg for any non zero colour.
+class TFT_eSprite : public ST7789
+{
+public:
+  TFT_eSprite(ST7789 *tft);
+  ~TFT_eSprite();
+
+  void setColorDepth(int8_t bpp); // 16, 8 or 1, before createSprite()
+  int8_t getColorDepth(void);
+  void *createSprite(int16_t w, int16_t h);
+  void deleteSprite(void);
+  bool created(void);
+
+  void fillSprite(uint32_t color);
+  uint16_t readPixel(int32_t x, int32_t y);
+
+  void pushSprite(int32_t x, int32_t y);
+  void pushSprite(int32_t x, int32_t y, uint16_t transparent);
+  bool pushSpriteDMA(int32_t x, int32_t y, tft_dma_callback_t callback = NULL, void *arg = NULL);
+
+  // 16 bit image into the sprite
+  void pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, const uint16_t *data);
+  void pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, uint16_t *data);
+  // indexed image into the sprite
+  void pushImage(int32_t x, int32_t y, uint32_t w, uint32_t h, const uint8_t *data, const palette_t *palette);
+
+  void drawPixel(uint32_t x, uint32_t y, uint32_t color),
+      drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color),
+      drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color),
+      drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color),
+      fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+
+  int16_t height(void),
+      width(void);
+
+private:
+  ST7789 *_tft;
+  int8_t _bpp;
+  uint8_t *_img;    // pixels, rows of _stride bytes
+  uint32_t _stride;
+  uint32_t _capacity; // bytes allocated
+};
+
+#endif
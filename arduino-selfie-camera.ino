@@ -1,25 +1,74 @@
 #include <esp_camera.h>
 #include <SD.h>
 #include <FS.h>
+#include <Preferences.h>
+#include <time.h>
+#include <freertos/event_groups.h>
 #include <rom/tjpgd.h>
+#include <esp_timer.h>
 #include "cam.h"
 #include "ST7789.h"
+#include "Sprite.h"
 #include "tjpgdec.h"
+#include "ratectrl.h"
+#include "camframe.h"
+#include "jpgsharp.h"
+#include "sdwriter.h"
+#include "dcf.h"
+#include "exif.h"
+#include "thumbdb.h"
+#include "capfile.h"
+#include "ui.h"
 
 #define SDCARA_CS 0
-#define SNAP_QUALITY 6 // 1-63, 1 is the best
+#define BRACKET_MODE 0 // 1: take one exposure bracket instead of 3 separate snaps
+#define BRACKET_COUNT 3
+#define BRACKET_BASE_AEC 300 // 0-1200, used when the AEC registers cannot be read
+#define BRACKET_PERIOD_US 66667 // sensor period until the capture times have shown it
+#define BRACKET_MAX_FRAMES (3 * BRACKET_COUNT + CAM_FB_COUNT) // fetched before giving up
+#define OV2640_FRAME_LINES 1248 // UXGA rows with blanking, AEC counts rows
+#define CAM_FB_COUNT 2       // frame buffers, frames already in them were taken before a change
+//#define REPLAY_DIR "/sd/REPLAY" // serve recorded JPEG frames instead of the sensor
+#define REPLAY_FPS 12
+//#define SDW_BENCH_SIZE (1024 * 1024) // report SD write speed per chunk size at boot
+//#define TFT_FILL_BENCH 20 // report fillScreen speed and CPU idle time at boot
+#define BURST_MAX 3
+#define BURST_MOVE_BLURRY 0 // 1: move all but the sharpest shot of a burst to BURST_BLURRY_DIR
+#define BURST_BLURRY_DIR DCF_ROOT "/BLURRY" // keeps the DCF folder, file numbers repeat across them
+#define BURST_LOG DCF_ROOT "/BURSTS.TXT"  // a line per shot of each burst, the sharpest marked
+#define GALLERY_MS 5000     // show the latest 3x3 thumbnails before sleep, 0 to skip
+#define STORAGE_MOUNTED BIT0 // card mounted
+#define STORAGE_READY BIT1   // folders checked, writer running, next file known
+#define STORAGE_FAILED BIT2
+#define STORAGE_WAIT_MS 5000
 
 ST7789 tft = ST7789(); // Invoke library, pins defined in User_Setup.h
+TFT_eSprite bar = TFT_eSprite(&tft); // off screen title bar
+TextCache textCache;                  // labels drawn again come from here
+Preferences prefs;
 
 char tmpStr[256];
-char nextFilename[31];
-uint16_t fileIdx = 0;
+char nextFilename[DCF_PATH_SIZE];
 int i = 0;
 static uint16_t *preview;
 sensor_t *s;
 camera_fb_t *fb = NULL;
+cam_frame_t frame;
+#ifdef REPLAY_DIR
+ReplayFrameSource replay(REPLAY_DIR, REPLAY_FPS);
+#endif
 JPGIODEV dev;
+char burstFilename[BURST_MAX][DCF_PATH_SIZE];
+float burstScore[BURST_MAX];
+int burstCount = 0;
+char writeStatus[64];
+volatile bool writeStatusDirty = false;
+static const int8_t bracketEv[BRACKET_COUNT] = {-1, 0, 1};
 char *work = NULL; // Pointer to the working buffer (must be 4-byte aligned)
+EventGroupHandle_t storageEvents;
+unsigned long bootTft, bootCam, bootPreview = 0; // ms since reset
+unsigned long bootMount, bootFolder, bootIndex;
+int uiBanner, uiPreview, uiFlash, uiStatus, uiWrite;
 
 void setup()
 {
@@ -30,53 +79,75 @@ void setup()
   tft.invertDisplay(true);
   tft.setSwapBytes(true);
   tft.setRotation(0);
+  if (!tft.initDMA(200 * 150))
+    Serial.println("TFT DMA init failed, previews are pushed synchronously");
 
+#ifdef TFT_FILL_BENCH
+  fillBench(TFT_FILL_BENCH);
+#endif
   tft.fillScreen(TFT_BLACK);
   tft.setTextDatum(TL_DATUM);
-  tft.setTextSize(2);
-  tft.setTextColor(TFT_WHITE, TFT_RED);
-  tft.drawString(" ESP", 0, 0);
-  tft.setTextColor(TFT_WHITE, TFT_ORANGE);
-  tft.drawString("32 ", 48, 0);
-  tft.setTextColor(TFT_WHITE, TFT_GREEN);
-  tft.drawString(" Camera ", 82, 0);
-  tft.setTextColor(TFT_WHITE, TFT_BLUE);
-  tft.drawString(" Plus  ", 172, 0);
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
-  tft.setTextSize(1);
-
-  if (!SD.begin(SDCARA_CS))
+  tft.setTextCache(&textCache);
+  bar.setTextCache(&textCache);
+  // composed off screen and sent in one transfer
+  if (bar.createSprite(240, 16))
   {
-    tft.drawString("SD Init Fail!", 0, 208);
-    Serial.println("SD Init Fail!");
+    drawTitle(&bar);
+    bar.pushSprite(0, 0);
+    bar.deleteSprite();
   }
   else
-  {
-    snprintf(tmpStr, sizeof(tmpStr), "SD Card Type: %d Size: %lu MB", SD.cardType(), SD.cardSize() / 1024 / 1024);
-    tft.drawString(tmpStr, 0, 208);
-    Serial.println(tmpStr);
+    drawTitle(&tft);
+  tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  tft.setTextSize(1);
 
-    init_folder();
+  // everything below the title is redrawn by the UI layer, only where it changed
+  ui_begin(&tft);
+  uiBanner = ui_add(UI_TEXT, "banner", 0, 24, 240, 16);
+  ui_set_font(uiBanner, 1, 2, TC_DATUM);
+  uiPreview = ui_add(UI_IMAGE, "preview", 20, 45, 200, 150);
+  uiFlash = ui_add(UI_FILL, "flash", 20, 45, 200, 150);
+  ui_show(uiFlash, false);
+  uiStatus = ui_add(UI_TEXT, "status", 0, 208, 240, 16);
+  uiWrite = ui_add(UI_TEXT, "write", 0, 224, 240, 16);
+  ui_flush();
 
-    xTaskCreate(
-        findNextFileIdxTask,       /* Task function. */
-        "FindNextFileIdxTask", /* String with name of task. */
-        10000,                 /* Stack size in bytes. */
-        work,                  /* Parameter passed as input of the task */
-        1,                     /* Priority of the task. */
-        NULL);                 /* Task handle. */
-  }
+  bootTft = millis();
+
+  // the card comes up in the background, preview does not wait for it
+  storageEvents = xEventGroupCreate();
+  xTaskCreate(
+      storageTask,   /* Task function. */
+      "StorageTask", /* String with name of task. */
+      10000,         /* Stack size in bytes. */
+      NULL,          /* Parameter passed as input of the task */
+      1,             /* Priority of the task. */
+      NULL);         /* Task handle. */
 
-  esp_err_t err = cam_init();
-  if (err != ESP_OK)
+#ifdef REPLAY_DIR
+  // recorded frames live on the card
+  xEventGroupWaitBits(storageEvents, STORAGE_MOUNTED | STORAGE_FAILED, pdFALSE, pdFALSE, STORAGE_WAIT_MS / portTICK_PERIOD_MS);
+  if (replay.begin())
   {
-    snprintf(tmpStr, sizeof(tmpStr), "Camera init failed with error 0x%x", err);
-    tft.drawString(tmpStr, 0, 208);
+    cam_set_source(&replay);
+    snprintf(tmpStr, sizeof(tmpStr), "Replay %lu frames from %s", replay.fileCount(), REPLAY_DIR);
+    showText(uiStatus, tmpStr);
     Serial.println(tmpStr);
   }
+  else
+#endif
+  {
+    esp_err_t err = cam_init();
+    if (err != ESP_OK)
+    {
+      snprintf(tmpStr, sizeof(tmpStr), "Camera init failed with error 0x%x", err);
+      showText(uiStatus, tmpStr);
+      Serial.println(tmpStr);
+    }
+  }
 
   //drop down frame size for higher initial frame rate
-  s = esp_camera_sensor_get();
+  s = cam_get_source()->sensor();
   s->set_brightness(s, 2);
   s->set_contrast(s, 2);
   s->set_saturation(s, 2);
@@ -86,7 +157,10 @@ void setup()
   s->set_lenc(s, true);
   s->set_hmirror(s, true);
   //s->set_vflip(s, true);
-  s->set_quality(s, 63);
+  s->set_quality(s, PREVIEW_QUALITY);
+
+  rc_init(SNAP_TARGET_SIZE);
+  bootCam = millis();
 
   preview = new uint16_t[200 * 150];
   work = (char *)malloc(WORK_BUF_SIZE);
@@ -97,6 +171,67 @@ void setup()
   dev.linbuf[1] = (color_t *)heap_caps_malloc(JPG_IMAGE_LINE_BUF_SIZE * 3, MALLOC_CAP_DMA);
 }
 
+// Loop iterations until the DMA is idle ("untilIdle") or "us" have passed
+static uint32_t spinWhileBusy(bool untilIdle, unsigned long us)
+{
+  uint32_t spins = 0;
+  unsigned long t = micros();
+  for (;;)
+  {
+    spins++;
+    bool busy = tft.dmaBusy();
+    if ((micros() - t >= us) || ((untilIdle) && (!busy)))
+      return spins;
+  }
+}
+
+// fillScreen() polled and by DMA, then DMA fills with this task counting meanwhile
+// against how far it counts with the CPU to itself
+void fillBench(int runs)
+{
+  static const uint16_t colors[] = {TFT_RED, TFT_GREEN, TFT_BLUE, TFT_BLACK};
+  float mbytes = (float)tft.width() * tft.height() * 2 * runs / 1000000;
+
+  unsigned long polled = micros();
+  tft.setFillDMA(false);
+  for (int k = 0; k < runs; k++)
+    tft.fillScreen(colors[k % 4]);
+  polled = micros() - polled;
+
+  unsigned long dma = micros();
+  tft.setFillDMA(true);
+  for (int k = 0; k < runs; k++)
+    tft.fillScreen(colors[k % 4]);
+  dma = micros() - dma;
+
+  float spinsPerUs = spinWhileBusy(false, 20000) / 20000.0f;
+  uint32_t spins = 0;
+  unsigned long async = micros();
+  for (int k = 0; k < runs; k++)
+  {
+    tft.fillRectDMA(0, 0, tft.width(), tft.height(), colors[k % 4]);
+    spins += spinWhileBusy(true, 1000000);
+  }
+  async = micros() - async;
+
+  Serial.printf("Fill: polled %.1fms %.2fMB/s, DMA %.1fms %.2fMB/s, CPU idle %.0f%% during DMA fills\n",
+                polled / 1000.0f / runs, mbytes * 1000000 / polled, dma / 1000.0f / runs, mbytes * 1000000 / dma,
+                100 * spins / (spinsPerUs * async));
+}
+
+void drawTitle(ST7789 *gfx)
+{
+  gfx->setTextSize(2);
+  gfx->setTextColor(TFT_WHITE, TFT_RED);
+  gfx->drawString(" ESP", 0, 0);
+  gfx->setTextColor(TFT_WHITE, TFT_ORANGE);
+  gfx->drawString("32 ", 48, 0);
+  gfx->setTextColor(TFT_WHITE, TFT_GREEN);
+  gfx->drawString(" Camera ", 82, 0);
+  gfx->setTextColor(TFT_WHITE, TFT_BLUE);
+  gfx->drawString(" Plus  ", 172, 0);
+}
+
 esp_err_t cam_init()
 {
   camera_config_t config;
@@ -123,7 +258,7 @@ esp_err_t cam_init()
   // init with high specs to pre-allocate larger buffers
   config.frame_size = FRAMESIZE_UXGA;
   config.jpeg_quality = SNAP_QUALITY;
-  config.fb_count = 2;
+  config.fb_count = CAM_FB_COUNT;
 
   // camera init
   return esp_camera_init(&config);
@@ -131,161 +266,554 @@ esp_err_t cam_init()
 
 void init_folder()
 {
-  File file = SD.open("/DCIM");
+  File file = SD.open(DCF_ROOT);
   if (!file)
   {
-    Serial.println("Create /DCIM");
-    SD.mkdir("/DCIM");
+    Serial.println("Create " DCF_ROOT);
+    SD.mkdir(DCF_ROOT);
   }
   else
   {
-    Serial.println("Found /DCIM");
+    Serial.println("Found " DCF_ROOT);
     file.close();
   }
-  file = SD.open("/DCIM/100ESPDC");
-  if (!file)
+}
+
+// Mount the card, check the folders, start the writer and index the files
+void storageTask(void *parameter)
+{
+  if (!SD.begin(SDCARA_CS))
   {
-    Serial.println("Create /DCIM/100ESPDC");
-    SD.mkdir("/DCIM/100ESPDC");
+    Serial.println("SD Init Fail!");
+    snprintf(writeStatus, sizeof(writeStatus), "SD Init Fail!");
+    writeStatusDirty = true;
+    xEventGroupSetBits(storageEvents, STORAGE_FAILED);
+    vTaskDelete(NULL);
+    return;
   }
-  else
+  bootMount = millis();
+  xEventGroupSetBits(storageEvents, STORAGE_MOUNTED);
+
+  snprintf(writeStatus, sizeof(writeStatus), "SD Card Type: %d Size: %lu MB", SD.cardType(), (uint32_t)(SD.cardSize() / 1024 / 1024));
+  Serial.println(writeStatus);
+  writeStatusDirty = true;
+
+  init_folder();
+  sdw_begin(writeDone);
+#ifdef SDW_BENCH_SIZE
+  sdw_bench("/DCIM/BENCH.TMP", SDW_BENCH_SIZE);
+#endif
+  bootFolder = millis();
+
+  initFileIdx();
+  bootIndex = millis();
+  xEventGroupSetBits(storageEvents, STORAGE_READY);
+
+  Serial.printf("Boot: SD mount %lums, folders %lums, index %lums, ready at %lums\n",
+                bootMount - bootTft, bootFolder - bootMount, bootIndex - bootFolder, bootIndex);
+  vTaskDelete(NULL);
+}
+
+// Block until the card can take a write, only called when there is something to write
+bool waitStorage()
+{
+  EventBits_t bits = xEventGroupGetBits(storageEvents);
+  if (!(bits & (STORAGE_READY | STORAGE_FAILED)))
   {
-    Serial.println("Found /DCIM/100ESPDC");
-    file.close();
+    unsigned long t = millis();
+    showText(uiStatus, "Waiting for SD card...");
+    bits = xEventGroupWaitBits(storageEvents, STORAGE_READY | STORAGE_FAILED, pdFALSE, pdFALSE, STORAGE_WAIT_MS / portTICK_PERIOD_MS);
+    Serial.printf("Waited %lums for the SD card\n", millis() - t);
   }
+  return (bits & STORAGE_READY) != 0;
 }
 
-void findNextFileIdxTask(void *parameter)
+// Index the DCF folders, the last file written (kept in NVS) spares walking them
+void initFileIdx()
 {
+  prefs.begin("selfie-camera", false);
+  uint16_t lastFolder = prefs.getUShort("dcfFolder", 0);
+  uint16_t lastFile = prefs.getUShort("dcfFile", 0);
+
+  if (!dcf_begin(lastFolder, lastFile))
+    Serial.println("DCF: cannot list " DCF_ROOT);
+  dcf_print_index();
+
+  // only the newest files can have been cut short by a power loss, the one being
+  // written was still a temporary file past the last JPG
+  if (dcf_folder())
+  {
+    char folder[DCF_PATH_SIZE];
+    snprintf(folder, sizeof(folder), DCF_ROOT "/%03u" DCF_FOLDER_NAME, dcf_folder());
+    uint32_t fixed = capfile_recover(sdw_get_storage(), folder, DCF_FILE_NAME, dcf_file() + 1);
+    if (fixed)
+      Serial.printf("Recovered %u interrupted captures in %s\n", fixed, folder);
+  }
   findNextFileIdx();
-  vTaskDelete(NULL);
+  thumbdb_begin();
 }
 
+// The index only moves forward, no need to look at the card
 void findNextFileIdx()
-{ // TODO: revise ugly code
-  fileIdx++;
-  File file;
-  snprintf(nextFilename, sizeof(nextFilename), "/DCIM/100ESPDC/DSC%05D.JPG", fileIdx);
-  file = SD.open(nextFilename);
-  if (!file)
-  {
-    Serial.printf("Next file: %s\n", nextFilename);
+{
+  if (!dcf_next(nextFilename, sizeof(nextFilename)))
+    Serial.println("DCF: no folder for the next file");
+  Serial.printf("Next file: %s\n", nextFilename);
+}
+
+// Remember the name of a file just written, from the writer task once it is on the card
+void commitFileIdx(const char *filename)
+{
+  const char *name = strrchr(filename, '/');
+  if ((!name) || (name - filename < 8) || (strlen(name) != 13))
     return;
-  }
-  else
-  {
-    for (int k = 1000; k <= 30000; k += 1000)
-    {
-      snprintf(nextFilename, sizeof(nextFilename), "/DCIM/100ESPDC/DSC%05D.JPG", fileIdx + k);
-      file = SD.open(nextFilename);
-      if (file)
-      {
-        Serial.printf("Found %s\n", nextFilename);
-        file.close();
-      }
-      else
-      {
-        Serial.printf("Not found %s\n", nextFilename);
-        k -= 1000;
-        for (int h = 100; h <= 1000; h += 100)
-        {
-          snprintf(nextFilename, sizeof(nextFilename), "/DCIM/100ESPDC/DSC%05D.JPG", fileIdx + k + h);
-          file = SD.open(nextFilename);
-          if (file)
-          {
-            Serial.printf("Found %s\n", nextFilename);
-            file.close();
-          }
-          else
-          {
-            Serial.printf("Not found %s\n", nextFilename);
-            h -= 100;
-            for (int t = 10; t <= 100; t += 10)
-            {
-              snprintf(nextFilename, sizeof(nextFilename), "/DCIM/100ESPDC/DSC%05D.JPG", fileIdx + k + h + t);
-              file = SD.open(nextFilename);
-              if (file)
-              {
-                Serial.printf("Found %s\n", nextFilename);
-                file.close();
-              }
-              else
-              {
-                Serial.printf("Not found %s\n", nextFilename);
-                t -= 10;
-                for (int d = 1; d <= 10; d++)
-                {
-                  snprintf(nextFilename, sizeof(nextFilename), "/DCIM/100ESPDC/DSC%05D.JPG", fileIdx + k + h + t + d);
-                  file = SD.open(nextFilename);
-                  if (file)
-                  {
-                    Serial.printf("Found %s\n", nextFilename);
-                    file.close();
-                  }
-                  else
-                  {
-                    Serial.printf("Next file: %s\n", nextFilename);
-                    fileIdx += k + h + t + d;
-                    return;
-                  }
-                }
-              }
-            }
-          }
-        }
-      }
-    }
-  }
+  prefs.putUShort("dcfFolder", atoi(name - 8));
+  prefs.putUShort("dcfFile", atoi(name + 5));
 }
 
 void snap()
 {
   s->set_hmirror(s, false);
   //s->set_vflip(s, false);
-  s->set_quality(s, SNAP_QUALITY);
+  // the quality takes effect on the discarded frame, predict the capture frame 2 frames ahead
+  s->set_quality(s, rc_pick_quality(2));
 
-  tft.fillRect(20, 45, 200, 150, TFT_DARKGREY);
+  // the thumbnail comes from the last preview, encoded while the discarded frame exposes
+  size_t thumbLen = 0;
+  uint8_t *thumb = exif_make_thumbnail(preview, 200, 150, true, &thumbLen);
 
-  fb = esp_camera_fb_get();
-  esp_camera_fb_return(fb);
+  showFlash(TFT_DARKGREY);
+
+  fb = cam_frame_get(&frame, CAM_FRAME_FLUSH);
+  cam_frame_return(&frame);
   fb = NULL;
 
-  tft.fillRect(20, 45, 200, 150, TFT_LIGHTGREY);
+  showFlash(TFT_LIGHTGREY);
 
-  fb = esp_camera_fb_get();
+  fb = cam_frame_get(&frame, CAM_FRAME_SNAP);
   if (!fb)
   {
-    tft.drawString("Camera capture JPG failed", 0, 208);
+    showText(uiStatus, "Camera capture JPG failed");
     Serial.println("Camera capture JPG failed");
   }
   else
   {
-    File file = SD.open(nextFilename, FILE_WRITE);
-    if (file.write(fb->buf, fb->len))
+    rc_record_shot(fb->len);
+    rc_print_stats();
+
+    // score before the write, no decode needed
+    jpgsharp_t sharp;
+    unsigned long t = micros();
+    bool scored = jpgsharp_score(fb->buf, fb->len, &sharp);
+    t = micros() - t;
+    if (scored)
+      Serial.printf("Sharpness: %.1f, scored %luKB in %lums (%.1fMB/s)\n", sharp.score, fb->len / 1024, t / 1000, (float)fb->len / t);
+
+    // Exif header with the thumbnail, streamed in front of the frame by the writer
+    char datetime[20];
+    time_t now = time(NULL);
+    exif_info_t info = {(uint16_t)fb->width, (uint16_t)fb->height, NULL, 0, 0, 0};
+    if (now > 1600000000)
     {
-      tft.fillRect(20, 45, 200, 150, TFT_LIGHTGREY);
-      snprintf(tmpStr, sizeof(tmpStr), "File written: %luKB\n%s", fb->len / 1024, nextFilename);
-      tft.drawString(tmpStr, 0, 224);
+      strftime(datetime, sizeof(datetime), "%Y:%m:%d %H:%M:%S", localtime(&now));
+      info.datetime = datetime;
+    }
+    size_t headLen = 0;
+    uint8_t *head = exif_build(&info, thumb, thumbLen, &headLen);
+
+    // the writer task owns the frame from here, preview resumes at once
+    size_t len = fb->len;
+    fb = NULL;
+    bool ready = waitStorage();
+    if (ready)
+      thumbdb_prepare(nextFilename, preview, 200, 150, true);
+    else
+      free(head);
+    if ((ready) && (sdw_submit(nextFilename, &frame, true, head, headLen)))
+    {
+      burst_add(nextFilename, scored ? sharp.score : 0);
+      showFlash(TFT_LIGHTGREY);
+      snprintf(tmpStr, sizeof(tmpStr), "File queued: %luKB\n%s", len / 1024, nextFilename);
       Serial.println(tmpStr);
     }
     else
     {
-      tft.drawString("Write failed!", 0, 224);
+      thumbdb_commit(nextFilename, false);
+      cam_frame_return(&frame);
+      showText(uiWrite, "Write failed!");
       Serial.println("Write failed!");
     }
-    esp_camera_fb_return(fb);
-    fb = NULL;
-    file.close();
   }
 
+  free(thumb);
+
   s->set_hmirror(s, true);
   //s->set_vflip(s, true);
-  s->set_quality(s, 63);
-  fb = esp_camera_fb_get();
-  esp_camera_fb_return(fb);
+  s->set_quality(s, PREVIEW_QUALITY);
+  fb = cam_frame_get(&frame, CAM_FRAME_FLUSH);
+  cam_frame_return(&frame);
   fb = NULL;
 }
 
+// OV2640 gain register 0x00: bits 7-4 each double the gain, bits 3-0 add sixteenths
+float ov2640_gain(int reg)
+{
+  float gain = 1 + (reg & 0x0F) / 16.0f;
+  for (int bit = 4; bit < 8; bit++)
+  {
+    if (reg & (1 << bit))
+      gain *= 2;
+  }
+  return gain;
+}
+
+uint8_t ov2640_gain_reg(float gain)
+{
+  uint8_t reg = 0;
+  for (int bit = 4; (bit < 8) && (gain >= 2); bit++)
+  {
+    reg |= 1 << bit;
+    gain /= 2;
+  }
+  int frac = (gain - 1) * 16 + 0.5f;
+  return reg | ((frac < 0) ? 0 : ((frac > 15) ? 15 : frac));
+}
+
+// Metered exposure shifted by "ev" stops. What the 1-1200 AEC range cannot give goes
+// into the sensor gain, "gain" is the metered gain register or -1 when unknown.
+// Returns the AEC value written, "gainSet" gets the gain register (-1 when left alone).
+int set_bracket_exposure(int aec, int gain, int8_t ev, int *gainSet)
+{
+  float target = (ev < 0) ? (float)aec / (1 << -ev) : (float)aec * (1 << ev);
+  int value = (target > 1200) ? 1200 : ((target < 1) ? 1 : (int)target);
+  s->set_aec_value(s, value);
+  *gainSet = -1;
+  if (gain >= 0)
+  {
+    *gainSet = ov2640_gain_reg(ov2640_gain(gain) * target / value);
+    s->set_reg(s, 0x100, 0xFF, *gainSet);
+  }
+  return value;
+}
+
+// Drop frames the driver already holds, they were taken with the old settings
+void flush_frames(int count)
+{
+  while (count--)
+  {
+    if (!cam_frame_get(&frame, CAM_FRAME_FLUSH))
+      break;
+    cam_frame_return(&frame);
+  }
+}
+
+// Take BRACKET_COUNT consecutive sensor frames with different exposure. The sensor
+// latches the registers at the start of a frame, a period before its capture time. Once
+// a frame is delivered the one being captured has the last registers written, so the
+// next step is written then and lands on the frame after. Each delivered frame is matched
+// to its step by capture time, only frames exposed before the first write (or twice
+// with one step) are dropped. Frames are kept in PSRAM until the burst ends, each one
+// gets an Exif header with its own exposure.
+void bracket()
+{
+  uint8_t *bracketBuf[BRACKET_COUNT] = {NULL};
+  size_t bracketLen[BRACKET_COUNT] = {0};
+  int64_t written[BRACKET_COUNT];
+  uint32_t seq[BRACKET_COUNT];
+  int64_t captured[BRACKET_COUNT];
+  int aecSet[BRACKET_COUNT], gainSet[BRACKET_COUNT];
+  exif_info_t info[BRACKET_COUNT] = {};
+  int writes = 0, kept = 0, fetched = 0;
+
+  // what auto exposure metered, status only holds values set by hand. OV2640 sensor
+  // bank: AEC[15:10] in 0x45, AEC[9:2] in 0x10, AEC[1:0] in 0x04, gain in 0x00.
+  int aecHigh = s->get_reg(s, 0x145, 0x3F), aecMid = s->get_reg(s, 0x110, 0xFF), aecLow = s->get_reg(s, 0x104, 0x03);
+  int gain = s->get_reg(s, 0x100, 0xFF);
+  int aec = ((aecHigh < 0) || (aecMid < 0) || (aecLow < 0)) ? 0 : (aecHigh << 10) | (aecMid << 2) | aecLow;
+  if (aec <= 0)
+    aec = BRACKET_BASE_AEC;
+  float period = cam_get_stats()->sensor_period;
+  if (period <= 0)
+    period = BRACKET_PERIOD_US;
+
+  s->set_hmirror(s, false);
+  //s->set_vflip(s, false);
+  s->set_quality(s, rc_pick_quality(2));
+  // lock exposure and gain so each frame gets exactly the written value
+  s->set_gain_ctrl(s, false);
+  s->set_exposure_ctrl(s, false);
+  aecSet[writes] = set_bracket_exposure(aec, gain, bracketEv[0], &gainSet[writes]);
+  written[writes++] = esp_timer_get_time();
+
+  // one thumbnail from the last preview for the whole bracket
+  size_t thumbLen = 0;
+  uint8_t *thumb = exif_make_thumbnail(preview, 200, 150, true, &thumbLen);
+
+  showFlash(TFT_DARKGREY);
+
+  while ((kept < BRACKET_COUNT) && (fetched++ < BRACKET_MAX_FRAMES))
+  {
+    fb = cam_frame_get(&frame, CAM_FRAME_SNAP);
+    if (!fb)
+    {
+      showText(uiStatus, "Camera capture JPG failed");
+      Serial.println("Camera capture JPG failed");
+      break;
+    }
+
+    int step = -1;
+    for (int k = 0; k < writes; k++)
+    {
+      if (written[k] < frame.captured - period)
+        step = k;
+    }
+    if (step > kept)
+    {
+      // the driver dropped the frame of a step, write it again
+      writes = kept;
+      aecSet[writes] = set_bracket_exposure(aec, gain, bracketEv[kept], &gainSet[writes]);
+      written[writes++] = esp_timer_get_time();
+    }
+    else if (step == kept)
+    {
+      bracketBuf[kept] = (uint8_t *)ps_malloc(fb->len);
+      if (!bracketBuf[kept])
+      {
+        cam_frame_return(&frame);
+        fb = NULL;
+        showText(uiStatus, "PSRAM alloc failed!");
+        Serial.println("PSRAM alloc failed!");
+        break;
+      }
+      memcpy(bracketBuf[kept], fb->buf, fb->len);
+      bracketLen[kept] = fb->len;
+      seq[kept] = frame.seq;
+      captured[kept] = frame.captured;
+      info[kept].width = fb->width;
+      info[kept].height = fb->height;
+      info[kept].exposure_us = aecSet[kept] * period / OV2640_FRAME_LINES;
+      info[kept].iso = (gainSet[kept] < 0) ? 0 : 100 * ov2640_gain(gainSet[kept]);
+      info[kept].ev_bias = bracketEv[kept];
+      if (bracketEv[kept] == 0)
+        rc_record_shot(fb->len);
+      if (!kept)
+        showFlash(TFT_LIGHTGREY);
+      kept++;
+    }
+    if ((writes < BRACKET_COUNT) && (frame.captured > written[writes - 1]))
+    {
+      aecSet[writes] = set_bracket_exposure(aec, gain, bracketEv[writes], &gainSet[writes]);
+      written[writes++] = esp_timer_get_time();
+    }
+    cam_frame_return(&frame);
+    fb = NULL;
+  }
+
+  // delivered one after the other and a sensor period apart
+  bool consecutive = kept == BRACKET_COUNT;
+  for (int k = 1; k < kept; k++)
+  {
+    if ((seq[k] != seq[k - 1] + 1) || (captured[k] - captured[k - 1] > 1.5f * period))
+      consecutive = false;
+  }
+  Serial.printf("Bracket: %d of %d frames from %d fetched, %s\n", kept, BRACKET_COUNT, fetched,
+                consecutive ? "consecutive" : "not consecutive");
+
+  s->set_exposure_ctrl(s, true);
+  s->set_gain_ctrl(s, true);
+  s->set_hmirror(s, true);
+  //s->set_vflip(s, true);
+  s->set_quality(s, PREVIEW_QUALITY);
+
+  char datetime[20];
+  time_t now = time(NULL);
+  if (now > 1600000000)
+    strftime(datetime, sizeof(datetime), "%Y:%m:%d %H:%M:%S", localtime(&now));
+
+  bool ready = waitStorage();
+  for (int k = 0; k < BRACKET_COUNT; k++)
+  {
+    if (!bracketBuf[k])
+      break;
+    if ((ready) && (k > 0))
+      findNextFileIdx();
+
+    size_t headLen = 0;
+    uint8_t *head = NULL;
+    if (ready)
+    {
+      info[k].datetime = (now > 1600000000) ? datetime : NULL;
+      head = exif_build(&info[k], thumb, thumbLen, &headLen);
+      thumbdb_prepare(nextFilename, preview, 200, 150, true);
+    }
+    if ((ready) && (sdw_submit_buf(nextFilename, bracketBuf[k], bracketLen[k], head, headLen)))
+    {
+      snprintf(tmpStr, sizeof(tmpStr), "File queued: %luKB %+dEV\n%s", bracketLen[k] / 1024, bracketEv[k], nextFilename);
+      Serial.println(tmpStr);
+    }
+    else
+    {
+      thumbdb_commit(nextFilename, false);
+      free(bracketBuf[k]);
+      showText(uiWrite, "Write failed!");
+      Serial.println("Write failed!");
+    }
+  }
+  free(thumb);
+  rc_print_stats();
+
+  flush_frames(1);
+}
+
+// Called by the SD writer task, loop() shows the status
+void writeDone(const char *filename, size_t len, bool ok, uint32_t write_us)
+{
+  if (ok)
+  {
+    commitFileIdx(filename);
+    snprintf(writeStatus, sizeof(writeStatus), "File written: %luKB %lums\n%s", len / 1024, write_us / 1000, filename);
+  }
+  else
+    snprintf(writeStatus, sizeof(writeStatus), "Write failed!\n%s", filename);
+  Serial.println(writeStatus);
+  writeStatusDirty = true;
+  thumbdb_commit(filename, ok);
+}
+
+void burst_add(const char *filename, float score)
+{
+  if (burstCount < BURST_MAX)
+  {
+    strcpy(burstFilename[burstCount], filename);
+    burstScore[burstCount] = score;
+    burstCount++;
+  }
+}
+
+// "/DCIM/100ESPDC/DSC_0012.JPG" to "/DCIM/BLURRY/100ESPDC/DSC_0012.JPG". Nothing is
+// overwritten, a file already there keeps the shot where it is.
+bool burst_move(const char *path, char *moved, size_t size)
+{
+  const char *folder = path + strlen(DCF_ROOT);
+  const char *name = strrchr(path, '/');
+  if ((strncmp(path, DCF_ROOT "/", strlen(DCF_ROOT) + 1) != 0) || (name <= folder))
+    return false;
+  snprintf(moved, size, BURST_BLURRY_DIR "%.*s", (int)(name - folder), folder);
+  SD.mkdir(BURST_BLURRY_DIR);
+  SD.mkdir(moved);
+  snprintf(moved, size, BURST_BLURRY_DIR "%s", folder);
+  if ((SD.exists(moved)) || (!SD.rename(path, moved)))
+  {
+    Serial.printf("Could not move %s to %s\n", path, moved);
+    return false;
+  }
+  Serial.printf("Moved %s to %s\n", path, moved);
+  thumbdb_remove(path);
+  return true;
+}
+
+// Tag the sharpest shot of the burst in BURST_LOG and return its filename
+const char *burst_select()
+{
+  sdw_wait_idle();
+
+  if (!burstCount)
+    return nextFilename;
+
+  int best = 0;
+  for (int k = 1; k < burstCount; k++)
+  {
+    if (burstScore[k] > burstScore[best])
+      best = k;
+  }
+  snprintf(tmpStr, sizeof(tmpStr), "Sharpest: %s (%.1f)", burstFilename[best], burstScore[best]);
+  showText(uiStatus, tmpStr);
+  Serial.println(tmpStr);
+
+  File log = SD.open(BURST_LOG, FILE_APPEND);
+  for (int k = 0; k < burstCount; k++)
+  {
+    const char *path = burstFilename[k];
+#if BURST_MOVE_BLURRY
+    char moved[48];
+    if ((k != best) && (burst_move(burstFilename[k], moved, sizeof(moved))))
+      path = moved;
+#endif
+    int len = snprintf(tmpStr, sizeof(tmpStr), "%s %.1f%s\n", path, burstScore[k], (k == best) ? " sharpest" : "");
+    if (log)
+      log.write((const uint8_t *)tmpStr, len);
+  }
+  if (log)
+  {
+    log.write((const uint8_t *)"\n", 1);
+    log.close();
+  }
+  else
+    Serial.println("Could not open " BURST_LOG);
+
+  burstCount = 0;
+  return burstFilename[best];
+}
+
+// Latest 3x3 page of the thumbnail database, read in one go unless records of removed
+// shots are in between
+void gallery()
+{
+  if (!waitStorage())
+    return;
+  unsigned long t = millis();
+  thumbdb_sync();
+  uint32_t count = thumbdb_count();
+  uint32_t first = thumbdb_newest(9);
+  uint8_t *page = (uint8_t *)ps_malloc(9 * THUMBDB_RECORD_SIZE);
+  if (!page)
+    return;
+
+  tft.fillRect(0, 24, 240, 180, TFT_BLACK);
+  uint32_t shown = 0;
+  for (uint32_t pos = first; (pos < count) && (shown < 9);)
+  {
+    uint32_t n = thumbdb_read(pos, 9, page);
+    if (!n)
+      break;
+    for (uint32_t k = 0; (k < n) && (shown < 9); k++)
+    {
+      thumbdb_record_t *record = (thumbdb_record_t *)(page + k * THUMBDB_RECORD_SIZE);
+      if (!record->folder)
+        continue;
+      tft.pushRect((shown % 3) * THUMBDB_WIDTH, 24 + (shown / 3) * THUMBDB_HEIGHT, THUMBDB_WIDTH, THUMBDB_HEIGHT, record->pixels);
+      shown++;
+    }
+    pos += n;
+  }
+  free(page);
+
+  snprintf(tmpStr, sizeof(tmpStr), "Gallery: %lu of %lu in %lums", shown, thumbdb_live(), millis() - t);
+  showText(uiStatus, tmpStr);
+  Serial.println(tmpStr);
+}
+
+void showText(int id, const char *text)
+{
+  ui_set_text(id, text);
+  ui_flush();
+}
+
+// Grey over the preview while the shutter is busy
+void showFlash(uint16_t color)
+{
+  ui_set_colors(uiFlash, TFT_WHITE, color);
+  ui_show(uiFlash, true);
+  ui_flush();
+}
+
+void showPreview()
+{
+  ui_show(uiFlash, false);
+  ui_set_image(uiPreview, preview);
+  ui_flush();
+}
+
 void enterSleep()
 {
   tft.end();
@@ -294,74 +822,99 @@ void enterSleep()
 
 void loop()
 {
+  if (writeStatusDirty)
+  {
+    writeStatusDirty = false;
+    showText(uiWrite, writeStatus);
+  }
+
   if (i == 1) // count down
   {
-    tft.setTextSize(2);
-    tft.drawString("3", 116, 24);
+    showText(uiBanner, "3");
     Serial.println("3");
   }
   else if (i == 5)
   {
-    tft.setTextSize(2);
-    tft.drawString("2", 116, 24);
+    showText(uiBanner, "2");
     Serial.println("2");
   }
   else if (i == 9)
   {
-    tft.setTextSize(2);
-    tft.drawString("1", 116, 24);
+    showText(uiBanner, "1");
     Serial.println("1");
   }
   else if (i == 13) // start snap 
   {
-    tft.setTextSize(2);
-    tft.drawString("Cheeze!", 92, 24);
+    showText(uiBanner, "Cheeze!");
     Serial.println("Cheeze!");
 
+#if BRACKET_MODE
+    bracket();
+#else
     snap();
+#endif
   }
+#if !BRACKET_MODE
   else if (i == 15)
   {
-    tft.setTextSize(2);
-    tft.drawString("Cheeze!!", 92, 24);
+    showText(uiBanner, "Cheeze!!");
     Serial.println("Cheeze!!");
 
-    findNextFileIdx();
+    if (waitStorage())
+      findNextFileIdx();
     snap();
   }
+#endif
   else if (i == 17)
   {
-    tft.setTextSize(2);
-    tft.drawString("Cheeze!!!", 92, 24);
+    showText(uiBanner, "Cheeze!!!");
     Serial.println("Cheeze!!!");
 
-    findNextFileIdx();
+#if !BRACKET_MODE
+    if (waitStorage())
+      findNextFileIdx();
     snap();
+#endif
 
-    tft.setTextSize(2);
-    tft.drawString("Reset to snap again!", 0, 24);
+    showText(uiBanner, "Reset to snap again!");
     Serial.println("Reset to snap again!");
 
-    decodeJpegFile(nextFilename, 3);
-    tft.pushRect(20, 45, 200, 150, preview);
+    decodeJpegThumb(burst_select());
+    showPreview();
     delay(5000);
+#if GALLERY_MS
+    gallery();
+    delay(GALLERY_MS);
+#endif
+    cam_print_stats();
+    sdw_print_stats();
+    ui_print_stats();
+    Serial.printf("Text cache: %.0f%% of %lu lookups hit, %u entries, %luB of %luB\n", 100 * textCache.hitRate(),
+                  textCache.stats()->lookups, textCache.entries(), textCache.bytes(), textCache.budget());
     Serial.println("Enter deep sleep...");
     enterSleep();
   }
   else
   {
-    fb = esp_camera_fb_get();
+    fb = cam_frame_get(&frame);
     if (!fb)
     {
       Serial.printf("Camera capture failed!");
-      tft.drawString("Camera capture failed!", 0, 224);
+      showText(uiWrite, "Camera capture failed!");
     }
     else
     {
+      rc_observe_preview(fb->len);
       decodeJpegBuff(fb->buf, fb->len, 3);
-      tft.pushRect(20, 45, 200, 150, preview);
-      esp_camera_fb_return(fb);
+      // returns once copied, the next frame is fetched and decoded while it streams
+      showPreview();
+      cam_frame_return(&frame);
       fb = NULL;
+      if (!bootPreview)
+      {
+        bootPreview = millis();
+        Serial.printf("Boot: tft %lums, camera %lums, first preview at %lums\n", bootTft, bootCam - bootTft, bootPreview);
+      }
     }
   }
 
@@ -435,19 +988,27 @@ static UINT tjd_output(
   {
     for (int x = rect->left; x <= rect->right; x++)
     {
-      preview[y * 200 + x] = tft.color565(*(src++), *(src++), *(src++));
+      preview[(y + dev.y) * 200 + x + dev.x] = tft.color565(*(src++), *(src++), *(src++));
     }
   }
   return 1; // Continue to decompression
 }
 
 void decodeJpegBuff(uint8_t arrayname[], uint32_t array_size, uint8_t scale)
+{
+  decodeJpegBuffAt(arrayname, array_size, scale, 0, 0);
+}
+
+// Decode into the preview buffer at x, y
+void decodeJpegBuffAt(uint8_t arrayname[], uint32_t array_size, uint8_t scale, int x, int y)
 {
   JDEC jd; // Decompression object (70 bytes)
   JRESULT rc;
 
   //dev.fhndl = NULL;
   // image from buffer
+  dev.x = x;
+  dev.y = y;
   dev.membuff = arrayname;
   dev.bufsize = array_size;
   dev.bufptr = 0;
@@ -466,11 +1027,13 @@ void decodeJpegBuff(uint8_t arrayname[], uint32_t array_size, uint8_t scale)
   }
 }
 
-void decodeJpegFile(char filename[], uint8_t scale)
+void decodeJpegFile(const char *filename, uint8_t scale)
 {
   JDEC jd; // Decompression object (70 bytes)
   JRESULT rc;
 
+  dev.x = 0;
+  dev.y = 0;
   dev.f = SD.open(filename);
   // image from buffer
   //dev.membuff = null;
@@ -490,3 +1053,33 @@ void decodeJpegFile(char filename[], uint8_t scale)
     }
   }
 }
+
+// Show the Exif thumbnail of a file centred in the preview, the full image is only
+// decoded when there is none
+void decodeJpegThumb(const char *filename)
+{
+  uint8_t marker[6];
+  File file = SD.open(filename);
+  if ((file) && (file.read(marker, 6) == 6) && (marker[2] == 0xFF) && (marker[3] == 0xE1))
+  {
+    size_t len = ((marker[4] << 8) | marker[5]) + 2;
+    uint8_t *app1 = (uint8_t *)ps_malloc(len + 2); // the input callback reads 2 bytes ahead
+    uint32_t offset, thumbLen;
+    if (app1)
+    {
+      memcpy(app1, marker + 2, 4);
+      if ((file.read(app1 + 4, len - 4) == len - 4) && (exif_find_thumbnail(app1, len, &offset, &thumbLen)))
+      {
+        file.close();
+        memset(preview, 0, 200 * 150 * 2);
+        decodeJpegBuffAt(app1 + offset, thumbLen, 0, (200 - EXIF_THUMB_WIDTH) / 2, (150 - EXIF_THUMB_HEIGHT) / 2);
+        free(app1);
+        return;
+      }
+      free(app1);
+    }
+  }
+  if (file)
+    file.close();
+  decodeJpegFile(filename, 3);
+}
@@ -0,0 +1,161 @@
+/***************************************************************************************
+** Power loss during a capture save: the save path of capfile.cpp is run once for every
+** card operation it does, with the power lost at that operation (a write then only gets
+** half its data through). Recovery then runs as it does at the next boot, and the card
+** must hold either the complete new capture or none of it, with the previous capture
+** untouched and no temporary file left over.
+**
+** g++ -O2 -I.. -o commit_bench commit_bench.cpp ../storage.cpp ../capfile.cpp
+** ./commit_bench [-o dir] [capture size in KB]
+***************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "storage.h"
+#include "capfile.h"
+
+#define BENCH_CHUNK 8192 // SDW_CHUNK_SIZE
+#define BENCH_FOLDER "/DCIM/100ESPDC"
+#define BENCH_PREFIX "DSC_"
+#define BENCH_OLD BENCH_FOLDER "/DSC_0001.JPG"
+#define BENCH_NEW BENCH_FOLDER "/DSC_0002.JPG"
+
+static void make_capture(uint8_t *buf, size_t len, uint32_t seed)
+{
+  srand(seed);
+  for (size_t k = 0; k < len; k++)
+    buf[k] = rand();
+  buf[0] = 0xFF;
+  buf[1] = 0xD8;
+  buf[len - 2] = 0xFF;
+  buf[len - 1] = 0xD9;
+}
+
+static void reset_card(Storage *storage)
+{
+  const char *names[] = {BENCH_OLD, BENCH_NEW, BENCH_FOLDER "/DSC_0001.TMP", BENCH_FOLDER "/DSC_0002.TMP", BENCH_FOLDER "/DSC_0002.BAD"};
+  for (size_t k = 0; k < sizeof(names) / sizeof(names[0]); k++)
+    storage->remove(names[k]);
+  storage->mkdir("/DCIM");
+  storage->mkdir(BENCH_FOLDER);
+}
+
+// True when "path" holds exactly "data" followed by a matching footer
+static bool same_capture(Storage *storage, const char *path, const uint8_t *data, size_t len)
+{
+  size_t size;
+  if ((!storage->exists(path, &size)) || (size != len + sizeof(capfile_footer_t)))
+    return false;
+  uint8_t *back = (uint8_t *)malloc(size);
+  int fd = storage->open(path, O_RDONLY);
+  bool ok = (fd >= 0) && (storage->read(fd, back, size) == (ssize_t)size);
+  if (fd >= 0)
+    storage->close(fd);
+
+  capfile_footer_t footer;
+  memcpy(&footer, back + len, sizeof(footer));
+  ok = ok && (memcmp(back, data, len) == 0) && (footer.magic == CAPFILE_MAGIC) && (footer.length == len) &&
+       (footer.crc == capfile_crc32(0, back, len));
+  free(back);
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  const char *out = "/tmp/commit_bench";
+  size_t len = 300 * 1024;
+
+  for (int k = 1; k < argc; k++)
+  {
+    if ((strcmp(argv[k], "-o") == 0) && (k + 1 < argc))
+      out = argv[++k];
+    else
+      len = strtoul(argv[k], NULL, 10) * 1024;
+  }
+  if (len < 4)
+  {
+    printf("Usage: %s [-o dir] [capture size in KB]\n", argv[0]);
+    return 1;
+  }
+  mkdir(out, 0777);
+
+  uint8_t *oldData = (uint8_t *)malloc(len);
+  uint8_t *newData = (uint8_t *)malloc(len);
+  make_capture(oldData, len, 1);
+  make_capture(newData, len, 2);
+
+  // a clean save gives the number of operations to cut
+  PosixStorage storage(out);
+  reset_card(&storage);
+  capfile_write(&storage, BENCH_OLD, NULL, 0, oldData, len, BENCH_CHUNK);
+  storage.resetStats();
+  if (!capfile_write(&storage, BENCH_NEW, NULL, 0, newData, len, BENCH_CHUNK))
+  {
+    printf("Clean save failed in %s\n", out);
+    return 1;
+  }
+  uint32_t ops = 0;
+  for (int op = 0; op < STORAGE_OPS; op++)
+    ops += storage.stats()->ops[op];
+  printf("%zuKB capture, %u card operations per save\n", len / 1024, ops);
+
+  // an existing capture is never replaced
+  if ((capfile_write(&storage, BENCH_OLD, NULL, 0, newData, len, BENCH_CHUNK)) || (!same_capture(&storage, BENCH_OLD, oldData, len)))
+  {
+    printf("FAIL a save replaced %s\n", BENCH_OLD);
+    return 1;
+  }
+  // a flipped bit passes the footer check but not the CRC
+  int fd = storage.open(BENCH_NEW, O_WRONLY);
+  uint8_t flipped = newData[len / 2] ^ 0x10;
+  if ((fd < 0) || (storage.seek(fd, len / 2, SEEK_SET) < 0) || (storage.write(fd, &flipped, 1) != 1))
+    return 1;
+  storage.close(fd);
+  if ((capfile_check(&storage, BENCH_NEW) != CAPFILE_OK) || (capfile_check(&storage, BENCH_NEW, true) != CAPFILE_BAD))
+  {
+    printf("FAIL CRC check missed a flipped bit\n");
+    return 1;
+  }
+  printf("Existing capture kept, flipped bit found\n\n");
+  printf("%4s %-5s %-6s %-9s %5s %s\n", "cut", "lost", "saved", "after", "fixed", "result");
+
+  uint32_t failures = 0;
+  for (uint32_t cut = 1; cut <= ops + 1; cut++)
+  {
+    PosixStorage card(out);
+    reset_card(&card);
+    capfile_write(&card, BENCH_OLD, NULL, 0, oldData, len, BENCH_CHUNK);
+
+    card.setFault(cut);
+    bool saved = capfile_write(&card, BENCH_NEW, NULL, 0, newData, len, BENCH_CHUNK);
+    bool lost = card.powerLost();
+
+    // next boot
+    PosixStorage boot(out);
+    uint32_t fixed = capfile_recover(&boot, BENCH_FOLDER, BENCH_PREFIX, 2);
+    capfile_state_t state = capfile_check(&boot, BENCH_NEW);
+
+    const char *result = "ok";
+    if (!same_capture(&boot, BENCH_OLD, oldData, len))
+      result = "FAIL previous capture damaged";
+    else if (boot.exists(BENCH_FOLDER "/DSC_0002.TMP"))
+      result = "FAIL temporary file left";
+    else if ((state != CAPFILE_MISSING) && (!same_capture(&boot, BENCH_NEW, newData, len)))
+      result = "FAIL partial capture";
+    else if ((saved) && (state == CAPFILE_MISSING))
+      result = "FAIL reported saved but missing";
+    if (strcmp(result, "ok") != 0)
+      failures++;
+
+    printf("%4u %-5s %-6s %-9s %5u %s\n", cut, lost ? "yes" : "no", saved ? "yes" : "no",
+           (state == CAPFILE_MISSING) ? "missing" : "complete", fixed, result);
+  }
+
+  printf("\n%u cut points, %u failures\n", ops + 1, failures);
+  free(oldData);
+  free(newData);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,493 @@
+/***************************************************************************************
+** Record/replay against direct drawing. Each scene is drawn with the primitive calls the
+** ST7789 shape and text functions make, once sending every primitive as it comes and
+** once through a DisplayList replayed in one transaction. Both go to the panel model of
+** panelmodel.h, and the two pictures must come out the same.
+**
+** g++ -O2 -I.. -o displaylist_bench displaylist_bench.cpp ../displaylist.cpp
+** ./displaylist_bench [list capacity]
+***************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "displaylist.h"
+#include "panelmodel.h"
+
+#define BENCH_REPS 20
+
+// The drawing side: primitives go to the panel or into the list
+class Gfx
+{
+public:
+  Panel *panel;
+  DisplayList *dl;
+  uint32_t primitives;
+  double optimizeUs;
+
+  Gfx(Panel *p, DisplayList *list) : panel(p), dl(list), primitives(0), optimizeUs(0), inShape(false) {}
+
+  void fillRect(int x, int y, int w, int h, uint16_t color)
+  {
+    if (x < 0)
+    {
+      w += x;
+      x = 0;
+    }
+    if (y < 0)
+    {
+      h += y;
+      y = 0;
+    }
+    if (x + w > BENCH_W)
+      w = BENCH_W - x;
+    if (y + h > BENCH_H)
+      h = BENCH_H - y;
+    if ((w < 1) || (h < 1))
+      return;
+
+    primitives++;
+    if (dl)
+    {
+      if (!dl->add(x, y, w, h, color))
+      {
+        flush();
+        dl->add(x, y, w, h, color);
+      }
+      return;
+    }
+    // outside a shape every primitive is a transaction of its own
+    if (!inShape)
+      panel->begin();
+    panel->window(x, y, x + w - 1, y + h - 1);
+    panel->block(color, w * h);
+  }
+
+  void drawPixel(int x, int y, uint16_t color) { fillRect(x, y, 1, 1, color); }
+  void drawFastHLine(int x, int y, int w, uint16_t color) { fillRect(x, y, w, 1, color); }
+  void drawFastVLine(int x, int y, int h, uint16_t color) { fillRect(x, y, 1, h, color); }
+
+  // spi_begin(); inTransaction = true; ... in the shape functions
+  void beginShape()
+  {
+    if ((!dl) && (!inShape))
+      panel->begin();
+    inShape = true;
+  }
+
+  void endShape()
+  {
+    inShape = false;
+  }
+
+  void flush()
+  {
+    if ((!dl) || (!dl->count()))
+      return;
+    double t = now_us();
+    dl->optimize();
+    optimizeUs += now_us() - t;
+
+    panel->begin();
+    const dl_cmd_t *cmd = dl->cmds();
+    for (uint16_t k = 0; k < dl->count(); k++)
+    {
+      panel->window(cmd[k].x, cmd[k].y, cmd[k].x + cmd[k].w - 1, cmd[k].y + cmd[k].h - 1);
+      panel->block(cmd[k].color, cmd[k].w * cmd[k].h);
+    }
+    dl->replayed();
+    dl->clear();
+  }
+
+  // The shapes below follow ST7789.cpp call for call
+
+  void drawCircle(int x0, int y0, int r, uint16_t color)
+  {
+    int x = 0, dx = 1, dy = r + r, p = -(r >> 1);
+    beginShape();
+    drawPixel(x0 + r, y0, color);
+    drawPixel(x0 - r, y0, color);
+    drawPixel(x0, y0 - r, color);
+    drawPixel(x0, y0 + r, color);
+    while (x < r)
+    {
+      if (p >= 0)
+      {
+        dy -= 2;
+        p -= dy;
+        r--;
+      }
+      dx += 2;
+      p += dx;
+      x++;
+      drawPixel(x0 + x, y0 + r, color);
+      drawPixel(x0 - x, y0 + r, color);
+      drawPixel(x0 - x, y0 - r, color);
+      drawPixel(x0 + x, y0 - r, color);
+      drawPixel(x0 + r, y0 + x, color);
+      drawPixel(x0 - r, y0 + x, color);
+      drawPixel(x0 - r, y0 - x, color);
+      drawPixel(x0 + r, y0 - x, color);
+    }
+    endShape();
+  }
+
+  void fillCircle(int x0, int y0, int r, uint16_t color)
+  {
+    int x = 0, dx = 1, dy = r + r, p = -(r >> 1);
+    beginShape();
+    drawFastHLine(x0 - r, y0, dy + 1, color);
+    while (x < r)
+    {
+      if (p >= 0)
+      {
+        dy -= 2;
+        p -= dy;
+        r--;
+      }
+      dx += 2;
+      p += dx;
+      x++;
+      drawFastHLine(x0 - r, y0 + x, 2 * r + 1, color);
+      drawFastHLine(x0 - r, y0 - x, 2 * r + 1, color);
+      drawFastHLine(x0 - x, y0 + r, 2 * x + 1, color);
+      drawFastHLine(x0 - x, y0 - r, 2 * x + 1, color);
+    }
+    endShape();
+  }
+
+  void drawCircleHelper(int x0, int y0, int r, uint8_t corner, uint16_t color)
+  {
+    int f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0;
+    while (x < r)
+    {
+      if (f >= 0)
+      {
+        r--;
+        ddF_y += 2;
+        f += ddF_y;
+      }
+      x++;
+      ddF_x += 2;
+      f += ddF_x;
+      if (corner & 0x4)
+      {
+        drawPixel(x0 + x, y0 + r, color);
+        drawPixel(x0 + r, y0 + x, color);
+      }
+      if (corner & 0x2)
+      {
+        drawPixel(x0 + x, y0 - r, color);
+        drawPixel(x0 + r, y0 - x, color);
+      }
+      if (corner & 0x8)
+      {
+        drawPixel(x0 - r, y0 + x, color);
+        drawPixel(x0 - x, y0 + r, color);
+      }
+      if (corner & 0x1)
+      {
+        drawPixel(x0 - r, y0 - x, color);
+        drawPixel(x0 - x, y0 - r, color);
+      }
+    }
+  }
+
+  void fillCircleHelper(int x0, int y0, int r, uint8_t corner, int delta, uint16_t color)
+  {
+    int f = 1 - r, ddF_x = 1, ddF_y = -r - r, y = 0;
+    delta++;
+    while (y < r)
+    {
+      if (f >= 0)
+      {
+        r--;
+        ddF_y += 2;
+        f += ddF_y;
+      }
+      y++;
+      ddF_x += 2;
+      f += ddF_x;
+      if (corner & 0x1)
+      {
+        drawFastHLine(x0 - r, y0 + y, r + r + delta, color);
+        drawFastHLine(x0 - y, y0 + r, y + y + delta, color);
+      }
+      if (corner & 0x2)
+      {
+        drawFastHLine(x0 - r, y0 - y, r + r + delta, color);
+        drawFastHLine(x0 - y, y0 - r, y + y + delta, color);
+      }
+    }
+  }
+
+  void drawRoundRect(int x, int y, int w, int h, int r, uint16_t color)
+  {
+    beginShape();
+    drawFastHLine(x + r, y, w - r - r, color);
+    drawFastHLine(x + r, y + h - 1, w - r - r, color);
+    drawFastVLine(x, y + r, h - r - r, color);
+    drawFastVLine(x + w - 1, y + r, h - r - r, color);
+    drawCircleHelper(x + r, y + r, r, 1, color);
+    drawCircleHelper(x + w - r - 1, y + r, r, 2, color);
+    drawCircleHelper(x + w - r - 1, y + h - r - 1, r, 4, color);
+    drawCircleHelper(x + r, y + h - r - 1, r, 8, color);
+    endShape();
+  }
+
+  void fillRoundRect(int x, int y, int w, int h, int r, uint16_t color)
+  {
+    beginShape();
+    fillRect(x, y + r, w, h - r - r, color);
+    fillCircleHelper(x + r, y + h - r - 1, r, 1, w - r - r - 1, color);
+    fillCircleHelper(x + r, y + r, r, 2, w - r - r - 1, color);
+    endShape();
+  }
+
+  void drawLine(int x0, int y0, int x1, int y1, uint16_t color)
+  {
+    beginShape();
+    bool steep = abs(y1 - y0) > abs(x1 - x0);
+    if (steep)
+    {
+      int t = x0;
+      x0 = y0;
+      y0 = t;
+      t = x1;
+      x1 = y1;
+      y1 = t;
+    }
+    if (x0 > x1)
+    {
+      int t = x0;
+      x0 = x1;
+      x1 = t;
+      t = y0;
+      y0 = y1;
+      y1 = t;
+    }
+    int dx = x1 - x0, dy = abs(y1 - y0);
+    int err = dx >> 1, ystep = (y0 < y1) ? 1 : -1, xs = x0, dlen = 0;
+    for (; x0 <= x1; x0++)
+    {
+      dlen++;
+      err -= dy;
+      if (err < 0)
+      {
+        err += dx;
+        if (steep)
+        {
+          if (dlen == 1)
+            drawPixel(y0, xs, color);
+          else
+            drawFastVLine(y0, xs, dlen, color);
+        }
+        else
+        {
+          if (dlen == 1)
+            drawPixel(xs, y0, color);
+          else
+            drawFastHLine(xs, y0, dlen, color);
+        }
+        dlen = 0;
+        y0 += ystep;
+        xs = x0 + 1;
+      }
+    }
+    if (dlen)
+    {
+      if (steep)
+        drawFastVLine(y0, xs, dlen, color);
+      else
+        drawFastHLine(xs, y0, dlen, color);
+    }
+    endShape();
+  }
+
+  // GLCD font, transparent background
+  void drawString(const char *s, int x, int y, uint8_t size, uint16_t color);
+
+private:
+  bool inShape;
+};
+
+// The glyphs of the bench strings, from glcdfont.h
+static const struct
+{
+  char c;
+  uint8_t cols[5];
+} glyphs[] = {
+    {' ', {0x00, 0x00, 0x00, 0x00, 0x00}},
+    {'!', {0x00, 0x00, 0x5F, 0x00, 0x00}},
+    {'(', {0x00, 0x1C, 0x22, 0x41, 0x00}},
+    {')', {0x00, 0x41, 0x22, 0x1C, 0x00}},
+    {'.', {0x00, 0x00, 0x60, 0x60, 0x00}},
+    {'0', {0x3E, 0x51, 0x49, 0x45, 0x3E}},
+    {'1', {0x00, 0x42, 0x7F, 0x40, 0x00}},
+    {'2', {0x72, 0x49, 0x49, 0x49, 0x46}},
+    {'3', {0x21, 0x41, 0x49, 0x4D, 0x33}},
+    {'4', {0x18, 0x14, 0x12, 0x7F, 0x10}},
+    {'5', {0x27, 0x45, 0x45, 0x45, 0x39}},
+    {'8', {0x36, 0x49, 0x49, 0x49, 0x36}},
+    {':', {0x00, 0x00, 0x14, 0x00, 0x00}},
+    {'B', {0x7F, 0x49, 0x49, 0x49, 0x36}},
+    {'C', {0x3E, 0x41, 0x41, 0x41, 0x22}},
+    {'D', {0x7F, 0x41, 0x41, 0x41, 0x3E}},
+    {'F', {0x7F, 0x09, 0x09, 0x09, 0x01}},
+    {'G', {0x3E, 0x41, 0x41, 0x51, 0x73}},
+    {'J', {0x20, 0x40, 0x41, 0x3F, 0x01}},
+    {'K', {0x7F, 0x08, 0x14, 0x22, 0x41}},
+    {'P', {0x7F, 0x09, 0x09, 0x09, 0x06}},
+    {'R', {0x7F, 0x09, 0x19, 0x29, 0x46}},
+    {'S', {0x26, 0x49, 0x49, 0x49, 0x32}},
+    {'_', {0x40, 0x40, 0x40, 0x40, 0x40}},
+    {'a', {0x20, 0x54, 0x54, 0x78, 0x40}},
+    {'e', {0x38, 0x54, 0x54, 0x54, 0x18}},
+    {'g', {0x18, 0xA4, 0xA4, 0x9C, 0x78}},
+    {'h', {0x7F, 0x08, 0x04, 0x04, 0x78}},
+    {'i', {0x00, 0x44, 0x7D, 0x40, 0x00}},
+    {'l', {0x00, 0x41, 0x7F, 0x40, 0x00}},
+    {'m', {0x7C, 0x04, 0x78, 0x04, 0x78}},
+    {'n', {0x7C, 0x08, 0x04, 0x04, 0x78}},
+    {'o', {0x38, 0x44, 0x44, 0x44, 0x38}},
+    {'p', {0xFC, 0x18, 0x24, 0x24, 0x18}},
+    {'r', {0x7C, 0x08, 0x04, 0x04, 0x08}},
+    {'s', {0x48, 0x54, 0x54, 0x54, 0x24}},
+    {'t', {0x04, 0x04, 0x3F, 0x44, 0x24}},
+    {'w', {0x3C, 0x40, 0x30, 0x40, 0x3C}},
+    {'z', {0x44, 0x64, 0x54, 0x4C, 0x44}},
+};
+
+void Gfx::drawString(const char *s, int x, int y, uint8_t size, uint16_t color)
+{
+  for (; *s; s++, x += 6 * size)
+  {
+    const uint8_t *cols = NULL;
+    for (size_t k = 0; k < sizeof(glyphs) / sizeof(glyphs[0]); k++)
+    {
+      if (glyphs[k].c == *s)
+        cols = glyphs[k].cols;
+    }
+    if (!cols)
+      continue;
+
+    beginShape();
+    for (int i = 0; i < 5; i++)
+    {
+      uint8_t line = cols[i];
+      for (int j = 0; j < 8; j++, line >>= 1)
+      {
+        if (!(line & 1))
+          continue;
+        if (size == 1)
+          drawPixel(x + i, y + j, color);
+        else
+          fillRect(x + i * size, y + j * size, size, size, color);
+      }
+    }
+    endShape();
+  }
+}
+
+static void scene_circles(Gfx &g)
+{
+  for (int r = 8; r < 120; r += 10)
+    g.drawCircle(120, 120, r, (r & 16) ? 0xF800 : 0x07E0);
+}
+
+static void scene_discs(Gfx &g)
+{
+  g.fillCircle(120, 120, 100, 0x001F);
+  g.fillCircle(80, 90, 40, 0xFFE0);
+  g.fillCircle(160, 90, 40, 0xFFE0);
+  g.fillCircle(120, 160, 30, 0xF800);
+}
+
+static void scene_buttons(Gfx &g)
+{
+  static const char *labels[] = {"Cheeze!", "Reset to snap again!", "Sharpest: DSC_0042.JPG (12.5)"};
+  for (int k = 0; k < 3; k++)
+  {
+    int y = 20 + k * 70;
+    g.fillRoundRect(10, y, 220, 50, 10, 0x39E7);
+    g.drawRoundRect(10, y, 220, 50, 10, 0xFFFF);
+    g.drawString(labels[k], 20, y + 20, 1, 0xFFFF);
+  }
+}
+
+static void scene_text(Gfx &g)
+{
+  g.drawString("Cheeze!", 78, 24, 2, 0xFFFF);
+  g.drawString("Sharpest: DSC_0042.JPG (12.5)", 0, 208, 1, 0xFFFF);
+  g.drawString("File written: 312KB 85ms", 0, 224, 1, 0xFFFF);
+  g.drawString("Reset to snap again!", 0, 100, 2, 0x07E0);
+}
+
+static void scene_lines(Gfx &g)
+{
+  for (int k = 0; k < 240; k += 16)
+  {
+    g.drawLine(120, 120, k, 0, 0xFFFF);
+    g.drawLine(120, 120, 239 - k, 239, 0xFFFF);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  static const struct
+  {
+    const char *name;
+    void (*draw)(Gfx &g);
+  } scenes[] = {{"circles", scene_circles}, {"discs", scene_discs}, {"buttons", scene_buttons}, {"text", scene_text}, {"lines", scene_lines}};
+
+  uint16_t capacity = DL_MAX_CMDS;
+  if (argc > 1)
+    capacity = atoi(argv[1]);
+  if (capacity < 1)
+  {
+    printf("Usage: %s [list capacity]\n", argv[0]);
+    return 1;
+  }
+
+  static Panel direct, replay;
+  printf("%u commands per list, modelled at 40MHz, %.2fus per transfer, %.1fus per transaction\n\n", capacity, BENCH_OP_US, BENCH_TXN_US);
+  printf("%-8s %6s %6s %6s %6s %7s %7s %8s %8s %6s %7s %s\n", "scene", "prims", "merged", "cover", "cmds", "KB", "KB dl",
+         "ms", "ms dl", "saved", "host us", "picture");
+
+  int failures = 0;
+  for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); s++)
+  {
+    // repeated for a steadier optimize() time, the counts are the same every time
+    DisplayList *dl = NULL;
+    Gfx *a = NULL, *b = NULL;
+    double bestUs = 1e9;
+    for (int rep = 0; rep < BENCH_REPS; rep++)
+    {
+      delete dl;
+      delete a;
+      delete b;
+      dl = new DisplayList(capacity);
+      direct.reset();
+      replay.reset();
+      a = new Gfx(&direct, NULL);
+      b = new Gfx(&replay, dl);
+      scenes[s].draw(*a);
+      scenes[s].draw(*b);
+      b->flush();
+      if (b->optimizeUs < bestUs)
+        bestUs = b->optimizeUs;
+    }
+
+    bool same = memcmp(direct.fb, replay.fb, sizeof(direct.fb)) == 0;
+    if (!same)
+      failures++;
+    const dl_stats_t *st = dl->stats();
+    printf("%-8s %6u %6u %6u %6u %7.1f %7.1f %8.2f %8.2f %5.0f%% %7.0f %s\n", scenes[s].name, a->primitives, st->merged,
+           st->covered, st->windows, direct.bytes / 1024.0, replay.bytes / 1024.0, direct.us() / 1000, replay.us() / 1000,
+           100 * (1 - replay.us() / direct.us()), bestUs, same ? "same" : "DIFFERENT");
+    delete dl;
+    delete a;
+    delete b;
+  }
+  return failures ? 1 : 0;
+}
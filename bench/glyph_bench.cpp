@@ -0,0 +1,285 @@
+/***************************************************************************************
+** GLCD and Font16 text drawn the old way, a pixel or a fillRect() per font pixel, against
+** the glyph rasteriser: a line buffer per glyph row pushed a character or a whole string
+** to a window, and runs of set pixels for transparent text. All go to the panel model of
+** panelmodel.h, and the text must come out the same. Glyphs per second are for the modelled
+** bus, "host" is the rasteriser alone on this machine.
+**
+** g++ -O2 -I. -I.. -o glyph_bench glyph_bench.cpp ../glyph.cpp ../raster.cpp
+** ./glyph_bench
+***************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "glyph.h"
+#include "glcdfont.h"
+#include "Font16.h"
+#include "panelmodel.h"
+
+#define BENCH_FG 0xFFFF
+#define BENCH_BG 0x001F
+#define BENCH_SCREEN 0x1234 // what the text is drawn over
+#define BENCH_TEXT "ESP32 Camera Plus 3 2 1 Cheeze! Reset to snap again"
+
+static void fill_rect(Panel *p, int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color)
+{
+  if ((w < 1) || (h < 1))
+    return;
+  p->window(x, y, x + w - 1, y + h - 1);
+  p->block(color, w * h);
+}
+
+static void draw_pixel(Panel *p, int32_t x, int32_t y, uint16_t color)
+{
+  p->window(x, y, x, y);
+  p->pixel(color);
+}
+
+// The drawChar() for the GLCD font before the rasteriser
+static int32_t old_glcd(Panel *p, int32_t x, int32_t y, unsigned char c, uint16_t fg, uint16_t bg, uint8_t size)
+{
+  bool fillbg = bg != fg;
+  p->begin();
+  if ((size == 1) && fillbg)
+  {
+    p->window(x, y, x + 5, y + 8);
+    for (int j = 0; j < 8; j++)
+    {
+      for (int k = 0; k < 5; k++)
+        p->pixel(((font[c * 5 + k] >> j) & 0x1) ? fg : bg);
+      p->pixel(bg);
+    }
+    return 6 * size;
+  }
+
+  for (int i = 0; i < 6; i++)
+  {
+    uint8_t line = (i == 5) ? 0 : font[c * 5 + i];
+    for (int j = 0; j < 8; j++, line >>= 1)
+    {
+      if (size == 1)
+      {
+        if (line & 0x1)
+          draw_pixel(p, x + i, y + j, fg);
+      }
+      else if (line & 0x1)
+        fill_rect(p, x + i * size, y + j * size, size, size, fg);
+      else if (fillbg)
+        fill_rect(p, x + i * size, y + j * size, size, size, bg);
+    }
+  }
+  return 6 * size;
+}
+
+// The drawChar() for Font16 before the rasteriser
+static int32_t old_font16(Panel *p, int32_t x, int32_t y, unsigned char c, uint16_t fg, uint16_t bg, uint8_t size)
+{
+  const uint8_t *bits = chrtbl_f16[c - 32];
+  int width = widtbl_f16[c - 32];
+  int w = (width + 6) / 8;
+  if (x + width * size >= BENCH_W)
+    return width * size;
+
+  p->begin();
+  if ((fg != bg) && (size == 1))
+  {
+    p->window(x, y, x + w * 8 - 1, y + chr_hgt_f16 - 1);
+    for (int i = 0; i < chr_hgt_f16; i++)
+      for (int k = 0; k < w; k++)
+        for (uint8_t mask = 0x80; mask; mask >>= 1)
+          p->pixel((bits[w * i + k] & mask) ? fg : bg);
+    return width * size;
+  }
+
+  int pY = y;
+  for (int i = 0; i < chr_hgt_f16; i++, pY += size)
+  {
+    if (fg != bg)
+      fill_rect(p, x, pY, width * size, size, bg);
+    for (int k = 0; k < w; k++)
+    {
+      uint8_t line = bits[w * i + k];
+      for (int b = 0; b < 8; b++)
+      {
+        if (!(line & (0x80 >> b)))
+          continue;
+        if (size == 1)
+          draw_pixel(p, x + k * 8 + b, pY, fg);
+        else
+          fill_rect(p, x + (k * 8 + b) * size, pY, size, size, fg);
+      }
+    }
+  }
+  return width * size;
+}
+
+static double hostUs;
+
+// As ST7789::glyphPush()
+static void push_glyphs(Panel *p, const glyph_t *glyphs, uint8_t count, int32_t x, int32_t y, uint8_t size, uint16_t fg, uint16_t bg)
+{
+  int32_t w = 0;
+  for (uint8_t k = 0; k < count; k++)
+    w += glyphs[k].width * size;
+  int32_t xs = (x < 0) ? 0 : x, xe = x + w - 1;
+  int32_t ys = (y < 0) ? 0 : y, ye = y + glyphs[0].height * size - 1;
+  if (xe >= BENCH_W)
+    xe = BENCH_W - 1;
+  if (ye >= BENCH_H)
+    ye = BENCH_H - 1;
+  if ((xs > xe) || (ys > ye))
+    return;
+
+  uint16_t line[GLYPH_LINE_PIXELS];
+  int32_t last = -1;
+  p->begin();
+  p->window(xs, ys, xe, ye);
+  for (int32_t py = ys; py <= ye; py++)
+  {
+    int32_t row = (py - y) / size;
+    if (row != last)
+    {
+      double t = now_us();
+      glyph_line(glyphs, count, x, size, row, (fg >> 8) | (fg << 8), (bg >> 8) | (bg << 8), xs, xe, line);
+      hostUs += now_us() - t;
+      last = row;
+    }
+    p->stream(line, xe - xs + 1);
+  }
+}
+
+typedef struct
+{
+  Panel *p;
+  uint16_t color;
+} fill_t;
+
+static void fill_run(void *ctx, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+  fill_t *f = (fill_t *)ctx;
+  fill_rect(f->p, x, y, w, h, f->color);
+}
+
+// As ST7789::glyphFill()
+static void fill_glyph(Panel *p, const glyph_t *g, int32_t x, int32_t y, uint8_t size, uint16_t color)
+{
+  fill_t f = {p, color};
+  p->begin();
+  double t = now_us();
+  glyph_rects(g, x, y, size, fill_run, &f);
+  hostUs += now_us() - t;
+}
+
+static bool make_glyph(glyph_t *g, uint8_t f, unsigned char c)
+{
+  if (f == 1)
+  {
+    glyph_glcd(g, c);
+    return true;
+  }
+  return glyph_font16(g, c);
+}
+
+// As drawChar() now, a window a character
+static int32_t new_char(Panel *p, uint8_t f, int32_t x, int32_t y, unsigned char c, uint16_t fg, uint16_t bg, uint8_t size)
+{
+  glyph_t g;
+  make_glyph(&g, f, c);
+  if ((f == 2) && (x + g.width * size >= BENCH_W))
+    return g.width * size;
+  if (fg != bg)
+    push_glyphs(p, &g, 1, x, y, size, fg, bg);
+  else
+    fill_glyph(p, &g, x, y, size, fg);
+  return g.width * size;
+}
+
+// As drawString() now, opaque text goes out in one window
+static int32_t new_string(Panel *p, uint8_t f, int32_t x, int32_t y, const char *s, uint16_t fg, uint16_t bg, uint8_t size)
+{
+  glyph_t glyphs[GLYPH_MAX_STRING];
+  uint8_t count = 0;
+  int32_t sumX = 0;
+  if (fg == bg)
+  {
+    while (*s)
+      sumX += new_char(p, f, x + sumX, y, *(s++), fg, bg, size);
+    return sumX;
+  }
+  while (*s)
+  {
+    make_glyph(&glyphs[count], f, *(s++));
+    sumX += glyphs[count++].width * size;
+  }
+  push_glyphs(p, glyphs, count, x, y, size, fg, bg);
+  return sumX;
+}
+
+// As much of the bench text as fits across the screen
+static void bench_text(char *text, uint8_t f, uint8_t size)
+{
+  int32_t w = 0;
+  size_t n = 0;
+  for (const char *s = BENCH_TEXT; *s; s++)
+  {
+    int32_t cw = ((f == 1) ? 6 : widtbl_f16[*s - 32]) * size;
+    if (w + cw >= BENCH_W)
+      break;
+    w += cw;
+    text[n++] = *s;
+  }
+  text[n] = 0;
+}
+
+static bool same_cell(const Panel &a, const Panel &b, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+  for (int32_t j = y; j < y + h; j++)
+    if (memcmp(&a.fb[j * BENCH_W + x], &b.fb[j * BENCH_W + x], w * 2))
+      return false;
+  return true;
+}
+
+int main()
+{
+  static Panel before, chars, string;
+  printf("modelled at 40MHz, %.2fus per transfer, %.1fus per transaction\n\n", BENCH_OP_US, BENCH_TXN_US);
+  printf("%-5s %4s %-6s %6s %9s %9s %9s %6s %6s %6s %9s %s\n", "font", "size", "bg", "glyphs", "glyph/s", "char/s", "string/s",
+         "win", "win ch", "win st", "host/s", "picture");
+
+  int failures = 0;
+  for (uint8_t f = 1; f <= 2; f++)
+  {
+    for (uint8_t size = 1; size <= 4; size++)
+    {
+      for (int opaque = 1; opaque >= 0; opaque--)
+      {
+        char text[64];
+        bench_text(text, f, size);
+        uint16_t bg = opaque ? BENCH_BG : BENCH_FG;
+        int32_t x = 0, y = 10, w = 0;
+        int32_t h = ((f == 1) ? 8 : chr_hgt_f16) * size;
+        int glyphs = strlen(text);
+
+        before.reset(BENCH_SCREEN);
+        chars.reset(BENCH_SCREEN);
+        string.reset(BENCH_SCREEN);
+        for (const char *s = text; *s; s++)
+          w += (f == 1) ? old_glcd(&before, x + w, y, *s, BENCH_FG, bg, size) : old_font16(&before, x + w, y, *s, BENCH_FG, bg, size);
+        for (int32_t cx = x, k = 0; k < glyphs; k++)
+          cx += new_char(&chars, f, cx, y, text[k], BENCH_FG, bg, size);
+        hostUs = 0;
+        new_string(&string, f, x, y, text, BENCH_FG, bg, size);
+
+        bool same = same_cell(before, chars, x, y, w, h) && same_cell(before, string, x, y, w, h);
+        if (!same)
+          failures++;
+        printf("%-5u %4u %-6s %6d %9.0f %9.0f %9.0f %6llu %6llu %6llu %9.0f %s\n", f, size, opaque ? "opaque" : "none", glyphs,
+               glyphs * 1e6 / before.us(), glyphs * 1e6 / chars.us(), glyphs * 1e6 / string.us(),
+               (unsigned long long)before.windows, (unsigned long long)chars.windows, (unsigned long long)string.windows,
+               hostUs > 0 ? glyphs * 1e6 / hostUs : 0.0, same ? "same" : "DIFFERENT");
+      }
+    }
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+/***************************************************************************************
+** Score JPEG files with jpgsharp_score() and report the scoring throughput
+**
+** g++ -O2 -I.. -o jpgsharp_bench jpgsharp_bench.cpp ../jpgsharp.cpp
+** ./jpgsharp_bench [-n iterations] file.jpg ...
+***************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "jpgsharp.h"
+
+static double now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+  int iterations = 20;
+  int first = 1;
+  if ((argc > 2) && (strcmp(argv[1], "-n") == 0))
+  {
+    iterations = atoi(argv[2]);
+    first = 3;
+  }
+  if (argc <= first)
+  {
+    printf("Usage: %s [-n iterations] file.jpg ...\n", argv[0]);
+    return 1;
+  }
+
+  int best = -1;
+  float bestScore = -1;
+  uint64_t totalBytes = 0;
+  double totalMs = 0;
+
+  for (int k = first; k < argc; k++)
+  {
+    FILE *f = fopen(argv[k], "rb");
+    if (!f)
+    {
+      printf("%s: cannot open\n", argv[k]);
+      continue;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = (uint8_t *)malloc(len);
+    len = fread(buf, 1, len, f);
+    fclose(f);
+
+    jpgsharp_t result;
+    bool ok = true;
+    double start = now_ms();
+    for (int n = 0; n < iterations; n++)
+      ok = ok && jpgsharp_score(buf, len, &result);
+    double ms = now_ms() - start;
+
+    if (ok)
+    {
+      printf("%s: %ld bytes, %u luma blocks, score %.1f, %.2f MB/s\n",
+             argv[k], len, result.blocks, result.score, (double)len * iterations / 1000.0 / ms);
+      totalBytes += (uint64_t)len * iterations;
+      totalMs += ms;
+      if (result.score > bestScore)
+      {
+        bestScore = result.score;
+        best = k;
+      }
+    }
+    else
+      printf("%s: not a baseline JPEG\n", argv[k]);
+    free(buf);
+  }
+
+  if (best > 0)
+    printf("Sharpest: %s, overall %.2f MB/s\n", argv[best], totalBytes / 1000.0 / totalMs);
+  return 0;
+}
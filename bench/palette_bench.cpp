@@ -0,0 +1,132 @@
+/***************************************************************************************
+** Indexed image rows expanded to bus order 565 colours. The old 8 bit pushImage() worked
+** out each RRRGGGBB pixel with shifts, skipped when the colour repeats, a byte at a time.
+** palette_line() looks every pixel up in a 256 (or 16) entry table and reads and writes
+** words. Every start column and line alignment must give the old colours for 8 bit, and
+** those of a pixel at a time lookup for 4 bit. Rows are the width of the screen, a flat
+** image favours the old repeat check and a noisy one does not.
+**
+** g++ -O2 -I.. -o palette_bench palette_bench.cpp ../palette.cpp
+** ./palette_bench
+***************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "palette.h"
+
+#define BENCH_W 240
+#define BENCH_H 240
+#define BENCH_LINE_US (BENCH_W * 16 / 40.0) // a row on a 40MHz bus
+
+static double now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static uint32_t lastColor;
+
+// The 8 bit row of pushImage() before the palette
+static void old_line(const uint8_t *ptr, uint32_t len, uint16_t *lineBuf)
+{
+  uint8_t blue[] = {0, 11, 21, 31};
+  uint8_t *linePtr = (uint8_t *)lineBuf;
+  uint8_t msbColor = 0, lsbColor = 0;
+  lastColor = -1;
+  while (len--)
+  {
+    uint32_t color = *ptr++;
+    if (color != lastColor)
+    {
+      msbColor = (color & 0x1C) >> 2 | (color & 0xC0) >> 3 | (color & 0xE0);
+      lsbColor = (color & 0x1C) << 3 | blue[color & 0x03];
+      lastColor = color;
+    }
+    *linePtr++ = msbColor;
+    *linePtr++ = lsbColor;
+  }
+}
+
+static void ref_line4(const palette_t *p, const uint8_t *row, uint32_t x, uint32_t n, uint16_t *line)
+{
+  for (uint32_t k = 0; k < n; k++, x++)
+    line[k] = p->lut[(row[x >> 1] >> ((x & 0x1) ? 0 : 4)) & 0xF];
+}
+
+static bool check(const palette_t *p8, const palette_t *p4, const uint8_t *img)
+{
+  uint32_t got[BENCH_W + 4], want[BENCH_W + 4]; // word aligned, used as uint16_t
+  for (uint32_t x = 0; x < 9; x++)
+    for (uint32_t off = 0; off < 2; off++)
+      for (uint32_t n = 0; n + x <= BENCH_W; n += (n < 20) ? 1 : 37)
+      {
+        uint16_t *g = (uint16_t *)got + off, *w = (uint16_t *)want + off;
+        palette_line(p8, img + 3, x, n, g);
+        old_line(img + 3 + x, n, w);
+        if (memcmp(g, w, n * 2))
+        {
+          printf("8 bit differs at x %u n %u off %u\n", x, n, off);
+          return false;
+        }
+        palette_line(p4, img + 1, x, n, g);
+        ref_line4(p4, img + 1, x, n, w);
+        if (memcmp(g, w, n * 2))
+        {
+          printf("4 bit differs at x %u n %u off %u\n", x, n, off);
+          return false;
+        }
+      }
+  return true;
+}
+
+static void run(const char *name, const uint8_t *img, const palette_t *p8, const palette_t *p4)
+{
+  uint16_t line[BENCH_W];
+  const int reps = 200;
+  double t0 = now_us();
+  for (int r = 0; r < reps; r++)
+    for (int y = 0; y < BENCH_H; y++)
+      old_line(img + y * BENCH_W, BENCH_W, line);
+  double tOld = (now_us() - t0) / (reps * BENCH_H);
+  t0 = now_us();
+  for (int r = 0; r < reps; r++)
+    for (int y = 0; y < BENCH_H; y++)
+      palette_line(p8, img + y * BENCH_W, 0, BENCH_W, line);
+  double t8 = (now_us() - t0) / (reps * BENCH_H);
+  t0 = now_us();
+  for (int r = 0; r < reps; r++)
+    for (int y = 0; y < BENCH_H; y++)
+      palette_line(p4, img + y * BENCH_W / 2, 0, BENCH_W, line);
+  double t4 = (now_us() - t0) / (reps * BENCH_H);
+  printf("%-6s %10.3f %10.3f %10.3f %9.1f%%\n", name, tOld, t8, t4, 100.0 * (tOld - t8) / tOld);
+}
+
+int main()
+{
+  static uint8_t noisy[BENCH_W * BENCH_H + 8], flat[BENCH_W * BENCH_H + 8];
+  srand(1);
+  for (int k = 0; k < BENCH_W * BENCH_H + 8; k++)
+  {
+    noisy[k] = rand();
+    flat[k] = ((k % BENCH_W) / 40) * 37; // bands of one colour
+  }
+
+  palette_t p8, p4;
+  palette_rgb332(&p8);
+  uint16_t colors[16];
+  for (int k = 0; k < 16; k++)
+    colors[k] = rand();
+  palette_set(&p4, colors, 16, 4);
+
+  if ((!check(&p8, &p4, noisy)) || (!check(&p8, &p4, flat)))
+    return 1;
+
+  printf("us per %d pixel row on this machine, a row takes %.1fus on the bus\n\n", BENCH_W, BENCH_LINE_US);
+  printf("image  old 8 bit    8 bit      4 bit     8 bit gain\n");
+  run("noisy", noisy, &p8, &p4);
+  run("flat", flat, &p8, &p4);
+  return 0;
+}
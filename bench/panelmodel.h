@@ -0,0 +1,121 @@
+// Host model of the ST7789 end of the SPI bus for the drawing benches. It keeps the
+// window cache of setAddrWindowCore(), counts SPI bytes, register transfers and
+// transactions, and draws into a framebuffer so the pictures can be compared.
+#ifndef _PANELMODELH_
+#define _PANELMODELH_
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_W 240
+#define BENCH_H 240
+#define BENCH_BYTE_US (8.0 / 40) // 40MHz SPI
+#define BENCH_OP_US 0.35         // set up, start and poll one transfer, as writeBlock() does
+#define BENCH_TXN_US 3.0         // SPI.beginTransaction() and endTransaction()
+
+static inline double now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+// The panel end of the bus
+class Panel
+{
+public:
+  uint16_t fb[BENCH_W * BENCH_H];
+  uint64_t bytes, ops, windows, transactions;
+
+  void reset(uint16_t color = 0)
+  {
+    clear(color);
+    bytes = ops = windows = transactions = 0;
+    cs = ce = rs = re = -1;
+  }
+
+  void clear(uint16_t color = 0)
+  {
+    for (int k = 0; k < BENCH_W * BENCH_H; k++)
+      fb[k] = color;
+  }
+
+  void begin()
+  {
+    transactions++;
+  }
+
+  // CASET and PASET are only sent when they change
+  void window(int xs, int ys, int xe, int ye)
+  {
+    if ((cs != xs) || (ce != xe))
+    {
+      bytes += 5;
+      ops += 2;
+      cs = xs;
+      ce = xe;
+    }
+    if ((rs != ys) || (re != ye))
+    {
+      bytes += 5;
+      ops += 2;
+      rs = ys;
+      re = ye;
+    }
+    bytes += 1;
+    ops += 1;
+    windows++;
+    cx = cs;
+    cy = rs;
+  }
+
+  // tft_Write_Color(), a transfer per pixel
+  void pixel(uint16_t color)
+  {
+    bytes += 2;
+    ops += 1;
+    put(color);
+  }
+
+  // writeBlock(), pixels go in at the cursor and wrap at the window edge
+  void block(uint16_t color, int32_t n)
+  {
+    if (n < 1)
+      return;
+    bytes += 2 * n;
+    ops += (n + 31) / 32;
+    while (n--)
+      put(color);
+  }
+
+  // SPI.writeBytes() of a line in bus byte order, 64 bytes a transfer
+  void stream(const uint16_t *line, int32_t n)
+  {
+    bytes += 2 * n;
+    ops += (2 * n + 63) / 64;
+    for (int32_t k = 0; k < n; k++)
+      put((line[k] >> 8) | (line[k] << 8));
+  }
+
+  double us()
+  {
+    return bytes * BENCH_BYTE_US + ops * BENCH_OP_US + transactions * BENCH_TXN_US;
+  }
+
+private:
+  int cs, ce, rs, re, cx, cy;
+
+  void put(uint16_t color)
+  {
+    if ((cy <= re) && (cx < BENCH_W) && (cy < BENCH_H))
+      fb[cy * BENCH_W + cx] = color;
+    if (++cx > ce)
+    {
+      cx = cs;
+      cy++;
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,10 @@
+// Host stand-in for the ESP32 header, so the font tables compile in the benches
+#ifndef _PGMSPACEH_
+#define _PGMSPACEH_
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+
+#endif
@@ -0,0 +1,258 @@
+/***************************************************************************************
+** Filled shapes sent line by line against sent as span runs. Each primitive is drawn
+** at random sizes and places (some partly off screen) three ways:
+**   lines   - one window per horizontal line or rectangle, as the shapes used to be sent
+**   spans   - one window per run of rows with the same span, ST7789::spanFill()
+**   bounded - one window over the bounding box, background around the spans
+** to the panel model of panelmodel.h. All three pictures must come out the same.
+** A triangle leaves half its bounding box empty, so fillTriangle() has no bounded form.
+**
+** g++ -O2 -I.. -o raster_bench raster_bench.cpp ../raster.cpp
+** ./raster_bench [shapes per primitive]
+***************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "raster.h"
+#include "panelmodel.h"
+
+#define BENCH_COLOR 0xF800
+#define BENCH_BG 0x0000
+
+// The old shape functions: every line clipped and sent with a window of its own
+static void lines_rect(void *ctx, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+  Panel *p = (Panel *)ctx;
+  if (x < 0)
+  {
+    w += x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    h += y;
+    y = 0;
+  }
+  if (x + w > BENCH_W)
+    w = BENCH_W - x;
+  if (y + h > BENCH_H)
+    h = BENCH_H - y;
+  if ((w < 1) || (h < 1))
+    return;
+  p->window(x, y, x + w - 1, y + h - 1);
+  p->block(BENCH_COLOR, w * h);
+}
+
+// As ST7789::spanBegin()
+static bool span_begin(raster_spans_t *spans, int32_t ys, int32_t ye)
+{
+  if (ys < 0)
+    ys = 0;
+  if (ye >= BENCH_H)
+    ye = BENCH_H - 1;
+  raster_spans_begin(spans, ys, ye - ys + 1);
+  return spans->rows > 0;
+}
+
+// As ST7789::spanFill(spans, color)
+static void span_fill(Panel *p, raster_spans_t *spans)
+{
+  raster_spans_clip(spans, BENCH_W);
+  int32_t k = 0;
+  while (k < spans->rows)
+  {
+    int32_t xs = spans->xs[k], xe = spans->xe[k];
+    int32_t n = 1;
+    while ((k + n < spans->rows) && (spans->xs[k + n] == xs) && (spans->xe[k + n] == xe))
+      n++;
+    if (xs <= xe)
+    {
+      p->window(xs, spans->top + k, xe, spans->top + k + n - 1);
+      p->block(BENCH_COLOR, (xe - xs + 1) * n);
+    }
+    k += n;
+  }
+}
+
+// As ST7789::spanFill(spans, color, bg)
+static void span_fill_bounded(Panel *p, raster_spans_t *spans)
+{
+  int32_t bx, be;
+  raster_spans_clip(spans, BENCH_W);
+  if (!raster_spans_bounds(spans, &bx, &be))
+    return;
+  p->window(bx, spans->top, be, spans->top + spans->rows - 1);
+  for (int32_t k = 0; k < spans->rows; k++)
+  {
+    int32_t xs = spans->xs[k], xe = spans->xe[k];
+    if (xs > xe)
+    {
+      xs = be + 1;
+      xe = be;
+    }
+    p->block(BENCH_BG, xs - bx);
+    p->block(BENCH_COLOR, xe - xs + 1);
+    p->block(BENCH_BG, be - xe);
+  }
+}
+
+typedef struct
+{
+  int32_t p[6];
+  int32_t ys, ye; // rows the shape may cover
+} shape_t;
+
+typedef struct
+{
+  const char *name;
+  void (*make)(shape_t *s, int32_t size);
+  void (*draw)(raster_rect_t rect, void *ctx, const shape_t *s);
+} primitive_t;
+
+static int32_t rnd(int32_t lo, int32_t hi)
+{
+  return lo + rand() % (hi - lo + 1);
+}
+
+static void make_circle(shape_t *s, int32_t size)
+{
+  s->p[0] = rnd(-20, BENCH_W + 20);
+  s->p[1] = rnd(-20, BENCH_H + 20);
+  s->p[2] = rnd(size / 2, size);
+  s->ys = s->p[1] - s->p[2];
+  s->ye = s->p[1] + s->p[2];
+}
+
+static void draw_circle(raster_rect_t rect, void *ctx, const shape_t *s)
+{
+  raster_fill_circle(rect, ctx, s->p[0], s->p[1], s->p[2]);
+}
+
+static void make_ellipse(shape_t *s, int32_t size)
+{
+  s->p[0] = rnd(-20, BENCH_W + 20);
+  s->p[1] = rnd(-20, BENCH_H + 20);
+  s->p[2] = rnd(size / 4 + 2, size);
+  s->p[3] = rnd(size / 4 + 2, size);
+  s->ys = s->p[1] - s->p[3];
+  s->ye = s->p[1] + s->p[3];
+}
+
+static void draw_ellipse(raster_rect_t rect, void *ctx, const shape_t *s)
+{
+  raster_fill_ellipse(rect, ctx, s->p[0], s->p[1], s->p[2], s->p[3]);
+}
+
+static void make_triangle(shape_t *s, int32_t size)
+{
+  int32_t x = rnd(-20, BENCH_W + 20), y = rnd(-20, BENCH_H + 20);
+  s->ys = y;
+  s->ye = y;
+  for (int k = 0; k < 6; k += 2)
+  {
+    s->p[k] = x + rnd(-size, size);
+    s->p[k + 1] = y + rnd(-size, size);
+    if (s->p[k + 1] < s->ys)
+      s->ys = s->p[k + 1];
+    if (s->p[k + 1] > s->ye)
+      s->ye = s->p[k + 1];
+  }
+}
+
+static void draw_triangle(raster_rect_t rect, void *ctx, const shape_t *s)
+{
+  raster_fill_triangle(rect, ctx, s->p[0], s->p[1], s->p[2], s->p[3], s->p[4], s->p[5]);
+}
+
+static void make_round_rect(shape_t *s, int32_t size)
+{
+  s->p[0] = rnd(-20, BENCH_W);
+  s->p[1] = rnd(-20, BENCH_H);
+  s->p[2] = rnd(size / 2, 2 * size) + 2;
+  s->p[3] = rnd(size / 4, size) + 2;
+  int32_t r = (s->p[2] < s->p[3]) ? s->p[2] : s->p[3];
+  s->p[4] = rnd(0, r / 2 - 1);
+  s->ys = s->p[1];
+  s->ye = s->p[1] + s->p[3] - 1;
+}
+
+static void draw_round_rect(raster_rect_t rect, void *ctx, const shape_t *s)
+{
+  raster_fill_round_rect(rect, ctx, s->p[0], s->p[1], s->p[2], s->p[3], s->p[4]);
+}
+
+int main(int argc, char **argv)
+{
+  static const primitive_t prims[] = {{"circle", make_circle, draw_circle},
+                                      {"ellipse", make_ellipse, draw_ellipse},
+                                      {"triangle", make_triangle, draw_triangle},
+                                      {"rrect", make_round_rect, draw_round_rect}};
+  static const int32_t sizes[] = {8, 30, 100};
+
+  int count = 200;
+  if (argc > 1)
+    count = atoi(argv[1]);
+  if (count < 1)
+  {
+    printf("Usage: %s [shapes per primitive]\n", argv[0]);
+    return 1;
+  }
+
+  static Panel lines, spans, bounded;
+  static raster_spans_t sp;
+  printf("%d shapes each, modelled at 40MHz, %.2fus per transfer, %.1fus per transaction\n\n", count, BENCH_OP_US, BENCH_TXN_US);
+  printf("%-8s %4s %7s %7s %7s %8s %8s %8s %6s %6s %s\n", "shape", "size", "win", "win sp", "win bb", "ms", "ms sp",
+         "ms bb", "sp", "bb", "picture");
+
+  int failures = 0;
+  srand(1);
+  for (size_t n = 0; n < sizeof(prims) / sizeof(prims[0]); n++)
+  {
+    for (size_t z = 0; z < sizeof(sizes) / sizeof(sizes[0]); z++)
+    {
+      lines.reset(BENCH_BG);
+      spans.reset(BENCH_BG);
+      bounded.reset(BENCH_BG);
+      bool same = true;
+
+      for (int k = 0; k < count; k++)
+      {
+        shape_t s;
+        prims[n].make(&s, sizes[z]);
+        lines.clear(BENCH_BG);
+        spans.clear(BENCH_BG);
+        bounded.clear(BENCH_BG);
+
+        // every shape is one transaction whichever way it is sent
+        lines.begin();
+        prims[n].draw(lines_rect, &lines, &s);
+
+        spans.begin();
+        for (int32_t top = s.ys; span_begin(&sp, top, s.ye); top = sp.top + sp.rows)
+        {
+          prims[n].draw(raster_spans_rect, &sp, &s);
+          span_fill(&spans, &sp);
+        }
+
+        bounded.begin();
+        for (int32_t top = s.ys; span_begin(&sp, top, s.ye); top = sp.top + sp.rows)
+        {
+          prims[n].draw(raster_spans_rect, &sp, &s);
+          span_fill_bounded(&bounded, &sp);
+        }
+
+        if ((memcmp(lines.fb, spans.fb, sizeof(lines.fb))) || (memcmp(lines.fb, bounded.fb, sizeof(lines.fb))))
+          same = false;
+      }
+
+      if (!same)
+        failures++;
+      printf("%-8s %4d %7.1f %7.1f %7.1f %8.3f %8.3f %8.3f %5.0f%% %5.0f%% %s\n", prims[n].name, sizes[z],
+             (double)lines.windows / count, (double)spans.windows / count, (double)bounded.windows / count,
+             lines.us() / count / 1000, spans.us() / count / 1000, bounded.us() / count / 1000,
+             100 * (1 - spans.us() / lines.us()), 100 * (1 - bounded.us() / lines.us()), same ? "same" : "DIFFERENT");
+    }
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+/***************************************************************************************
+** Replay recorded camera frames on a host without a sensor and report the throughput
+** of the preview (consume and release) and storage (write every frame) paths. Frames are
+** saved with capfile_write(): temporary file, chunks, footer and rename, as on the card.
+**
+** g++ -O2 -I.. -o replay_bench replay_bench.cpp ../framesource.cpp ../capfile.cpp ../storage.cpp
+** ./replay_bench <jpeg dir> [fps] [frames] [consumer ms] [output dir]
+***************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "framesource.h"
+#include "storage.h"
+#include "capfile.h"
+
+#define BENCH_CHUNK 8192 // SDW_CHUNK_SIZE
+
+static double now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    printf("Usage: %s <jpeg dir> [fps] [frames] [consumer ms] [output dir]\n", argv[0]);
+    return 1;
+  }
+
+  int fps = (argc > 2) ? atoi(argv[2]) : 12;
+  int frames = (argc > 3) ? atoi(argv[3]) : 100;
+  int consumer_ms = (argc > 4) ? atoi(argv[4]) : 0;
+  const char *outDir = (argc > 5) ? argv[5] : NULL;
+
+  ReplayFrameSource source(argv[1], fps);
+  if (!source.begin())
+  {
+    printf("No JPEG files in %s\n", argv[1]);
+    return 1;
+  }
+  printf("Replay %u files at %d fps, consumer %d ms\n", source.fileCount(), fps, consumer_ms);
+
+  PosixStorage storage(outDir ? outDir : ".");
+  uint64_t bytes = 0;
+  uint32_t failed = 0;
+  double writeMs = 0;
+  double start = now_ms();
+  for (int k = 0; k < frames; k++)
+  {
+    camera_fb_t *fb = source.get();
+    if (!fb)
+      break;
+    bytes += fb->len;
+    if (k == 0)
+      printf("Frame size %ux%u\n", (unsigned)fb->width, (unsigned)fb->height);
+
+    if (outDir)
+    {
+      char path[32];
+      snprintf(path, sizeof(path), "/DSC%05d.JPG", k + 1);
+      storage.remove(path); // from an earlier run, a capture is never written over
+      double t = now_ms();
+      if (!capfile_write(&storage, path, NULL, 0, fb->buf, fb->len, BENCH_CHUNK))
+        failed++;
+      writeMs += now_ms() - t;
+    }
+
+    if (consumer_ms)
+      usleep(consumer_ms * 1000);
+    source.release(fb);
+  }
+  double elapsed = now_ms() - start;
+
+  printf("Delivered %u frames in %.1f ms: %.2f fps, %.2f MB/s\n",
+         source.delivered(), elapsed, source.delivered() * 1000.0 / elapsed, bytes / 1000.0 / elapsed);
+  printf("Dropped %u, starved %u\n", source.dropped(), source.starved());
+  if (outDir)
+    printf("Storage: %.1f ms, %.2f MB/s, %u failed\n", writeMs, writeMs ? bytes / 1000.0 / writeMs : 0, failed);
+  return 0;
+}
@@ -0,0 +1,295 @@
+/***************************************************************************************
+** Replay the capture sizes of a recorded session through the save path strategies of
+** sdwriter.cpp on host files with an SD card latency model. Reports modelled throughput,
+** per shot latency histograms and card operations per shot.
+**
+** g++ -O2 -I.. -o storage_bench storage_bench.cpp ../storage.cpp ../capfile.cpp
+** ./storage_bench [-m class4|class10] [-o dir] <session log | jpeg dir>
+**
+** A session log is any text with one capture per line, the first number of each line
+** is its size in bytes, or in KB when followed by "KB" (the "File written: 312KB" lines
+** of the sketch output work as is).
+***************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "storage.h"
+#include "capfile.h"
+
+#define BENCH_CHUNK 8192 // SDW_CHUNK_SIZE
+#define BENCH_POOL 2     // SDW_POOL_SIZE
+#define BENCH_POOL_MIN (256 * 1024)
+#define BENCH_BUCKETS 8
+
+static const uint32_t bucketMs[BENCH_BUCKETS - 1] = {25, 50, 100, 200, 400, 800, 1600};
+
+typedef enum
+{
+  PLAN_DIRECT,   // one write of the whole file, as before the writer task
+  PLAN_CHUNK,    // sector aligned chunks
+  PLAN_PREALLOC, // chunks into a file grown to its final size first
+  PLAN_POOL      // chunks into a pooled preallocated file, truncated at the end
+} plan_t;
+
+typedef struct
+{
+  const char *name;
+  plan_t plan;
+  size_t chunk;
+} strategy_t;
+
+static const strategy_t strategies[] = {
+    {"direct", PLAN_DIRECT, 0},
+    {"chunk 512", PLAN_CHUNK, 512},
+    {"chunk 2048", PLAN_CHUNK, 2048},
+    {"chunk 8192", PLAN_CHUNK, 8192},
+    {"chunk 32768", PLAN_CHUNK, 32768},
+    {"prealloc 8192", PLAN_PREALLOC, BENCH_CHUNK},
+    {"pool 8192", PLAN_POOL, BENCH_CHUNK},
+};
+
+static double now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+  uint32_t ua = *(const uint32_t *)a, ub = *(const uint32_t *)b;
+  return (ua > ub) - (ua < ub);
+}
+
+static size_t load_sizes(const char *source, uint32_t **sizes)
+{
+  size_t count = 0, cap = 0;
+  struct stat st;
+  *sizes = NULL;
+
+  if ((stat(source, &st) == 0) && (S_ISDIR(st.st_mode)))
+  {
+    DIR *dir = opendir(source);
+    struct dirent *entry;
+    char path[512];
+    while ((dir) && ((entry = readdir(dir)) != NULL))
+    {
+      size_t len = strlen(entry->d_name);
+      if ((len < 5) || (strcasecmp(entry->d_name + len - 4, ".JPG") != 0))
+        continue;
+      snprintf(path, sizeof(path), "%s/%s", source, entry->d_name);
+      if (stat(path, &st) != 0)
+        continue;
+      if (count == cap)
+      {
+        cap = cap ? cap * 2 : 64;
+        *sizes = (uint32_t *)realloc(*sizes, cap * sizeof(uint32_t));
+      }
+      (*sizes)[count++] = st.st_size;
+    }
+    if (dir)
+      closedir(dir);
+    return count;
+  }
+
+  FILE *f = fopen(source, "r");
+  char line[256];
+  while ((f) && (fgets(line, sizeof(line), f)))
+  {
+    char *p = line;
+    while ((*p) && ((*p < '0') || (*p > '9')))
+      p++;
+    if (!*p)
+      continue;
+    char *end;
+    unsigned long size = strtoul(p, &end, 10);
+    if (strncasecmp(end, "KB", 2) == 0)
+      size *= 1024;
+    if (!size)
+      continue;
+    if (count == cap)
+    {
+      cap = cap ? cap * 2 : 64;
+      *sizes = (uint32_t *)realloc(*sizes, cap * sizeof(uint32_t));
+    }
+    (*sizes)[count++] = size;
+  }
+  if (f)
+    fclose(f);
+  return count;
+}
+
+static bool fill_pool(Storage *storage, bool *ready, size_t size)
+{
+  char path[64];
+  for (int k = 0; k < BENCH_POOL; k++)
+  {
+    if (ready[k])
+      continue;
+    snprintf(path, sizeof(path), "/DCIM/POOL/P%02d.TMP", k);
+    int fd = storage->open(path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0)
+      return false;
+    ready[k] = storage->preallocate(fd, size);
+    storage->close(fd);
+    return true;
+  }
+  return false;
+}
+
+// The card operations of sdw_write_file(): temporary file, footer and rename through
+// capfile_write(), the pool file taken first
+static bool save(Storage *storage, const strategy_t *s, const char *path, const uint8_t *data, size_t len, bool *pool)
+{
+  char poolPath[64];
+  const char *from = NULL;
+  if (s->plan == PLAN_POOL)
+  {
+    for (int k = 0; k < BENCH_POOL; k++)
+    {
+      if (!pool[k])
+        continue;
+      pool[k] = false;
+      snprintf(poolPath, sizeof(poolPath), "/DCIM/POOL/P%02d.TMP", k);
+      from = poolPath;
+      break;
+    }
+  }
+
+  size_t chunk = (s->plan == PLAN_DIRECT) ? len : s->chunk;
+  return capfile_write(storage, path, NULL, 0, data, len, chunk, (s->plan == PLAN_PREALLOC) || (s->plan == PLAN_POOL), from);
+}
+
+int main(int argc, char **argv)
+{
+  const sdcard_model_t *model = &SDCardLatency::class10;
+  const char *out = "/tmp/storage_bench";
+  const char *source = NULL;
+
+  for (int k = 1; k < argc; k++)
+  {
+    if ((strcmp(argv[k], "-m") == 0) && (k + 1 < argc))
+    {
+      k++;
+      model = (strcmp(argv[k], "class4") == 0) ? &SDCardLatency::class4 : &SDCardLatency::class10;
+    }
+    else if ((strcmp(argv[k], "-o") == 0) && (k + 1 < argc))
+      out = argv[++k];
+    else
+      source = argv[k];
+  }
+  if (!source)
+  {
+    printf("Usage: %s [-m class4|class10] [-o dir] <session log | jpeg dir>\n", argv[0]);
+    return 1;
+  }
+
+  uint32_t *sizes;
+  size_t shots = load_sizes(source, &sizes);
+  if (!shots)
+  {
+    printf("No capture sizes in %s\n", source);
+    return 1;
+  }
+  uint32_t maxSize = 0;
+  uint64_t totalBytes = 0;
+  for (size_t k = 0; k < shots; k++)
+  {
+    totalBytes += sizes[k];
+    if (sizes[k] > maxSize)
+      maxSize = sizes[k];
+  }
+  printf("%zu shots, avg %lluKB, max %uKB, model %s\n", shots, (unsigned long long)(totalBytes / shots / 1024), maxSize / 1024,
+         (model == &SDCardLatency::class4) ? "class4" : "class10");
+
+  uint8_t *data = (uint8_t *)malloc(maxSize);
+  for (uint32_t k = 0; k < maxSize; k++)
+    data[k] = rand();
+  uint32_t *shotUs = (uint32_t *)malloc(shots * sizeof(uint32_t));
+
+  char dir[256];
+  snprintf(dir, sizeof(dir), "%s/DCIM", out);
+  mkdir(out, 0777);
+  mkdir(dir, 0777);
+  snprintf(dir, sizeof(dir), "%s/DCIM/POOL", out);
+  mkdir(dir, 0777);
+
+  printf("\n%-14s %7s %7s %7s %7s %7s | %5s %6s %5s %5s %6s %5s | %s\n", "strategy", "MB/s", "p50 ms", "p99 ms", "max ms", "idle ms",
+         "opens", "writes", "trunc", "renam", "clustr", "FAT", "histogram <25/50/100/200/400/800/1600/more ms");
+
+  for (size_t s = 0; s < sizeof(strategies) / sizeof(strategies[0]); s++)
+  {
+    const strategy_t *strategy = &strategies[s];
+    SDCardLatency latency(model);
+    PosixStorage storage(out, &latency);
+    bool pool[BENCH_POOL] = {false};
+    uint64_t idleUs = 0, shotTotalUs = 0;
+    uint32_t failed = 0;
+    uint32_t histogram[BENCH_BUCKETS] = {0};
+    storage_stats_t shotOps;
+    memset(&shotOps, 0, sizeof(shotOps));
+
+    if (strategy->plan == PLAN_POOL)
+    {
+      while (fill_pool(&storage, pool, BENCH_POOL_MIN))
+        ;
+      storage.resetStats();
+    }
+
+    double start = now_ms();
+    for (size_t k = 0; k < shots; k++)
+    {
+      char path[64];
+      snprintf(path, sizeof(path), "/DCIM/B%07zu.JPG", k % 16);
+      storage.remove(path); // the names are reused, not part of the shot
+
+      storage_stats_t before = *storage.stats();
+      if (!save(&storage, strategy, path, data, sizes[k], pool))
+        failed++;
+      const storage_stats_t *after = storage.stats();
+      shotUs[k] = after->busy_us - before.busy_us;
+      shotTotalUs += shotUs[k];
+      for (int op = 0; op < STORAGE_OPS; op++)
+        shotOps.ops[op] += after->ops[op] - before.ops[op];
+      shotOps.clusters += after->clusters - before.clusters;
+      shotOps.fat_writes += after->fat_writes - before.fat_writes;
+
+      int b = 0;
+      while ((b < BENCH_BUCKETS - 1) && (shotUs[k] >= bucketMs[b] * 1000))
+        b++;
+      histogram[b]++;
+
+      // the writer refills the pool while waiting for the next job
+      if (strategy->plan == PLAN_POOL)
+      {
+        uint64_t idleStart = storage.stats()->busy_us;
+        while (fill_pool(&storage, pool, (maxSize * 5 / 4 + 0x7FFF) & ~0x7FFF))
+          ;
+        idleUs += storage.stats()->busy_us - idleStart;
+      }
+    }
+    double hostMs = now_ms() - start;
+
+    qsort(shotUs, shots, sizeof(uint32_t), cmp_u32);
+    size_t p99 = (shots * 99 + 99) / 100;
+    printf("%-14s %7.2f %7.1f %7.1f %7.1f %7.1f | %5.1f %6.1f %5.1f %5.1f %6.1f %5.1f |", strategy->name,
+           (double)totalBytes / shotTotalUs, shotUs[shots / 2] / 1000.0, shotUs[p99 - 1] / 1000.0, shotUs[shots - 1] / 1000.0,
+           idleUs / 1000.0 / shots, (double)shotOps.ops[STORAGE_OPEN] / shots, (double)shotOps.ops[STORAGE_WRITE] / shots,
+           (double)shotOps.ops[STORAGE_TRUNCATE] / shots, (double)shotOps.ops[STORAGE_RENAME] / shots,
+           (double)shotOps.clusters / shots, (double)shotOps.fat_writes / shots);
+    for (int b = 0; b < BENCH_BUCKETS; b++)
+      printf(" %u", histogram[b]);
+    printf("   (host %.0f MB/s)\n", totalBytes / hostMs / 1000.0);
+    if (failed)
+      printf("%-14s %u saves failed\n", "", failed);
+  }
+
+  free(shotUs);
+  free(data);
+  free(sizes);
+  return 0;
+}
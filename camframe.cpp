@@ -0,0 +1,154 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "camframe.h"
+
+static CameraFrameSource cameraSource;
+static FrameSource *source = &cameraSource;
+static cam_stats_t stats = {0};
+static uint32_t seq = 0;
+static int64_t lastTimestamp = 0, lastCaptured = 0;
+static uint8_t lastKind = CAM_FRAME_FLUSH;
+
+// Switch to another frame source, all frames of the old source must be returned first
+void cam_set_source(FrameSource *frameSource)
+{
+  source = frameSource ? frameSource : &cameraSource;
+  cam_reset_stats();
+}
+
+FrameSource *cam_get_source()
+{
+  return source;
+}
+
+static void cam_bucket_add(cam_bucket_t *b, uint32_t interval)
+{
+  if ((!b->interval_min) || (interval < b->interval_min))
+    b->interval_min = interval;
+  if (interval > b->interval_max)
+    b->interval_max = interval;
+
+  if (!b->interval_avg)
+    b->interval_avg = interval;
+  // RFC 3550 style jitter
+  float d = interval - b->interval_avg;
+  b->jitter += ((d < 0 ? -d : d) - b->jitter) / 16;
+  b->interval_avg += d / 16;
+}
+
+// Consecutive preview capture times are a whole number of sensor periods apart. The
+// period is taken from the source when it knows it, otherwise from the shortest gap.
+static void cam_sensor_pace(cam_frame_t *frame, uint32_t captureInterval)
+{
+  if (!stats.sensor_period)
+  {
+    stats.sensor_period = captureInterval;
+    return;
+  }
+
+  // well short of the period, the first gaps seen were several periods long
+  if (4.0f * captureInterval < 3 * stats.sensor_period)
+    stats.sensor_period = captureInterval;
+
+  uint32_t produced = (captureInterval + stats.sensor_period / 2) / stats.sensor_period;
+  if (produced <= 1)
+    stats.sensor_period += (captureInterval - stats.sensor_period) / 16;
+  else
+  {
+    frame->dropped = produced - 1;
+    stats.dropped += frame->dropped;
+  }
+
+  if (frame->wait_us > CAM_STARVE_PERIODS * stats.sensor_period)
+    stats.starved++;
+}
+
+camera_fb_t *cam_frame_get(cam_frame_t *frame, uint8_t kind)
+{
+  int64_t start = esp_timer_get_time();
+  frame->fb = source->get();
+  int64_t now = esp_timer_get_time();
+
+  frame->timestamp = now;
+  frame->captured = now;
+  frame->wait_us = now - start;
+  frame->dropped = 0;
+  frame->kind = kind;
+
+  if (!frame->fb)
+  {
+    frame->seq = 0;
+    stats.failed++;
+    lastKind = CAM_FRAME_FLUSH;
+    return NULL;
+  }
+
+  frame->seq = ++seq;
+  int64_t captured = (int64_t)frame->fb->timestamp.tv_sec * 1000000 + frame->fb->timestamp.tv_usec;
+  if (captured)
+    frame->captured = captured;
+
+  if (kind == CAM_FRAME_FLUSH)
+    stats.flushed++;
+  else
+  {
+    cam_bucket_t *b = (kind == CAM_FRAME_SNAP) ? &stats.snap : &stats.preview;
+    b->frames++;
+    b->wait_avg += (frame->wait_us - b->wait_avg) / 16;
+    if (lastKind == kind)
+    {
+      cam_bucket_add(b, now - lastTimestamp);
+      if ((kind == CAM_FRAME_PREVIEW) && (frame->captured > lastCaptured))
+        cam_sensor_pace(frame, frame->captured - lastCaptured);
+    }
+  }
+  lastKind = kind;
+  lastTimestamp = now;
+  lastCaptured = frame->captured;
+
+#if (CAM_STATS_INTERVAL > 0)
+  if ((kind == CAM_FRAME_PREVIEW) && ((stats.preview.frames % CAM_STATS_INTERVAL) == 0))
+    cam_print_stats();
+#endif
+
+  return frame->fb;
+}
+
+void cam_frame_return(cam_frame_t *frame)
+{
+  if (frame->fb)
+  {
+    source->release(frame->fb);
+    frame->fb = NULL;
+  }
+}
+
+const cam_stats_t *cam_get_stats()
+{
+  return &stats;
+}
+
+void cam_reset_stats()
+{
+  memset(&stats, 0, sizeof(stats));
+  stats.sensor_period = source->period();
+  lastTimestamp = 0;
+  lastCaptured = 0;
+  lastKind = CAM_FRAME_FLUSH;
+}
+
+static void cam_print_bucket(const char *name, const cam_bucket_t *b)
+{
+  Serial.printf("%s: %lu frames, interval avg %.1fms min %.1fms max %.1fms, jitter %.1fms, wait avg %.1fms\n", name,
+                b->frames, b->interval_avg / 1000, b->interval_min / 1000.0, b->interval_max / 1000.0, b->jitter / 1000,
+                b->wait_avg / 1000);
+}
+
+void cam_print_stats()
+{
+  cam_print_bucket("Preview", &stats.preview);
+  if (stats.snap.frames)
+    cam_print_bucket("Snap", &stats.snap);
+  Serial.printf("Sensor period %.1fms, starved %lu, dropped %lu, flushed %lu, failed %lu\n",
+                stats.sensor_period / 1000, stats.starved, stats.dropped, stats.flushed, stats.failed);
+}
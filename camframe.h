@@ -0,0 +1,58 @@
+#ifndef _CAMFRAMEH_
+#define _CAMFRAMEH_
+
+#include <esp_camera.h>
+#include "framesource.h"
+
+// Print the rolling statistics every CAM_STATS_INTERVAL frames, 0 to disable
+#define CAM_STATS_INTERVAL 50
+// A frame that kept the sketch waiting longer than this many sensor periods counts as starvation
+#define CAM_STARVE_PERIODS 1.5f
+
+// What a frame is fetched for, each kind is timed on its own
+#define CAM_FRAME_PREVIEW 0
+#define CAM_FRAME_SNAP 1
+#define CAM_FRAME_FLUSH 2 // thrown away after a settings change, only counted
+
+// Camera frame buffer plus delivery information
+typedef struct
+{
+  camera_fb_t *fb;
+  int64_t timestamp; // esp_timer time when the frame was delivered, us
+  int64_t captured;  // when the sensor finished it, the delivery time if the source has none
+  uint32_t seq;      // delivery sequence number, counts from 1
+  uint32_t wait_us;  // time blocked in esp_camera_fb_get()
+  uint32_t dropped;  // frames dropped by the driver just before this one
+  uint8_t kind;
+} cam_frame_t;
+
+// Intervals are between frames of the same kind fetched one after the other
+typedef struct
+{
+  uint32_t frames;       // frames delivered
+  float interval_avg;    // smoothed inter-frame interval, us
+  float jitter;          // smoothed inter-frame interval deviation, us
+  uint32_t interval_min; // us
+  uint32_t interval_max; // us
+  float wait_avg;        // smoothed wait in esp_camera_fb_get(), us
+} cam_bucket_t;
+
+typedef struct
+{
+  uint32_t failed;     // esp_camera_fb_get() returned no frame
+  uint32_t flushed;    // CAM_FRAME_FLUSH frames
+  uint32_t starved;    // preview frames that kept the sketch waiting for a free buffer
+  uint32_t dropped;    // frames dropped by the driver between preview frames (estimated)
+  float sensor_period; // sensor frame period from the capture times, us
+  cam_bucket_t preview, snap;
+} cam_stats_t;
+
+void cam_set_source(FrameSource *frameSource);
+FrameSource *cam_get_source();
+camera_fb_t *cam_frame_get(cam_frame_t *frame, uint8_t kind = CAM_FRAME_PREVIEW);
+void cam_frame_return(cam_frame_t *frame);
+const cam_stats_t *cam_get_stats();
+void cam_reset_stats();
+void cam_print_stats();
+
+#endif
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "capfile.h"
+
+#ifdef ARDUINO
+#include <rom/crc.h>
+
+// ROM implementation, same result as the table below
+uint32_t capfile_crc32(uint32_t crc, const void *data, size_t len)
+{
+  return crc32_le(crc, (const uint8_t *)data, len);
+}
+#else
+uint32_t capfile_crc32(uint32_t crc, const void *data, size_t len)
+{
+  static uint32_t table[256];
+  if (!table[1])
+  {
+    for (uint32_t k = 0; k < 256; k++)
+    {
+      uint32_t c = k;
+      for (int bit = 0; bit < 8; bit++)
+        c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+      table[k] = c;
+    }
+  }
+
+  const uint8_t *p = (const uint8_t *)data;
+  crc = ~crc;
+  while (len--)
+    crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+#endif
+
+// "/DCIM/100ESPDC/DSC_0001.JPG" to "/DCIM/100ESPDC/DSC_0001.TMP"
+void capfile_temp_path(const char *path, char *temp, size_t size)
+{
+  snprintf(temp, size, "%s", path);
+  char *ext = strrchr(temp, '.');
+  if ((ext) && (strlen(ext) == 4))
+    memcpy(ext, CAPFILE_TEMP_EXT, 4);
+}
+
+void capfile_footer(capfile_footer_t *footer, uint32_t length, uint32_t crc)
+{
+  footer->magic = CAPFILE_MAGIC;
+  footer->length = length;
+  footer->crc = crc;
+}
+
+// The temporary file is closed, give it its final name. Fails when a file of that name
+// is already there, it is never replaced: the caller takes the next file number.
+bool capfile_commit(Storage *storage, const char *temp, const char *path)
+{
+  return storage->rename(temp, path) == 0;
+}
+
+// CRC32 of the first "length" bytes of an open file
+static bool capfile_verify(Storage *storage, int fd, uint32_t length, uint32_t crc)
+{
+  uint8_t *buf = (uint8_t *)malloc(CAPFILE_VERIFY_CHUNK);
+  if (!buf)
+    return false;
+  uint32_t sum = 0;
+  bool ok = storage->seek(fd, 0, SEEK_SET) == 0;
+  for (uint32_t pos = 0; (ok) && (pos < length); pos += CAPFILE_VERIFY_CHUNK)
+  {
+    size_t n = (length - pos < CAPFILE_VERIFY_CHUNK) ? length - pos : CAPFILE_VERIFY_CHUNK;
+    ok = storage->read(fd, buf, n) == (ssize_t)n;
+    sum = capfile_crc32(sum, buf, n);
+  }
+  free(buf);
+  return ok && (sum == crc);
+}
+
+// Looks at the last bytes only, with "verify" the data is read back against the CRC
+capfile_state_t capfile_check(Storage *storage, const char *path, bool verify)
+{
+  size_t size;
+  if (!storage->exists(path, &size))
+    return CAPFILE_MISSING;
+  if (size < sizeof(capfile_footer_t))
+    return CAPFILE_BAD;
+
+  int fd = storage->open(path, O_RDONLY);
+  if (fd < 0)
+    return CAPFILE_BAD;
+  capfile_footer_t footer;
+  bool read = (storage->seek(fd, size - sizeof(footer), SEEK_SET) >= 0) && (storage->read(fd, &footer, sizeof(footer)) == sizeof(footer));
+  bool framed = (read) && (footer.magic == CAPFILE_MAGIC) && (footer.length == size - sizeof(footer));
+  bool intact = (framed) && ((!verify) || (capfile_verify(storage, fd, footer.length, footer.crc)));
+  storage->close(fd);
+  if (!read)
+    return CAPFILE_BAD;
+
+  if (framed)
+    return intact ? CAPFILE_OK : CAPFILE_BAD;
+  const uint8_t *tail = (const uint8_t *)&footer + sizeof(footer) - 2;
+  return ((tail[0] == 0xFF) && (tail[1] == 0xD9)) ? CAPFILE_LEGACY : CAPFILE_BAD;
+}
+
+// Clean up after a power loss: temporary files of the newest "depth" file numbers are
+// removed, final files without a valid ending are renamed out of the way. Only the footer
+// is read, the CRC is checked just for a number whose temporary file is still there (the
+// save was cut around its rename). Returns the number of files dealt with.
+uint32_t capfile_recover(Storage *storage, const char *folder, const char *prefix, uint16_t last, uint8_t depth)
+{
+  char path[STORAGE_PATH_SIZE], temp[STORAGE_PATH_SIZE], bad[STORAGE_PATH_SIZE];
+  uint32_t fixed = 0;
+
+  for (uint16_t n = last; (n > 0) && (n + depth > last); n--)
+  {
+    snprintf(path, sizeof(path), "%s/%s%04u.JPG", folder, prefix, n);
+    snprintf(temp, sizeof(temp), "%s/%s%04u" CAPFILE_TEMP_EXT, folder, prefix, n);
+    snprintf(bad, sizeof(bad), "%s/%s%04u" CAPFILE_BAD_EXT, folder, prefix, n);
+
+    bool interrupted = storage->exists(temp);
+    capfile_state_t state = capfile_check(storage, path, interrupted);
+    if (interrupted)
+    {
+      // with the final name in place the rename got through, both entries share one
+      // cluster chain and removing the temporary one would free it
+      if (state == CAPFILE_MISSING)
+      {
+        storage->remove(temp);
+        fixed++;
+      }
+    }
+    if (state == CAPFILE_BAD)
+    {
+      storage->remove(bad); // an older bad capture of the same number
+      storage->rename(path, bad);
+      fixed++;
+    }
+  }
+  return fixed;
+}
+
+// Reference save path: temporary file, data in chunks, footer, rename. The SD writer
+// does the same through its DMA chunk writer. With "pool" a preallocated file becomes the
+// temporary file and is truncated to size at the end, otherwise "prealloc" allocates the
+// cluster chain before the data is written.
+bool capfile_write(Storage *storage, const char *path, const uint8_t *head, size_t headLen, const uint8_t *buf, size_t len, size_t chunk,
+                   bool prealloc, const char *pool)
+{
+  char temp[STORAGE_PATH_SIZE];
+  capfile_temp_path(path, temp, sizeof(temp));
+  size_t lens[2] = {head ? headLen : 0, len};
+  size_t total = lens[0] + lens[1] + sizeof(capfile_footer_t);
+
+  bool pooled = false;
+  if (pool)
+  {
+    storage->remove(temp);
+    pooled = storage->rename(pool, temp) == 0;
+  }
+  int fd = pooled ? storage->open(temp, O_WRONLY) : storage->open(temp, O_WRONLY | O_CREAT | O_TRUNC);
+  if (fd < 0)
+    return false;
+  if ((!pooled) && (prealloc))
+    storage->preallocate(fd, total);
+
+  bool ok = true;
+  uint32_t crc = 0;
+  const uint8_t *parts[2] = {head, buf};
+  for (int p = 0; p < 2; p++)
+  {
+    for (size_t pos = 0; (ok) && (pos < lens[p]); pos += chunk)
+    {
+      size_t n = (lens[p] - pos < chunk) ? lens[p] - pos : chunk;
+      crc = capfile_crc32(crc, parts[p] + pos, n);
+      ok = storage->write(fd, parts[p] + pos, n) == (ssize_t)n;
+    }
+  }
+
+  capfile_footer_t footer;
+  capfile_footer(&footer, lens[0] + lens[1], crc);
+  ok = ok && (storage->write(fd, &footer, sizeof(footer)) == sizeof(footer));
+  if ((ok) && (pooled))
+    ok = storage->truncate(fd, total) == 0;
+  ok = (storage->close(fd) == 0) && ok;
+  return ok && capfile_commit(storage, temp, path);
+}
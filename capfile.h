@@ -0,0 +1,41 @@
+#ifndef _CAPFILEH_
+#define _CAPFILEH_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "storage.h"
+
+// Crash safe capture files: the data is streamed to a temporary name, followed by a
+// footer holding its length and CRC32 (computed while streaming, the data is never read
+// back), and only then renamed to the final name. Viewers ignore bytes after the EOI.
+#define CAPFILE_TEMP_EXT ".TMP"
+#define CAPFILE_BAD_EXT ".BAD"
+#define CAPFILE_MAGIC 0x43524353 // "SCRC"
+#define CAPFILE_RECOVER_DEPTH 4  // newest file numbers checked at mount
+#define CAPFILE_VERIFY_CHUNK 4096 // bytes read at a time to check the CRC
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t length; // bytes before the footer
+  uint32_t crc;    // CRC32 of those bytes
+} capfile_footer_t;
+
+typedef enum
+{
+  CAPFILE_MISSING,
+  CAPFILE_OK,     // footer matches the file length (and the CRC when verified)
+  CAPFILE_LEGACY, // no footer but ends with EOI, written before footers existed
+  CAPFILE_BAD
+} capfile_state_t;
+
+uint32_t capfile_crc32(uint32_t crc, const void *data, size_t len);
+void capfile_temp_path(const char *path, char *temp, size_t size);
+void capfile_footer(capfile_footer_t *footer, uint32_t length, uint32_t crc);
+bool capfile_commit(Storage *storage, const char *temp, const char *path);
+capfile_state_t capfile_check(Storage *storage, const char *path, bool verify = false);
+uint32_t capfile_recover(Storage *storage, const char *folder, const char *prefix, uint16_t last, uint8_t depth = CAPFILE_RECOVER_DEPTH);
+bool capfile_write(Storage *storage, const char *path, const uint8_t *head, size_t headLen, const uint8_t *buf, size_t len, size_t chunk,
+                   bool prealloc = false, const char *pool = NULL);
+
+#endif
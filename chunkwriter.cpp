@@ -0,0 +1,164 @@
+#include "chunkwriter.h"
+#include "capfile.h"
+
+typedef struct
+{
+  uint8_t idx;
+  size_t len;
+} chunk_t;
+
+ChunkWriter::ChunkWriter()
+{
+  _buf[0] = _buf[1] = NULL;
+  _chunkSize = 0;
+  _fill = 0;
+  _cur = 0;
+  _owned = false;
+  _storage = NULL;
+  _fd = -1;
+  _crc = 0;
+  _ok = true;
+  _flushQueue = NULL;
+  _free[0] = _free[1] = NULL;
+  _task = NULL;
+}
+
+ChunkWriter::~ChunkWriter()
+{
+  end();
+}
+
+// chunkSize is rounded down to whole sectors
+bool ChunkWriter::begin(size_t chunkSize)
+{
+  end();
+
+  _chunkSize = chunkSize & ~(CHUNK_SECTOR_SIZE - 1);
+  if (!_chunkSize)
+    _chunkSize = CHUNK_SECTOR_SIZE;
+
+  _buf[0] = (uint8_t *)heap_caps_malloc(_chunkSize, MALLOC_CAP_DMA);
+  _buf[1] = (uint8_t *)heap_caps_malloc(_chunkSize, MALLOC_CAP_DMA);
+  _flushQueue = xQueueCreate(2, sizeof(chunk_t));
+  _free[0] = xSemaphoreCreateBinary();
+  _free[1] = xSemaphoreCreateBinary();
+  if ((!_buf[0]) || (!_buf[1]) || (!_flushQueue) || (!_free[0]) || (!_free[1]))
+  {
+    end();
+    return false;
+  }
+  xSemaphoreGive(_free[0]);
+  xSemaphoreGive(_free[1]);
+
+  if (xTaskCreate(flushTask, "ChunkFlushTask", CHUNK_TASK_STACK, this, CHUNK_TASK_PRIORITY, &_task) != pdPASS)
+  {
+    _task = NULL;
+    end();
+    return false;
+  }
+  return true;
+}
+
+void ChunkWriter::end()
+{
+  if (_task)
+  {
+    finish();
+    vTaskDelete(_task);
+    _task = NULL;
+  }
+  if (_flushQueue)
+    vQueueDelete(_flushQueue);
+  if (_free[0])
+    vSemaphoreDelete(_free[0]);
+  if (_free[1])
+    vSemaphoreDelete(_free[1]);
+  if (_buf[0])
+    heap_caps_free(_buf[0]);
+  if (_buf[1])
+    heap_caps_free(_buf[1]);
+  _flushQueue = NULL;
+  _free[0] = _free[1] = NULL;
+  _buf[0] = _buf[1] = NULL;
+}
+
+void ChunkWriter::flushTask(void *parameter)
+{
+  ChunkWriter *w = (ChunkWriter *)parameter;
+  chunk_t chunk;
+
+  for (;;)
+  {
+    if (xQueueReceive(w->_flushQueue, &chunk, portMAX_DELAY) != pdTRUE)
+      continue;
+    if (w->_storage->write(w->_fd, w->_buf[chunk.idx], chunk.len) != (ssize_t)chunk.len)
+      w->_ok = false;
+    xSemaphoreGive(w->_free[chunk.idx]);
+  }
+}
+
+void ChunkWriter::start(Storage *storage, int fd)
+{
+  _storage = storage;
+  _fd = fd;
+  _crc = 0;
+  _fill = 0;
+  _ok = true;
+}
+
+void ChunkWriter::submit()
+{
+  chunk_t chunk = {_cur, _fill};
+  xQueueSend(_flushQueue, &chunk, portMAX_DELAY);
+  _owned = false;
+  _cur ^= 1;
+  _fill = 0;
+}
+
+bool ChunkWriter::write(const uint8_t *data, size_t len)
+{
+  while (len)
+  {
+    if (!_owned)
+    {
+      // wait until the card is done with this buffer
+      xSemaphoreTake(_free[_cur], portMAX_DELAY);
+      _owned = true;
+    }
+
+    size_t n = _chunkSize - _fill;
+    if (n > len)
+      n = len;
+    // the data is in cache now, checksum it on the way through
+    _crc = capfile_crc32(_crc, data, n);
+    memcpy(_buf[_cur] + _fill, data, n);
+    _fill += n;
+    data += n;
+    len -= n;
+
+    if (_fill == _chunkSize)
+      submit();
+  }
+  return _ok;
+}
+
+// Write out the partial last chunk and wait for the card
+bool ChunkWriter::finish()
+{
+  if (_owned)
+  {
+    if (_fill)
+      submit();
+    else
+    {
+      xSemaphoreGive(_free[_cur]);
+      _owned = false;
+    }
+  }
+  for (int k = 0; k < 2; k++)
+  {
+    xSemaphoreTake(_free[k], portMAX_DELAY);
+    xSemaphoreGive(_free[k]);
+  }
+  return _ok;
+}
@@ -0,0 +1,48 @@
+#ifndef _CHUNKWRITERH_
+#define _CHUNKWRITERH_
+
+#include <Arduino.h>
+#include "storage.h"
+
+#define CHUNK_SECTOR_SIZE 512
+#define CHUNK_TASK_STACK 4096
+#define CHUNK_TASK_PRIORITY 2
+
+// Stream data to a storage file in sector aligned chunks. Data is staged through two DMA capable
+// buffers in internal RAM; a flush task writes one buffer to the card while the caller
+// copies the next chunk into the other.
+class ChunkWriter
+{
+public:
+  ChunkWriter();
+  ~ChunkWriter();
+
+  bool begin(size_t chunkSize);
+  void end();
+  size_t chunkSize() { return _chunkSize; }
+
+  void start(Storage *storage, int fd);
+  bool write(const uint8_t *data, size_t len);
+  bool finish();
+  uint32_t crc() { return _crc; } // CRC32 of the data written since start()
+
+private:
+  static void flushTask(void *parameter);
+  void submit();
+
+  uint8_t *_buf[2];
+  size_t _chunkSize;
+  size_t _fill;
+  uint8_t _cur;
+  bool _owned; // holding the current buffer
+  Storage *_storage;
+  int _fd;
+  uint32_t _crc;
+  volatile bool _ok;
+
+  QueueHandle_t _flushQueue;
+  SemaphoreHandle_t _free[2];
+  TaskHandle_t _task;
+};
+
+#endif
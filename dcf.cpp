@@ -0,0 +1,236 @@
+#include <Arduino.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "dcf.h"
+
+static dcf_folder_t *folders = NULL;
+static uint16_t folderCount = 0;
+static uint16_t folderSize = 0;
+static uint16_t curFolder = 0; // 0 until the first folder is created
+static uint16_t curFile = 0;
+static bool curOwn = false; // the current folder was created by this camera
+
+// Value of "digits" decimal digits, -1 if any of them is not a digit
+static int dcf_number(const char *s, int digits)
+{
+  int value = 0;
+  for (int k = 0; k < digits; k++)
+  {
+    if ((s[k] < '0') || (s[k] > '9'))
+      return -1;
+    value = value * 10 + s[k] - '0';
+  }
+  return value;
+}
+
+// NNNxxxxx, 100-999
+static int dcf_folder_number(const char *name)
+{
+  if (strlen(name) != 8)
+    return -1;
+  int folder = dcf_number(name, 3);
+  return ((folder >= DCF_FIRST_FOLDER) && (folder <= DCF_LAST_FOLDER)) ? folder : -1;
+}
+
+// xxxxNNNN.JPG, 1-9999. Temporary and bad captures do not hold on to their number.
+static int dcf_file_number(const char *name)
+{
+  if ((strlen(name) != 12) || (strcasecmp(name + 8, ".JPG") != 0))
+    return -1;
+  int file = dcf_number(name + 4, 4);
+  return (file >= 1) ? file : -1;
+}
+
+static dcf_folder_t *dcf_find(uint16_t folder)
+{
+  for (uint16_t k = 0; k < folderCount; k++)
+  {
+    if (folders[k].folder == folder)
+      return &folders[k];
+  }
+  return NULL;
+}
+
+static dcf_folder_t *dcf_add(uint16_t folder)
+{
+  dcf_folder_t *entry = dcf_find(folder);
+  if (entry)
+    return entry;
+
+  if (folderCount == folderSize)
+  {
+    uint16_t size = folderSize ? folderSize * 2 : 8;
+    dcf_folder_t *grown = (dcf_folder_t *)realloc(folders, size * sizeof(dcf_folder_t));
+    if (!grown)
+      return NULL;
+    folders = grown;
+    folderSize = size;
+  }
+
+  // keep the index sorted by folder number
+  uint16_t k = folderCount;
+  while ((k > 0) && (folders[k - 1].folder > folder))
+  {
+    folders[k] = folders[k - 1];
+    k--;
+  }
+  folders[k].folder = folder;
+  folders[k].last_file = 0;
+  folderCount++;
+  return &folders[k];
+}
+
+static uint16_t dcf_scan_folder(const char *name)
+{
+  char path[48];
+  snprintf(path, sizeof(path), DCF_MOUNT DCF_ROOT "/%s", name);
+
+  DIR *dir = opendir(path);
+  if (!dir)
+    return 0;
+
+  int lastFile = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    int file = dcf_file_number(entry->d_name);
+    if (file > lastFile)
+      lastFile = file;
+  }
+  closedir(dir);
+  return lastFile;
+}
+
+// One walk of DCIM, with "files" the DCF folders are walked too. Readdir on the VFS
+// returns names only, no file is opened.
+static bool dcf_scan(bool files)
+{
+  DIR *dir = opendir(DCF_MOUNT DCF_ROOT);
+  if (!dir)
+    return false;
+
+  folderCount = 0;
+  curFolder = 0;
+  curOwn = false;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    int folder = dcf_folder_number(entry->d_name);
+    if (folder < 0)
+      continue;
+    dcf_folder_t *f = dcf_add(folder);
+    if (!f)
+      break;
+    if (files)
+      f->last_file = dcf_scan_folder(entry->d_name);
+    if (folder >= curFolder)
+    {
+      curFolder = folder;
+      curOwn = (strcasecmp(entry->d_name + 3, DCF_FOLDER_NAME) == 0);
+    }
+  }
+  closedir(dir);
+
+  dcf_folder_t *last = dcf_find(curFolder);
+  curFile = last ? last->last_file : 0;
+  return true;
+}
+
+// Build the folder index. A hint of the last folder and file written (from NVS) is
+// trusted when its folder is still the newest one and the file after it does not exist,
+// then only DCIM itself is listed.
+bool dcf_begin(uint16_t hint_folder, uint16_t hint_file)
+{
+  if ((hint_folder >= DCF_FIRST_FOLDER) && (hint_folder <= DCF_LAST_FOLDER) && (hint_file <= DCF_LAST_FILE))
+  {
+    char path[48];
+    struct stat st;
+    snprintf(path, sizeof(path), DCF_MOUNT DCF_ROOT "/%03d" DCF_FOLDER_NAME "/" DCF_FILE_NAME "%04d.JPG", hint_folder, hint_file + 1);
+    if ((stat(path, &st) != 0) && (dcf_scan(false)) && (curFolder == hint_folder) && (curOwn))
+    {
+      curFile = hint_file;
+      dcf_find(curFolder)->last_file = hint_file;
+      return true;
+    }
+  }
+  return dcf_scan(true);
+}
+
+// A capture is never written over an existing file, see capfile_commit()
+static bool dcf_taken(const char *path)
+{
+  char full[48];
+  struct stat st;
+  snprintf(full, sizeof(full), DCF_MOUNT "%s", path);
+  return stat(full, &st) == 0;
+}
+
+// Advance to the next free file name, starting a new folder after file 9999. Numbers
+// whose file is already there (written by something else) are skipped. Fails when the
+// folder numbers run out or the new folder cannot be created.
+bool dcf_next(char *path, size_t size)
+{
+  do
+  {
+    if ((!curFolder) || (!curOwn) || (curFile >= DCF_LAST_FILE))
+    {
+      uint16_t folder = curFolder ? curFolder + 1 : DCF_FIRST_FOLDER;
+      if (folder > DCF_LAST_FOLDER)
+        return false; // the card is full as far as DCF is concerned
+
+      char dirPath[32];
+      snprintf(dirPath, sizeof(dirPath), DCF_MOUNT DCF_ROOT "/%03d" DCF_FOLDER_NAME, folder);
+      if ((mkdir(dirPath, 0777) != 0) && (errno != EEXIST))
+      {
+        Serial.printf("DCF: cannot create %s\n", dirPath);
+        return false;
+      }
+      if (!dcf_add(folder))
+        return false;
+      Serial.printf("DCF: new folder %s\n", dirPath);
+
+      curFolder = folder;
+      curFile = 0;
+      curOwn = true;
+    }
+
+    curFile++;
+    dcf_find(curFolder)->last_file = curFile;
+    dcf_path(path, size);
+  } while (dcf_taken(path));
+  return true;
+}
+
+// Name of the current file, relative to the mount point
+void dcf_path(char *path, size_t size)
+{
+  snprintf(path, size, DCF_ROOT "/%03d" DCF_FOLDER_NAME "/" DCF_FILE_NAME "%04d.JPG", curFolder, curFile);
+}
+
+uint16_t dcf_folder()
+{
+  return curFolder;
+}
+
+uint16_t dcf_file()
+{
+  return curFile;
+}
+
+uint16_t dcf_folder_count()
+{
+  return folderCount;
+}
+
+const dcf_folder_t *dcf_get_folder(uint16_t k)
+{
+  return (k < folderCount) ? &folders[k] : NULL;
+}
+
+void dcf_print_index()
+{
+  Serial.printf("DCF: %u folders, current %03u file %04u\n", folderCount, curFolder, curFile);
+  for (uint16_t k = 0; k < folderCount; k++)
+    Serial.printf("DCF: %03u last file %04u\n", folders[k].folder, folders[k].last_file);
+}
@@ -0,0 +1,35 @@
+#ifndef _DCFH_
+#define _DCFH_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// DCF (Design rule for Camera File system) naming: /DCIM/NNNxxxxx/xxxxNNNN.JPG with
+// folder numbers 100-999 and file numbers 0001-9999. A new folder is started when the
+// file number passes 9999.
+#define DCF_MOUNT "/sd" // VFS mount point of the SD library
+#define DCF_ROOT "/DCIM"
+#define DCF_FOLDER_NAME "ESPDC" // 5 characters
+#define DCF_FILE_NAME "DSC_"    // 4 characters
+#define DCF_FIRST_FOLDER 100
+#define DCF_LAST_FOLDER 999
+#define DCF_LAST_FILE 9999
+#define DCF_PATH_SIZE 31
+
+// One entry per DCF folder on the card
+typedef struct
+{
+  uint16_t folder;    // 100-999
+  uint16_t last_file; // highest file number seen, 0 for an empty or unscanned folder
+} dcf_folder_t;
+
+bool dcf_begin(uint16_t hint_folder = 0, uint16_t hint_file = 0);
+bool dcf_next(char *path, size_t size);
+void dcf_path(char *path, size_t size);
+uint16_t dcf_folder();
+uint16_t dcf_file();
+uint16_t dcf_folder_count();
+const dcf_folder_t *dcf_get_folder(uint16_t k);
+void dcf_print_index();
+
+#endif
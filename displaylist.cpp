@@ -0,0 +1,162 @@
+#include <stdlib.h>
+#include <string.h>
+#include "displaylist.h"
+
+static bool dl_intersects(const dl_cmd_t &a, const dl_cmd_t &b)
+{
+  return (a.x < b.x + b.w) && (b.x < a.x + a.w) && (a.y < b.y + b.h) && (b.y < a.y + a.h);
+}
+
+static bool dl_contains(const dl_cmd_t &outer, const dl_cmd_t &inner)
+{
+  return (inner.x >= outer.x) && (inner.y >= outer.y) && (inner.x + inner.w <= outer.x + outer.w) &&
+         (inner.y + inner.h <= outer.y + outer.h);
+}
+
+// Drawing order only matters between commands that overlap with different colours
+static bool dl_conflicts(const dl_cmd_t &a, const dl_cmd_t &b)
+{
+  return (a.color != b.color) && dl_intersects(a, b);
+}
+
+// Raster order of the top left corner
+static bool dl_before(const dl_cmd_t &a, const dl_cmd_t &b)
+{
+  return (a.y < b.y) || ((a.y == b.y) && (a.x < b.x));
+}
+
+// Grow "a" by "b" when together they are exactly one rectangle of one colour
+static bool dl_merge(dl_cmd_t &a, const dl_cmd_t &b)
+{
+  if (a.color != b.color)
+    return false;
+
+  if ((a.y == b.y) && (a.h == b.h) && (b.x <= a.x + a.w) && (a.x <= b.x + b.w))
+  {
+    int16_t xe = (a.x + a.w > b.x + b.w) ? a.x + a.w : b.x + b.w;
+    a.x = (a.x < b.x) ? a.x : b.x;
+    a.w = xe - a.x;
+    return true;
+  }
+  if ((a.x == b.x) && (a.w == b.w) && (b.y <= a.y + a.h) && (a.y <= b.y + b.h))
+  {
+    int16_t ye = (a.y + a.h > b.y + b.h) ? a.y + a.h : b.y + b.h;
+    a.y = (a.y < b.y) ? a.y : b.y;
+    a.h = ye - a.y;
+    return true;
+  }
+  return false;
+}
+
+DisplayList::DisplayList(uint16_t capacity)
+{
+  _cmds = (dl_cmd_t *)malloc(capacity * sizeof(dl_cmd_t));
+  _capacity = _cmds ? capacity : 0;
+  _count = 0;
+  resetStats();
+}
+
+DisplayList::~DisplayList()
+{
+  free(_cmds);
+}
+
+void DisplayList::resetStats()
+{
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+/***************************************************************************************
+** Function name:           add
+** Description:             record a solid rectangle, false when the list is full
+***************************************************************************************/
+// Runs of pixels and lines usually continue the last command, so that merge is done here
+bool DisplayList::add(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  dl_cmd_t c = {x, y, w, h, color};
+  if ((w < 1) || (h < 1))
+    return true;
+
+  if ((_count) && (dl_merge(_cmds[_count - 1], c)))
+  {
+    _stats.recorded++;
+    _stats.merged++;
+    return true;
+  }
+  if (_count >= _capacity)
+    return false;
+
+  _stats.recorded++;
+  _cmds[_count++] = c;
+  return true;
+}
+
+void DisplayList::clear()
+{
+  _count = 0;
+}
+
+/***************************************************************************************
+** Function name:           optimize
+** Description:             drop overdrawn commands, sort by address, merge neighbours
+***************************************************************************************/
+void DisplayList::optimize()
+{
+  // a command painted over completely by a later one never shows
+  uint16_t n = 0;
+  for (uint16_t i = 0; i < _count; i++)
+  {
+    bool covered = false;
+    for (uint16_t j = i + 1; (j < _count) && (j <= i + DL_REORDER_REACH) && (!covered); j++)
+      covered = dl_contains(_cmds[j], _cmds[i]);
+    if (covered)
+      _stats.covered++;
+    else
+      _cmds[n++] = _cmds[i];
+  }
+  _count = n;
+
+  // insertion sort, a command stops at the first earlier one it must stay behind
+  for (uint16_t i = 1; i < _count; i++)
+  {
+    dl_cmd_t c = _cmds[i];
+    uint16_t j = i;
+    while ((j > 0) && (j + DL_REORDER_REACH > i) && (dl_before(c, _cmds[j - 1])) && (!dl_conflicts(c, _cmds[j - 1])))
+    {
+      _cmds[j] = _cmds[j - 1];
+      j--;
+    }
+    _cmds[j] = c;
+  }
+
+  // merge into a recent command when nothing in between has to be drawn before it
+  n = 0;
+  for (uint16_t i = 0; i < _count; i++)
+  {
+    const dl_cmd_t &c = _cmds[i];
+    bool merged = false;
+    for (int k = n - 1; (k >= 0) && (k >= n - DL_MERGE_LOOKBACK); k--)
+    {
+      if (dl_merge(_cmds[k], c))
+      {
+        merged = true;
+        break;
+      }
+      if (dl_conflicts(_cmds[k], c))
+        break;
+    }
+    if (merged)
+      _stats.merged++;
+    else
+      _cmds[n++] = c;
+  }
+  _count = n;
+}
+
+void DisplayList::replayed()
+{
+  _stats.replays++;
+  _stats.windows += _count;
+  for (uint16_t k = 0; k < _count; k++)
+    _stats.pixels += (uint32_t)_cmds[k].w * _cmds[k].h;
+}
@@ -0,0 +1,58 @@
+#ifndef _DISPLAYLISTH_
+#define _DISPLAYLISTH_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DL_MAX_CMDS 512     // default capacity, 10 bytes each
+#define DL_REORDER_REACH 8  // commands a command is compared with when dropping and sorting
+#define DL_MERGE_LOOKBACK 8 // earlier commands a command may be merged into
+
+// Solid rectangle, pixels and lines are rectangles of width or height 1
+typedef struct
+{
+  int16_t x, y, w, h;
+  uint16_t color;
+} dl_cmd_t;
+
+typedef struct
+{
+  uint32_t recorded; // primitives added
+  uint32_t merged;   // folded into an adjacent command
+  uint32_t covered;  // dropped, a later command paints over all of it
+  uint32_t replays;
+  uint32_t windows;  // commands left to replay, one address window each
+  uint64_t pixels;   // pixels replayed
+} dl_stats_t;
+
+// Command buffer for record/replay drawing. Primitives are added as rectangles, then
+// optimize() drops overdrawn commands, sorts the rest by address and merges adjacent
+// ones of the same colour. Commands only move past commands they do not overlap (or
+// that have the same colour), so the replayed picture is the one that was drawn.
+class DisplayList
+{
+public:
+  DisplayList(uint16_t capacity = DL_MAX_CMDS);
+  ~DisplayList();
+
+  bool add(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color); // false when full
+  void optimize();
+  void clear();
+
+  uint16_t count() { return _count; }
+  uint16_t capacity() { return _capacity; }
+  const dl_cmd_t *cmds() { return _cmds; }
+
+  // counted by the replayer, one call per replay
+  void replayed();
+
+  const dl_stats_t *stats() { return &_stats; }
+  void resetStats();
+
+private:
+  dl_cmd_t *_cmds;
+  uint16_t _count, _capacity;
+  dl_stats_t _stats;
+};
+
+#endif
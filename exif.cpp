@@ -0,0 +1,262 @@
+#include <stdlib.h>
+#include <string.h>
+#include "exif.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <img_converters.h>
+#endif
+
+#define EXIF_SHORT 3
+#define EXIF_LONG 4
+#define EXIF_ASCII 2
+#define EXIF_RATIONAL 5
+#define EXIF_SRATIONAL 10
+#define EXIF_UNDEFINED 7
+#define EXIF_HEAD_SIZE 512 // SOI, APP1 header and all IFDs
+
+// Big endian TIFF structure, offsets are from the TIFF header
+typedef struct
+{
+  uint8_t *tiff;
+  uint32_t size;  // room from tiff on
+  uint32_t entry; // next IFD entry
+  uint32_t data;  // next free byte of the value area
+  bool ok;
+} exif_writer_t;
+
+static void exif_put16(uint8_t *p, uint16_t v)
+{
+  p[0] = v >> 8;
+  p[1] = v;
+}
+
+static void exif_put32(uint8_t *p, uint32_t v)
+{
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+// Start an IFD of "count" entries at the current data position, its values follow it.
+// Returns the offset of its next IFD link.
+static uint32_t exif_ifd(exif_writer_t *w, uint16_t count)
+{
+  uint32_t next = w->data + 2 + count * 12;
+  if (next + 4 > w->size)
+  {
+    w->ok = false;
+    return 0;
+  }
+  exif_put16(w->tiff + w->data, count);
+  exif_put32(w->tiff + next, 0);
+  w->entry = w->data + 2;
+  w->data = next + 4;
+  return next;
+}
+
+static void exif_entry(exif_writer_t *w, uint16_t tag, uint16_t type, uint32_t count, const void *value, uint32_t bytes)
+{
+  if ((!w->ok) || (w->entry + 12 > w->size))
+  {
+    w->ok = false;
+    return;
+  }
+  uint8_t *e = w->tiff + w->entry;
+  exif_put16(e, tag);
+  exif_put16(e + 2, type);
+  exif_put32(e + 4, count);
+  memset(e + 8, 0, 4);
+  if (bytes <= 4)
+    memcpy(e + 8, value, bytes); // left justified in the value field
+  else if (w->data + bytes <= w->size)
+  {
+    exif_put32(e + 8, w->data);
+    memcpy(w->tiff + w->data, value, bytes);
+    w->data += (bytes + 1) & ~1; // values start on a word boundary
+  }
+  else
+    w->ok = false;
+  w->entry += 12;
+}
+
+static void exif_short(exif_writer_t *w, uint16_t tag, uint16_t v)
+{
+  uint8_t b[2];
+  exif_put16(b, v);
+  exif_entry(w, tag, EXIF_SHORT, 1, b, 2);
+}
+
+static void exif_long(exif_writer_t *w, uint16_t tag, uint32_t v)
+{
+  uint8_t b[4];
+  exif_put32(b, v);
+  exif_entry(w, tag, EXIF_LONG, 1, b, 4);
+}
+
+static void exif_rational(exif_writer_t *w, uint16_t tag, uint16_t type, uint32_t num, uint32_t den)
+{
+  uint8_t b[8];
+  exif_put32(b, num);
+  exif_put32(b + 4, den);
+  exif_entry(w, tag, type, 1, b, 8);
+}
+
+static void exif_ascii(exif_writer_t *w, uint16_t tag, const char *s)
+{
+  uint32_t n = strlen(s) + 1;
+  exif_entry(w, tag, EXIF_ASCII, n, s, n);
+}
+
+uint8_t *exif_build(const exif_info_t *info, const uint8_t *thumb, size_t thumbLen, size_t *len)
+{
+  // APP1 length is 16 bits
+  if (EXIF_HEAD_SIZE + thumbLen > 0xFFFF)
+    thumb = NULL;
+  if (!thumb)
+    thumbLen = 0;
+
+  uint8_t *head = (uint8_t *)malloc(EXIF_HEAD_SIZE + thumbLen);
+  if (!head)
+    return NULL;
+
+  // SOI, APP1 marker and length, "Exif\0\0", TIFF header
+  memcpy(head, "\xFF\xD8\xFF\xE1\0\0Exif\0\0MM\0\x2A\0\0\0\x08", 20);
+  exif_writer_t w = {head + 12, EXIF_HEAD_SIZE - 12, 0, 8, true};
+  bool dated = info->datetime != NULL;
+
+  // IFD0, tags in ascending order
+  uint32_t ifd0Next = exif_ifd(&w, dated ? 6 : 5);
+  exif_ascii(&w, 0x010F, EXIF_MAKE);
+  exif_ascii(&w, 0x0110, EXIF_MODEL);
+  exif_short(&w, 0x0112, 1); // orientation: top left
+  exif_ascii(&w, 0x0131, EXIF_SOFTWARE);
+  if (dated)
+    exif_ascii(&w, 0x0132, info->datetime);
+  uint32_t exifLink = w.entry;
+  exif_long(&w, 0x8769, 0); // Exif IFD, patched below
+
+  // Exif IFD
+  exif_put32(w.tiff + exifLink + 8, w.data);
+  bool exposed = info->exposure_us != 0;
+  bool rated = info->iso != 0;
+  exif_ifd(&w, 4 + dated + exposed + rated);
+  if (exposed)
+    exif_rational(&w, 0x829A, EXIF_RATIONAL, info->exposure_us, 1000000);
+  if (rated)
+    exif_short(&w, 0x8827, info->iso);
+  exif_entry(&w, 0x9000, EXIF_UNDEFINED, 4, "0230", 4);
+  if (dated)
+    exif_ascii(&w, 0x9003, info->datetime);
+  exif_rational(&w, 0x9204, EXIF_SRATIONAL, (uint32_t)(int32_t)info->ev_bias, 1);
+  exif_long(&w, 0xA002, info->width);
+  exif_long(&w, 0xA003, info->height);
+
+  // IFD1 describes the thumbnail
+  if (thumb)
+  {
+    exif_put32(w.tiff + ifd0Next, w.data);
+    exif_ifd(&w, 3);
+    exif_short(&w, 0x0103, 6); // JPEG compression
+    uint32_t thumbLink = w.entry;
+    exif_long(&w, 0x0201, 0);
+    exif_long(&w, 0x0202, thumbLen);
+    exif_put32(w.tiff + thumbLink + 8, w.data);
+  }
+
+  if (!w.ok)
+  {
+    free(head);
+    return NULL;
+  }
+
+  uint32_t tiffLen = w.data;
+  if (thumb)
+    memcpy(w.tiff + tiffLen, thumb, thumbLen);
+  // APP1 length counts itself, "Exif\0\0" and the TIFF structure
+  exif_put16(head + 4, 2 + 6 + tiffLen + thumbLen);
+  *len = 12 + tiffLen + thumbLen;
+  return head;
+}
+
+static uint16_t exif_get16(const uint8_t *p, bool be)
+{
+  return be ? ((p[0] << 8) | p[1]) : ((p[1] << 8) | p[0]);
+}
+
+static uint32_t exif_get32(const uint8_t *p, bool be)
+{
+  return be ? (((uint32_t)exif_get16(p, be) << 16) | exif_get16(p + 2, be)) : (((uint32_t)exif_get16(p + 2, be) << 16) | exif_get16(p, be));
+}
+
+// Works for thumbnails written by other cameras too, either byte order
+bool exif_find_thumbnail(const uint8_t *app1, size_t len, uint32_t *offset, uint32_t *thumbLen)
+{
+  if ((len < 18) || (app1[0] != 0xFF) || (app1[1] != 0xE1) || (memcmp(app1 + 4, "Exif\0\0", 6) != 0))
+    return false;
+
+  const uint8_t *tiff = app1 + 10;
+  uint32_t size = len - 10;
+  bool be = tiff[0] == 'M';
+
+  // skip IFD0 to reach IFD1
+  uint32_t ifd = exif_get32(tiff + 4, be);
+  if (ifd + 2 > size)
+    return false;
+  uint32_t link = ifd + 2 + exif_get16(tiff + ifd, be) * 12;
+  if (link + 4 > size)
+    return false;
+  ifd = exif_get32(tiff + link, be);
+  if ((!ifd) || (ifd + 2 > size))
+    return false;
+
+  uint32_t start = 0, length = 0;
+  uint16_t count = exif_get16(tiff + ifd, be);
+  for (uint16_t k = 0; k < count; k++)
+  {
+    const uint8_t *e = tiff + ifd + 2 + k * 12;
+    if (e + 12 > tiff + size)
+      return false;
+    uint16_t tag = exif_get16(e, be);
+    uint32_t value = (exif_get16(e + 2, be) == EXIF_SHORT) ? exif_get16(e + 8, be) : exif_get32(e + 8, be);
+    if (tag == 0x0201)
+      start = value;
+    else if (tag == 0x0202)
+      length = value;
+  }
+
+  if ((!start) || (!length) || (start + length > size))
+    return false;
+  *offset = 10 + start;
+  *thumbLen = length;
+  return true;
+}
+
+#ifdef ARDUINO
+uint8_t *exif_make_thumbnail(const uint16_t *rgb565, uint16_t width, uint16_t height, bool mirror, size_t *len)
+{
+  uint16_t *thumb = (uint16_t *)ps_malloc(EXIF_THUMB_WIDTH * EXIF_THUMB_HEIGHT * 2);
+  if (!thumb)
+    return NULL;
+
+  // nearest neighbour, the encoder wants the sensor byte order (big endian)
+  uint16_t *dst = thumb;
+  for (int y = 0; y < EXIF_THUMB_HEIGHT; y++)
+  {
+    const uint16_t *row = rgb565 + (y * height / EXIF_THUMB_HEIGHT) * width;
+    for (int x = 0; x < EXIF_THUMB_WIDTH; x++)
+    {
+      int sx = x * width / EXIF_THUMB_WIDTH;
+      uint16_t c = row[mirror ? width - 1 - sx : sx];
+      *dst++ = (c >> 8) | (c << 8);
+    }
+  }
+
+  uint8_t *jpg = NULL;
+  if (!fmt2jpg((uint8_t *)thumb, EXIF_THUMB_WIDTH * EXIF_THUMB_HEIGHT * 2, EXIF_THUMB_WIDTH, EXIF_THUMB_HEIGHT, PIXFORMAT_RGB565, EXIF_THUMB_QUALITY, &jpg, len))
+    jpg = NULL;
+  free(thumb);
+  return jpg;
+}
+#endif
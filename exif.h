@@ -0,0 +1,37 @@
+#ifndef _EXIFH_
+#define _EXIFH_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define EXIF_THUMB_WIDTH 160
+#define EXIF_THUMB_HEIGHT 120
+#define EXIF_THUMB_QUALITY 70 // fmt2jpg quality, 1-100
+#define EXIF_MAKE "Espressif"
+#define EXIF_MODEL "ESP32 Camera Plus"
+#define EXIF_SOFTWARE "arduino-selfie-camera"
+
+typedef struct
+{
+  uint16_t width; // of the main image
+  uint16_t height;
+  const char *datetime; // "YYYY:MM:DD HH:MM:SS" or NULL when the clock is not set
+  uint32_t exposure_us; // 0 when unknown
+  uint16_t iso;         // 0 when unknown
+  int8_t ev_bias;       // stops away from the metered exposure
+} exif_info_t;
+
+// SOI followed by an Exif APP1 segment carrying the capture metadata and a JPEG
+// thumbnail. The result is malloc'ed, it goes in front of the main image in place
+// of its own SOI.
+uint8_t *exif_build(const exif_info_t *info, const uint8_t *thumb, size_t thumbLen, size_t *len);
+
+// Locate the thumbnail inside an APP1 segment (from its marker on), offset from "app1"
+bool exif_find_thumbnail(const uint8_t *app1, size_t len, uint32_t *offset, uint32_t *thumbLen);
+
+#ifdef ARDUINO
+// JPEG encode an RGB565 frame (native byte order) scaled to the thumbnail size
+uint8_t *exif_make_thumbnail(const uint16_t *rgb565, uint16_t width, uint16_t height, bool mirror, size_t *len);
+#endif
+
+#endif
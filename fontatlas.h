@@ -0,0 +1,150 @@
+#ifndef _FONTATLASH_
+#define _FONTATLASH_
+
+#include <stdint.h>
+#include "glcdfont.h"
+#include "Font16.h"
+
+// Compile time builders that turn the GLCD and Font16 tables into atlases for the glyph
+// rasteriser. A glyph row is one 16 bit word, bit n set for column n, so a whole row is
+// read at once instead of a bit at a time. Each glyph also gets its advance and the rows
+// that hold all its set pixels. C++11 constexpr, so every function is one expression.
+
+#define ATLAS_GLCD_GLYPHS 256
+#define ATLAS_GLCD_HEIGHT 8
+#define ATLAS_F16_FIRST 32
+#define ATLAS_F16_GLYPHS 96
+
+typedef struct
+{
+  uint8_t advance;
+  uint8_t top, bottom; // rows top to bottom - 1, top >= bottom for a blank glyph
+} atlas_metrics_t;
+
+template <int N>
+struct atlas_rows
+{
+  uint16_t rows[N];
+};
+
+template <int N>
+struct atlas_metrics
+{
+  atlas_metrics_t glyphs[N];
+};
+
+// 0, 1, ... N - 1 as a parameter pack, built in halves to keep the template depth low
+template <int... I>
+struct atlas_seq
+{
+};
+
+template <class A, class B>
+struct atlas_cat;
+
+template <int... A, int... B>
+struct atlas_cat<atlas_seq<A...>, atlas_seq<B...>>
+{
+  typedef atlas_seq<A..., (int)sizeof...(A) + B...> type;
+};
+
+template <int N>
+struct atlas_make_seq
+{
+  typedef typename atlas_cat<typename atlas_make_seq<N / 2>::type, typename atlas_make_seq<N - N / 2>::type>::type type;
+};
+
+template <>
+struct atlas_make_seq<0>
+{
+  typedef atlas_seq<> type;
+};
+
+template <>
+struct atlas_make_seq<1>
+{
+  typedef atlas_seq<0> type;
+};
+
+/***************************************************************************************
+** GLCD: 5 column bytes a glyph, bit 0 at the top. The table stops short of glyph 255.
+***************************************************************************************/
+constexpr uint8_t atlas_glcd_column(int c, int i)
+{
+  return (c * 5 + i < (int)sizeof(font)) ? font[c * 5 + i] : 0;
+}
+
+constexpr uint16_t atlas_glcd_row(int c, int r)
+{
+  return ((atlas_glcd_column(c, 0) >> r) & 0x1) | (((atlas_glcd_column(c, 1) >> r) & 0x1) << 1) |
+         (((atlas_glcd_column(c, 2) >> r) & 0x1) << 2) | (((atlas_glcd_column(c, 3) >> r) & 0x1) << 3) |
+         (((atlas_glcd_column(c, 4) >> r) & 0x1) << 4);
+}
+
+constexpr uint8_t atlas_glcd_top(int c, int r)
+{
+  return ((r >= ATLAS_GLCD_HEIGHT) || (atlas_glcd_row(c, r))) ? r : atlas_glcd_top(c, r + 1);
+}
+
+constexpr uint8_t atlas_glcd_bottom(int c, int r)
+{
+  return ((r == 0) || (atlas_glcd_row(c, r - 1))) ? r : atlas_glcd_bottom(c, r - 1);
+}
+
+template <int... I>
+constexpr atlas_rows<sizeof...(I)> atlas_glcd_rows(atlas_seq<I...>)
+{
+  return atlas_rows<sizeof...(I)>{{atlas_glcd_row(I / ATLAS_GLCD_HEIGHT, I % ATLAS_GLCD_HEIGHT)...}};
+}
+
+template <int... I>
+constexpr atlas_metrics<sizeof...(I)> atlas_glcd_metrics(atlas_seq<I...>)
+{
+  return atlas_metrics<sizeof...(I)>{{{6, atlas_glcd_top(I, 0), atlas_glcd_bottom(I, ATLAS_GLCD_HEIGHT)}...}};
+}
+
+/***************************************************************************************
+** Font16: rows of (width + 6) / 8 bytes, most significant bit on the left
+***************************************************************************************/
+constexpr uint8_t atlas_reverse(uint8_t b)
+{
+  return ((b & 0x01) << 7) | ((b & 0x02) << 5) | ((b & 0x04) << 3) | ((b & 0x08) << 1) | ((b & 0x10) >> 1) |
+         ((b & 0x20) >> 3) | ((b & 0x40) >> 5) | ((b & 0x80) >> 7);
+}
+
+constexpr int atlas_f16_stride(int g)
+{
+  return (widtbl_f16[g] + 6) / 8;
+}
+
+constexpr uint16_t atlas_f16_row(int g, int r)
+{
+  return ((atlas_f16_stride(g) == 1)
+              ? atlas_reverse(chrtbl_f16[g][r])
+              : atlas_reverse(chrtbl_f16[g][2 * r]) | (atlas_reverse(chrtbl_f16[g][2 * r + 1]) << 8)) &
+         ((1UL << widtbl_f16[g]) - 1);
+}
+
+constexpr uint8_t atlas_f16_top(int g, int r)
+{
+  return ((r >= chr_hgt_f16) || (atlas_f16_row(g, r))) ? r : atlas_f16_top(g, r + 1);
+}
+
+constexpr uint8_t atlas_f16_bottom(int g, int r)
+{
+  return ((r == 0) || (atlas_f16_row(g, r - 1))) ? r : atlas_f16_bottom(g, r - 1);
+}
+
+template <int... I>
+constexpr atlas_rows<sizeof...(I)> atlas_f16_rows(atlas_seq<I...>)
+{
+  return atlas_rows<sizeof...(I)>{{atlas_f16_row(I / chr_hgt_f16, I % chr_hgt_f16)...}};
+}
+
+template <int... I>
+constexpr atlas_metrics<sizeof...(I)> atlas_f16_metrics(atlas_seq<I...>)
+{
+  return atlas_metrics<sizeof...(I)>{{{widtbl_f16[I], atlas_f16_top(I, 0), atlas_f16_bottom(I, chr_hgt_f16)}...}};
+}
+
+#endif
@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include "framesource.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_timer.h>
+
+static int64_t replay_now_us()
+{
+  return esp_timer_get_time();
+}
+
+static void replay_sleep_us(int64_t us)
+{
+  if (us >= 1000)
+    vTaskDelay(us / 1000 / portTICK_PERIOD_MS);
+}
+
+#define replay_malloc(size) ps_malloc(size)
+#else
+#include <time.h>
+#include <unistd.h>
+
+static int64_t replay_now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void replay_sleep_us(int64_t us)
+{
+  if (us > 0)
+    usleep(us);
+}
+
+#define replay_malloc(size) malloc(size)
+#endif
+
+#ifdef ARDUINO
+/***************************************************************************************
+** ESP32 camera driver
+***************************************************************************************/
+camera_fb_t *CameraFrameSource::get()
+{
+  return esp_camera_fb_get();
+}
+
+void CameraFrameSource::release(camera_fb_t *fb)
+{
+  esp_camera_fb_return(fb);
+}
+
+sensor_t *CameraFrameSource::sensor()
+{
+  return esp_camera_sensor_get();
+}
+
+// Replayed frames have fixed settings, accept and ignore all sensor changes
+static int replay_set(sensor_t *sensor, int value)
+{
+  return 0;
+}
+
+// and read no registers
+static int replay_get_reg(sensor_t *sensor, int reg, int mask)
+{
+  return -1;
+}
+
+static int replay_set_reg(sensor_t *sensor, int reg, int mask, int value)
+{
+  return 0;
+}
+
+static sensor_t replay_sensor;
+#endif
+
+/***************************************************************************************
+** Recorded JPEG replay
+***************************************************************************************/
+static int replay_cmp(const void *a, const void *b)
+{
+  return strcmp(*(const char **)a, *(const char **)b);
+}
+
+static bool replay_is_jpeg(const char *name)
+{
+  size_t len = strlen(name);
+  return (len > 4) && (name[0] != '.') && ((strcasecmp(name + len - 4, ".JPG") == 0) || (strcasecmp(name + len - 5, ".JPEG") == 0));
+}
+
+ReplayFrameSource::ReplayFrameSource(const char *dir, uint16_t fps, uint8_t fb_count, bool loop)
+{
+  strncpy(_dir, dir, sizeof(_dir) - 1);
+  _dir[sizeof(_dir) - 1] = 0;
+  _files = NULL;
+  _fileCount = 0;
+  _period_us = 1000000 / (fps ? fps : 1);
+  _fbCount = (fb_count < 1) ? 1 : ((fb_count > REPLAY_MAX_FB) ? REPLAY_MAX_FB : fb_count);
+  _loop = loop;
+  memset(_fb, 0, sizeof(_fb));
+  memset(_capacity, 0, sizeof(_capacity));
+  memset(_inUse, 0, sizeof(_inUse));
+  _start_us = 0;
+  _lastFrame = -1;
+  _delivered = _dropped = _starved = 0;
+}
+
+ReplayFrameSource::~ReplayFrameSource()
+{
+  for (uint32_t k = 0; k < _fileCount; k++)
+    free(_files[k]);
+  free(_files);
+  for (int k = 0; k < REPLAY_MAX_FB; k++)
+    free(_fb[k].buf);
+}
+
+// List the directory once, frames are loaded on demand
+bool ReplayFrameSource::begin()
+{
+  DIR *dir = opendir(_dir);
+  if (!dir)
+    return false;
+
+  uint32_t size = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if (!replay_is_jpeg(entry->d_name))
+      continue;
+    if (_fileCount == size)
+    {
+      size = size ? size * 2 : 64;
+      char **files = (char **)realloc(_files, size * sizeof(char *));
+      if (!files)
+        break;
+      _files = files;
+    }
+    _files[_fileCount++] = strdup(entry->d_name);
+  }
+  closedir(dir);
+
+  if (!_fileCount)
+    return false;
+
+  qsort(_files, _fileCount, sizeof(char *), replay_cmp);
+  _start_us = replay_now_us();
+  _lastFrame = -1;
+  return true;
+}
+
+// Frame size from the SOF marker, as the driver fills it in for sensor frames
+static void replay_jpeg_size(camera_fb_t *fb)
+{
+  const uint8_t *p = fb->buf + 2, *end = fb->buf + fb->len;
+  fb->width = 0;
+  fb->height = 0;
+  while (p + 9 <= end)
+  {
+    if (p[0] != 0xFF)
+      return;
+    uint8_t marker = p[1];
+    if (marker == 0xFF)
+    {
+      p++; // fill byte
+      continue;
+    }
+    if ((marker == 0xD9) || (marker == 0xDA))
+      return;
+    if ((marker >= 0xC0) && (marker <= 0xCF) && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC))
+    {
+      fb->height = (p[5] << 8) | p[6];
+      fb->width = (p[7] << 8) | p[8];
+      return;
+    }
+    p += 2 + ((p[2] << 8) | p[3]);
+  }
+}
+
+bool ReplayFrameSource::load(uint32_t fileIdx, camera_fb_t *fb, size_t *capacity)
+{
+  char path[REPLAY_PATH_SIZE + 32];
+  snprintf(path, sizeof(path), "%s/%s", _dir, _files[fileIdx]);
+
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return false;
+
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  if ((len > 0) && ((size_t)len > *capacity))
+  {
+    free(fb->buf);
+    fb->buf = (uint8_t *)replay_malloc(len);
+    *capacity = fb->buf ? len : 0;
+  }
+
+  fb->len = ((len > 0) && (fb->buf)) ? fread(fb->buf, 1, len, f) : 0;
+  fclose(f);
+  replay_jpeg_size(fb);
+  return fb->len > 0;
+}
+
+camera_fb_t *ReplayFrameSource::get()
+{
+  if (!_fileCount)
+    return NULL;
+
+  int slot = -1;
+  for (int k = 0; k < _fbCount; k++)
+  {
+    if (!_inUse[k])
+    {
+      slot = k;
+      break;
+    }
+  }
+  if (slot < 0)
+  {
+    // every buffer is held by the consumer, the driver would time out the same way
+    _starved++;
+    return NULL;
+  }
+
+  // frame n completes at _start_us + (n + 1) * period
+  int64_t now = replay_now_us();
+  int64_t completed = (now - _start_us) / _period_us - 1;
+  int64_t next = _lastFrame + 1;
+
+  if (completed < next)
+  {
+    replay_sleep_us(_start_us + (next + 1) * _period_us - now);
+  }
+  else
+  {
+    // buffers were all in use or not collected, the sensor frames in between are lost
+    _dropped += completed - next;
+    next = completed;
+  }
+
+  if ((!_loop) && ((uint64_t)next >= _fileCount))
+    return NULL;
+
+  camera_fb_t *fb = &_fb[slot];
+  if (!load(next % _fileCount, fb, &_capacity[slot]))
+    return NULL;
+
+#ifdef ARDUINO
+  int64_t completedAt = _start_us + (next + 1) * _period_us;
+  fb->timestamp.tv_sec = completedAt / 1000000;
+  fb->timestamp.tv_usec = completedAt % 1000000;
+#endif
+  _lastFrame = next;
+  _inUse[slot] = true;
+  _delivered++;
+  return fb;
+}
+
+void ReplayFrameSource::release(camera_fb_t *fb)
+{
+  for (int k = 0; k < _fbCount; k++)
+  {
+    if (fb == &_fb[k])
+      _inUse[k] = false;
+  }
+}
+
+sensor_t *ReplayFrameSource::sensor()
+{
+#ifdef ARDUINO
+  replay_sensor.set_brightness = replay_set;
+  replay_sensor.set_contrast = replay_set;
+  replay_sensor.set_saturation = replay_set;
+  replay_sensor.set_sharpness = replay_set;
+  replay_sensor.set_aec2 = replay_set;
+  replay_sensor.set_denoise = replay_set;
+  replay_sensor.set_lenc = replay_set;
+  replay_sensor.set_hmirror = replay_set;
+  replay_sensor.set_vflip = replay_set;
+  replay_sensor.set_quality = replay_set;
+  replay_sensor.set_exposure_ctrl = replay_set;
+  replay_sensor.set_aec_value = replay_set;
+  replay_sensor.set_gain_ctrl = replay_set;
+  replay_sensor.set_agc_gain = replay_set;
+  replay_sensor.set_ae_level = replay_set;
+  replay_sensor.get_reg = replay_get_reg;
+  replay_sensor.set_reg = replay_set_reg;
+  return &replay_sensor;
+#else
+  return NULL;
+#endif
+}
@@ -0,0 +1,86 @@
+#ifndef _FRAMESOURCEH_
+#define _FRAMESOURCEH_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <esp_camera.h>
+#else
+// Host builds only need the part of the driver frame buffer the sketch uses
+typedef struct
+{
+  uint8_t *buf;  // Pointer to the JPEG data
+  size_t len;    // Length of the buffer in bytes
+  size_t width;  // Width of the buffer in pixels
+  size_t height; // Height of the buffer in pixels
+} camera_fb_t;
+typedef struct _sensor sensor_t;
+#endif
+
+#define REPLAY_MAX_FB 4
+#define REPLAY_PATH_SIZE 64
+
+// Something that hands out camera frame buffers. Every buffer returned by get() must be
+// given back with release() before the source can reuse it.
+class FrameSource
+{
+public:
+  virtual ~FrameSource() {}
+  virtual camera_fb_t *get() = 0;
+  virtual void release(camera_fb_t *fb) = 0;
+  virtual sensor_t *sensor() { return NULL; }
+  virtual uint32_t period() { return 0; } // sensor frame period in us, 0 when not known
+};
+
+#ifdef ARDUINO
+// The ESP32 camera driver
+class CameraFrameSource : public FrameSource
+{
+public:
+  camera_fb_t *get();
+  void release(camera_fb_t *fb);
+  sensor_t *sensor();
+};
+#endif
+
+// Serve recorded JPEG files of a directory, in name order, as if a sensor was running
+// at "fps". Like the driver, only "fb_count" buffers can be held at once and frames
+// completed while the consumer is busy are dropped.
+class ReplayFrameSource : public FrameSource
+{
+public:
+  ReplayFrameSource(const char *dir, uint16_t fps = 12, uint8_t fb_count = 2, bool loop = true);
+  ~ReplayFrameSource();
+
+  bool begin();
+  camera_fb_t *get();
+  void release(camera_fb_t *fb);
+  sensor_t *sensor();
+  uint32_t period() { return _period_us; }
+
+  uint32_t fileCount() { return _fileCount; }
+  uint32_t delivered() { return _delivered; }
+  uint32_t dropped() { return _dropped; }
+  uint32_t starved() { return _starved; }
+
+private:
+  bool load(uint32_t fileIdx, camera_fb_t *fb, size_t *capacity);
+
+  char _dir[REPLAY_PATH_SIZE];
+  char **_files;
+  uint32_t _fileCount;
+  uint32_t _period_us;
+  uint8_t _fbCount;
+  bool _loop;
+
+  camera_fb_t _fb[REPLAY_MAX_FB];
+  size_t _capacity[REPLAY_MAX_FB];
+  bool _inUse[REPLAY_MAX_FB];
+
+  int64_t _start_us;
+  int64_t _lastFrame; // sensor frame number of the last delivered frame
+  uint32_t _delivered, _dropped, _starved;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "glyph.h"
+#include "fontatlas.h"
+
+// Built by the compiler from glcdfont.h and Font16.h
+static constexpr atlas_rows<ATLAS_GLCD_GLYPHS * ATLAS_GLCD_HEIGHT> glcdRows =
+    atlas_glcd_rows(atlas_make_seq<ATLAS_GLCD_GLYPHS * ATLAS_GLCD_HEIGHT>::type());
+static constexpr atlas_metrics<ATLAS_GLCD_GLYPHS> glcdMetrics = atlas_glcd_metrics(atlas_make_seq<ATLAS_GLCD_GLYPHS>::type());
+static constexpr atlas_rows<ATLAS_F16_GLYPHS * chr_hgt_f16> f16Rows = atlas_f16_rows(atlas_make_seq<ATLAS_F16_GLYPHS * chr_hgt_f16>::type());
+static constexpr atlas_metrics<ATLAS_F16_GLYPHS> f16Metrics = atlas_f16_metrics(atlas_make_seq<ATLAS_F16_GLYPHS>::type());
+
+void glyph_glcd(glyph_t *g, unsigned char c)
+{
+  const atlas_metrics_t *m = &glcdMetrics.glyphs[c];
+  g->rows = &glcdRows.rows[c * ATLAS_GLCD_HEIGHT];
+  g->width = m->advance;
+  g->height = ATLAS_GLCD_HEIGHT;
+  g->top = m->top;
+  g->bottom = m->bottom;
+}
+
+bool glyph_font16(glyph_t *g, unsigned char c)
+{
+  if ((c < ATLAS_F16_FIRST) || (c >= ATLAS_F16_FIRST + ATLAS_F16_GLYPHS))
+    return false;
+  c -= ATLAS_F16_FIRST;
+  const atlas_metrics_t *m = &f16Metrics.glyphs[c];
+  g->rows = &f16Rows.rows[c * chr_hgt_f16];
+  g->width = m->advance;
+  g->height = chr_hgt_f16;
+  g->top = m->top;
+  g->bottom = m->bottom;
+  return true;
+}
+
+void glyph_blank(glyph_t *g, uint8_t width, uint8_t height)
+{
+  g->rows = NULL;
+  g->width = width;
+  g->height = height;
+  g->top = height;
+  g->bottom = 0;
+}
+
+/***************************************************************************************
+** Function name:           glyph_line
+** Description:             expand a glyph row of a string into a line of pixels
+***************************************************************************************/
+void glyph_line(const glyph_t *glyphs, uint8_t count, int32_t x, uint8_t size, int32_t row,
+                uint16_t fg, uint16_t bg, int32_t xs, int32_t xe, uint16_t *line)
+{
+  for (uint8_t k = 0; (k < count) && (x <= xe); k++)
+  {
+    const glyph_t *g = &glyphs[k];
+    int32_t gw = g->width * size;
+    if (x + gw <= xs)
+    {
+      x += gw;
+      continue;
+    }
+
+    uint32_t mask = glyph_mask(g, row);
+    if ((x >= xs) && (x + gw - 1 <= xe))
+    {
+      // all of the glyph is in the line
+      uint16_t *p = line + (x - xs);
+      for (int32_t col = 0; col < g->width; col++, mask >>= 1)
+      {
+        uint16_t color = (mask & 0x1) ? fg : bg;
+        for (uint8_t n = 0; n < size; n++)
+          *p++ = color;
+      }
+    }
+    else
+    {
+      for (int32_t col = 0; col < g->width; col++, mask >>= 1)
+      {
+        uint16_t color = (mask & 0x1) ? fg : bg;
+        int32_t ps = x + col * size, pe = ps + size - 1;
+        if (ps < xs)
+          ps = xs;
+        if (pe > xe)
+          pe = xe;
+        for (int32_t p = ps; p <= pe; p++)
+          line[p - xs] = color;
+      }
+    }
+    x += gw;
+  }
+}
+
+/***************************************************************************************
+** Function name:           glyph_rects
+** Description:             the set pixels of a glyph as few rectangles
+***************************************************************************************/
+void glyph_rects(const glyph_t *g, int32_t x, int32_t y, uint8_t size, raster_rect_t rect, void *ctx)
+{
+  int32_t row = g->top;
+  while (row < g->bottom)
+  {
+    uint32_t mask = glyph_mask(g, row);
+    int32_t rows = 1;
+    while ((row + rows < g->bottom) && (glyph_mask(g, row + rows) == mask))
+      rows++;
+
+    int32_t col = 0;
+    while (mask)
+    {
+      if (!(mask & 0x1))
+      {
+        mask >>= 1;
+        col++;
+        continue;
+      }
+      int32_t run = 0;
+      while (mask & 0x1)
+      {
+        mask >>= 1;
+        run++;
+      }
+      rect(ctx, x + col * size, y + row * size, run * size, rows * size);
+      col += run;
+    }
+    row += rows;
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef _GLYPHH_
+#define _GLYPHH_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "raster.h"
+
+#define GLYPH_LINE_PIXELS 320 // widest screen, one line of a string cell
+#define GLYPH_MAX_STRING 64   // glyphs pushed in one window, longer strings take more
+
+// A 1 bit per pixel glyph in one of the font atlases, at most 16 pixels wide
+typedef struct
+{
+  const uint16_t *rows;  // bit n set for column n, NULL for a blank glyph
+  uint8_t width, height; // cell, with the spacing column
+  uint8_t top, bottom;   // the set pixels are in rows top to bottom - 1
+} glyph_t;
+
+void glyph_glcd(glyph_t *g, unsigned char c);
+bool glyph_font16(glyph_t *g, unsigned char c); // false outside 32 to 127
+void glyph_blank(glyph_t *g, uint8_t width, uint8_t height);
+
+// Bit n set where column n of the row is foreground
+static inline uint32_t glyph_mask(const glyph_t *g, int32_t row)
+{
+  return ((row >= g->top) && (row < g->bottom)) ? g->rows[row] : 0;
+}
+
+// Pixels xs to xe of one glyph row of a string starting at x, every glyph pixel "size"
+// pixels wide. The colours go into the line as they are, swap them for the bus first.
+void glyph_line(const glyph_t *glyphs, uint8_t count, int32_t x, uint8_t size, int32_t row,
+                uint16_t fg, uint16_t bg, int32_t xs, int32_t xe, uint16_t *line);
+
+// The foreground as rectangles, for transparent text: one per run of set pixels, taking in
+// the rows below that are the same
+void glyph_rects(const glyph_t *g, int32_t x, int32_t y, uint8_t size, raster_rect_t rect, void *ctx);
+
+#endif
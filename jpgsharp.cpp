@@ -0,0 +1,383 @@
+#include <string.h>
+#include "jpgsharp.h"
+
+#define JS_LOOKUP_BITS 9
+
+// Luminance table of ITU T.81 Annex K in zigzag order, times JPGSHARP_REF_SCALE it gives
+// the reference quantizer steps
+static const uint8_t js_ref_luma[64] = {
+    16, 11, 12, 14, 12, 10, 16, 14, 13, 14, 18, 17, 16, 19, 24, 40, 26, 24, 22, 22, 24, 49,
+    35, 37, 29, 40, 58, 51, 61, 60, 57, 51, 56, 55, 64, 72, 92, 78, 64, 68, 87, 69, 55, 56,
+    80, 109, 81, 87, 95, 98, 103, 104, 103, 62, 77, 113, 121, 112, 100, 120, 92, 101, 103, 99};
+
+typedef struct
+{
+  uint16_t lookup[1 << JS_LOOKUP_BITS]; // (code length << 8) | symbol, 0 for longer codes
+  int32_t maxcode[18];
+  int32_t mincode[17];
+  uint8_t valptr[17];
+  uint8_t vals[256];
+} js_huff_t;
+
+typedef struct
+{
+  uint8_t id;
+  uint8_t h, v; // sampling factors
+  uint8_t tq;   // quantization table
+  uint8_t td, ta; // DC and AC Huffman tables
+} js_comp_t;
+
+typedef struct
+{
+  const uint8_t *p;
+  const uint8_t *end;
+  uint32_t buf; // MSB aligned bit buffer
+  int bits;
+  bool marker; // hit a marker, feed zeros from now on
+} js_bits_t;
+
+typedef struct
+{
+  js_huff_t dc[4];
+  js_huff_t ac[4];
+  uint16_t qt[4][64]; // quantization tables, zigzag order
+  js_comp_t comp[4];
+  uint8_t ncomp;
+  uint16_t width, height;
+  uint16_t restart;
+} js_dec_t;
+
+static bool js_build_huff(js_huff_t *h, const uint8_t *counts, const uint8_t *vals, int nvals)
+{
+  memset(h->lookup, 0, sizeof(h->lookup));
+  memcpy(h->vals, vals, nvals);
+
+  int32_t code = 0;
+  int k = 0;
+  for (int l = 1; l <= 16; l++)
+  {
+    h->valptr[l] = k;
+    h->mincode[l] = code;
+    for (int n = 0; n < counts[l - 1]; n++, k++, code++)
+    {
+      if (code >= (1 << l))
+        return false; // more codes than fit in l bits, a corrupt table
+      if (l <= JS_LOOKUP_BITS)
+      {
+        // every lookup index starting with this code maps to it
+        int shift = JS_LOOKUP_BITS - l;
+        for (int fill = 0; fill < (1 << shift); fill++)
+          h->lookup[(code << shift) | fill] = (l << 8) | vals[k];
+      }
+    }
+    h->maxcode[l] = counts[l - 1] ? code - 1 : -1;
+    code <<= 1;
+  }
+  h->maxcode[17] = 0x7FFFFFFF;
+  return true;
+}
+
+static void js_fill(js_bits_t *b)
+{
+  while (b->bits <= 24)
+  {
+    uint32_t c = 0;
+    if ((!b->marker) && (b->p < b->end))
+    {
+      c = *b->p++;
+      if (c == 0xFF)
+      {
+        if ((b->p < b->end) && (*b->p == 0x00))
+          b->p++; // stuffed byte
+        else
+        {
+          b->p--; // leave the marker for the caller
+          b->marker = true;
+          c = 0;
+        }
+      }
+    }
+    b->buf |= c << (24 - b->bits);
+    b->bits += 8;
+  }
+}
+
+static inline void js_skip(js_bits_t *b, int n)
+{
+  b->buf <<= n;
+  b->bits -= n;
+}
+
+static int js_decode(js_bits_t *b, const js_huff_t *h)
+{
+  js_fill(b);
+  uint16_t entry = h->lookup[b->buf >> (32 - JS_LOOKUP_BITS)];
+  if (entry)
+  {
+    js_skip(b, entry >> 8);
+    return entry & 0xFF;
+  }
+  for (int l = JS_LOOKUP_BITS + 1; l <= 16; l++)
+  {
+    int32_t code = b->buf >> (32 - l);
+    if (code <= h->maxcode[l])
+    {
+      js_skip(b, l);
+      return h->vals[h->valptr[l] + code - h->mincode[l]];
+    }
+  }
+  return -1;
+}
+
+// Read an "s" bit coefficient and return its magnitude
+static inline uint32_t js_magnitude(js_bits_t *b, int s)
+{
+  js_fill(b);
+  uint32_t v = b->buf >> (32 - s);
+  js_skip(b, s);
+  return (v < (1u << (s - 1))) ? ((1u << s) - 1 - v) : v;
+}
+
+static bool js_block(js_dec_t *d, js_bits_t *b, const js_comp_t *c, bool luma, uint64_t *energy)
+{
+  int s = js_decode(b, &d->dc[c->td]);
+  if ((s < 0) || (s > 11))
+    return false;
+  if (s)
+  {
+    js_fill(b);
+    js_skip(b, s);
+  }
+
+  const js_huff_t *ac = &d->ac[c->ta];
+  const uint16_t *qt = d->qt[c->tq];
+  for (int k = 1; k < 64; k++)
+  {
+    int rs = js_decode(b, ac);
+    if (rs < 0)
+      return false;
+    s = rs & 0x0F;
+    if (!s)
+    {
+      if (rs != 0xF0)
+        break; // EOB
+      k += 15;
+      continue;
+    }
+    k += rs >> 4;
+    if (k > 63)
+      return false;
+    if (luma)
+    {
+      // dequantized, then only what is above the reference step counts, so detail a
+      // coarser quantizer would have dropped counts in no shot
+      uint32_t ref = js_ref_luma[k] * JPGSHARP_REF_SCALE;
+      uint32_t v = js_magnitude(b, s) * qt[k];
+      if (v > ref)
+        *energy += v - ref;
+    }
+    else
+    {
+      js_fill(b);
+      js_skip(b, s);
+    }
+  }
+  return true;
+}
+
+// Skip the remaining bits and the RSTn marker at the end of a restart interval
+static bool js_restart(js_bits_t *b)
+{
+  b->buf = 0;
+  b->bits = 0;
+  b->marker = false;
+  while ((b->p + 1 < b->end) && (!((b->p[0] == 0xFF) && (b->p[1] >= 0xD0) && (b->p[1] <= 0xD7))))
+    b->p++;
+  if (b->p + 1 >= b->end)
+    return false;
+  b->p += 2;
+  return true;
+}
+
+static bool js_scan(js_dec_t *d, const uint8_t *p, const uint8_t *end, const uint8_t *sos, jpgsharp_t *result)
+{
+  js_comp_t *scomp[4];
+  uint8_t ns = sos[0];
+  if ((ns < 1) || (ns > 4))
+    return false;
+
+  for (int n = 0; n < ns; n++)
+  {
+    scomp[n] = NULL;
+    for (int k = 0; k < d->ncomp; k++)
+    {
+      if (d->comp[k].id == sos[1 + n * 2])
+      {
+        scomp[n] = &d->comp[k];
+        scomp[n]->td = (sos[2 + n * 2] >> 4) & 3;
+        scomp[n]->ta = sos[2 + n * 2] & 3;
+      }
+    }
+    if (!scomp[n])
+      return false;
+  }
+
+  uint8_t hmax = 1, vmax = 1;
+  for (int k = 0; k < d->ncomp; k++)
+  {
+    if (d->comp[k].h > hmax)
+      hmax = d->comp[k].h;
+    if (d->comp[k].v > vmax)
+      vmax = d->comp[k].v;
+  }
+
+  uint32_t mcux, mcuy;
+  if (ns == 1)
+  {
+    // non interleaved scan, one block per MCU
+    mcux = ((d->width * scomp[0]->h + hmax - 1) / hmax + 7) / 8;
+    mcuy = ((d->height * scomp[0]->v + vmax - 1) / vmax + 7) / 8;
+  }
+  else
+  {
+    mcux = (d->width + 8 * hmax - 1) / (8 * hmax);
+    mcuy = (d->height + 8 * vmax - 1) / (8 * vmax);
+  }
+
+  js_bits_t b = {p, end, 0, 0, false};
+  uint32_t mcus = mcux * mcuy;
+  uint64_t energy = 0;
+  uint32_t blocks = 0;
+
+  for (uint32_t m = 0; m < mcus; m++)
+  {
+    if ((d->restart) && (m) && ((m % d->restart) == 0))
+    {
+      if (!js_restart(&b))
+        break;
+    }
+    for (int n = 0; n < ns; n++)
+    {
+      bool luma = (scomp[n] == &d->comp[0]);
+      int count = (ns == 1) ? 1 : scomp[n]->h * scomp[n]->v;
+      for (int k = 0; k < count; k++)
+      {
+        if (!js_block(d, &b, scomp[n], luma, &energy))
+          return false;
+        if (luma)
+          blocks++;
+      }
+    }
+  }
+
+  result->blocks += blocks;
+  result->ac_energy += energy;
+  return true;
+}
+
+bool jpgsharp_score(const uint8_t *buf, size_t len, jpgsharp_t *result)
+{
+  static js_dec_t d; // ~5KB of tables, keep it off the task stack
+  const uint8_t *p = buf;
+  const uint8_t *end = buf + len;
+  bool frame = false;
+
+  memset(result, 0, sizeof(jpgsharp_t));
+  d.ncomp = 0;
+  d.restart = 0;
+
+  if ((len < 4) || (p[0] != 0xFF) || (p[1] != 0xD8))
+    return false;
+  p += 2;
+
+  while (p + 4 <= end)
+  {
+    if (p[0] != 0xFF)
+      return false;
+    uint8_t marker = p[1];
+    if (marker == 0xFF)
+    {
+      p++; // fill byte
+      continue;
+    }
+    if (marker == 0xD9)
+      break;
+
+    uint16_t seglen = (p[2] << 8) | p[3];
+    const uint8_t *seg = p + 4;
+    const uint8_t *segend = p + 2 + seglen;
+    if ((seglen < 2) || (segend > end))
+      return false;
+
+    switch (marker)
+    {
+    case 0xC0: // baseline
+    case 0xC1: // extended sequential, Huffman
+      if (seglen < 8)
+        return false;
+      d.height = (seg[1] << 8) | seg[2];
+      d.width = (seg[3] << 8) | seg[4];
+      d.ncomp = seg[5];
+      if ((d.ncomp < 1) || (d.ncomp > 4) || (seglen < 8 + 3 * d.ncomp))
+        return false;
+      for (int k = 0; k < d.ncomp; k++)
+      {
+        d.comp[k].id = seg[6 + k * 3];
+        d.comp[k].h = seg[7 + k * 3] >> 4;
+        d.comp[k].v = seg[7 + k * 3] & 0x0F;
+        d.comp[k].tq = seg[8 + k * 3] & 3;
+      }
+      frame = true;
+      break;
+    case 0xC2: // progressive and arithmetic coded images are not supported
+    case 0xC3:
+    case 0xC9:
+    case 0xCA:
+    case 0xCB:
+      return false;
+    case 0xC4: // DHT
+      while (seg + 17 <= segend)
+      {
+        uint8_t tc = seg[0] >> 4, th = seg[0] & 3;
+        int nvals = 0;
+        for (int k = 0; k < 16; k++)
+          nvals += seg[1 + k];
+        if ((nvals > 256) || (seg + 17 + nvals > segend))
+          return false;
+        if (!js_build_huff(tc ? &d.ac[th] : &d.dc[th], seg + 1, seg + 17, nvals))
+          return false;
+        seg += 17 + nvals;
+      }
+      break;
+    case 0xDB: // DQT
+      while (seg < segend)
+      {
+        uint8_t pq = seg[0] >> 4, tq = seg[0] & 0x0F;
+        if ((tq > 3) || (seg + 1 + 64 * (pq ? 2 : 1) > segend))
+          return false;
+        seg++;
+        for (int k = 0; k < 64; k++)
+        {
+          d.qt[tq][k] = pq ? ((seg[0] << 8) | seg[1]) : seg[0];
+          seg += pq ? 2 : 1;
+        }
+      }
+      break;
+    case 0xDD: // DRI
+      if (seglen < 4)
+        return false;
+      d.restart = (seg[0] << 8) | seg[1];
+      break;
+    case 0xDA: // SOS, entropy coded data follows the header
+      if (!frame)
+        return false;
+      if (!js_scan(&d, segend, end, seg, result))
+        return false;
+      result->score = result->blocks ? (float)result->ac_energy / result->blocks : 0;
+      return result->blocks > 0;
+    }
+    p = segend;
+  }
+
+  return false;
+}
@@ -0,0 +1,24 @@
+#ifndef _JPGSHARPH_
+#define _JPGSHARPH_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Sharpness of a baseline JPEG from its entropy coded data only: the Huffman codes are
+// walked to recover the luma AC coefficients, but nothing is dequantized into pixels (no
+// IDCT, no colour conversion). Each coefficient is scaled by its quantizer and only the
+// part above a fixed reference step counts. The reference is coarser than any shot, so
+// small coefficients that only fine qualities keep add nothing, and the score of one
+// scene moves by under 2% between IJG qualities 20 and 95 (bench/jpgsharp_bench).
+#define JPGSHARP_REF_SCALE 3 // reference steps in Annex K luma tables, about IJG quality 17
+
+typedef struct
+{
+  uint32_t blocks;    // luma blocks scored
+  uint64_t ac_energy; // sum of |AC coefficient| * quantizer - reference step, where positive
+  float score;        // ac_energy / blocks, higher is sharper
+} jpgsharp_t;
+
+bool jpgsharp_score(const uint8_t *buf, size_t len, jpgsharp_t *result);
+
+#endif
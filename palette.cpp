@@ -0,0 +1,146 @@
+#include <string.h>
+#include "palette.h"
+
+static inline uint16_t palette_swap(uint16_t color)
+{
+  return (color >> 8) | (color << 8);
+}
+
+void palette_set(palette_t *p, const uint16_t *colors, uint16_t count, uint8_t bpp)
+{
+  p->bpp = (bpp == 4) ? 4 : 8;
+  uint16_t size = 1 << p->bpp;
+  memset(p->lut, 0, sizeof(p->lut));
+  for (uint16_t k = 0; (k < count) && (k < size); k++)
+    p->lut[k] = palette_swap(colors[k]);
+}
+
+void palette_rgb332(palette_t *p)
+{
+  static const uint8_t blue[] = {0, 11, 21, 31}; // blue 2 to 5 bit colour lookup table
+  p->bpp = 8;
+  for (uint16_t color = 0; color < 256; color++)
+  {
+    //                 =====Green=====     ===============Red==============
+    uint16_t color16 = (color & 0x1C) << 6 | (color & 0xC0) << 5 | (color & 0xE0) << 8;
+    //         =====Green=====    =======Blue======
+    color16 |= (color & 0x1C) << 3 | blue[color & 0x03];
+    p->lut[color] = palette_swap(color16);
+  }
+}
+
+const palette_t *palette_332(void)
+{
+  static palette_t rgb332 = {{0}, 0};
+  if (!rgb332.bpp)
+    palette_rgb332(&rgb332);
+  return &rgb332;
+}
+
+// Two 4 bit pixels as one word of the line, little endian like the ESP32
+static inline uint32_t palette_pair(const uint16_t *lut, uint8_t b)
+{
+  return lut[b >> 4] | ((uint32_t)lut[b & 0xF] << 16);
+}
+
+/***************************************************************************************
+** Function name:           palette_line
+** Description:             expand part of an indexed row through the lookup table
+***************************************************************************************/
+// Once the source is on a word boundary it is read 4 bytes at a time, and the line is
+// written 2 pixels at a time when it is on a word boundary too
+void palette_line(const palette_t *p, const uint8_t *row, uint32_t x, uint32_t n, uint16_t *line)
+{
+  const uint16_t *lut = p->lut;
+
+  if (p->bpp == 8)
+  {
+    const uint8_t *src = row + x;
+    while ((n) && ((uintptr_t)src & 0x3))
+    {
+      *line++ = lut[*src++];
+      n--;
+    }
+
+    const uint32_t *word = (const uint32_t *)src;
+    if (!((uintptr_t)line & 0x3))
+    {
+      uint32_t *dst = (uint32_t *)line;
+      for (; n >= 4; n -= 4)
+      {
+        uint32_t v = *word++;
+        *dst++ = lut[v & 0xFF] | ((uint32_t)lut[(v >> 8) & 0xFF] << 16);
+        *dst++ = lut[(v >> 16) & 0xFF] | ((uint32_t)lut[v >> 24] << 16);
+      }
+      line = (uint16_t *)dst;
+    }
+    else
+    {
+      for (; n >= 4; n -= 4)
+      {
+        uint32_t v = *word++;
+        line[0] = lut[v & 0xFF];
+        line[1] = lut[(v >> 8) & 0xFF];
+        line[2] = lut[(v >> 16) & 0xFF];
+        line[3] = lut[v >> 24];
+        line += 4;
+      }
+    }
+
+    src = (const uint8_t *)word;
+    while (n--)
+      *line++ = lut[*src++];
+    return;
+  }
+
+  const uint8_t *src = row + (x >> 1);
+  if ((n) && (x & 0x1))
+  {
+    *line++ = lut[*src++ & 0xF];
+    n--;
+  }
+  while ((n >= 2) && ((uintptr_t)src & 0x3))
+  {
+    line[0] = lut[*src >> 4];
+    line[1] = lut[*src++ & 0xF];
+    line += 2;
+    n -= 2;
+  }
+
+  const uint32_t *word = (const uint32_t *)src;
+  if (!((uintptr_t)line & 0x3))
+  {
+    uint32_t *dst = (uint32_t *)line;
+    for (; n >= 8; n -= 8)
+    {
+      uint32_t v = *word++;
+      *dst++ = palette_pair(lut, v);
+      *dst++ = palette_pair(lut, v >> 8);
+      *dst++ = palette_pair(lut, v >> 16);
+      *dst++ = palette_pair(lut, v >> 24);
+    }
+    line = (uint16_t *)dst;
+  }
+  else
+  {
+    for (; n >= 8; n -= 8)
+    {
+      uint32_t v = *word++;
+      for (uint8_t k = 0; k < 4; k++, v >>= 8)
+      {
+        *line++ = lut[(v >> 4) & 0xF];
+        *line++ = lut[v & 0xF];
+      }
+    }
+  }
+
+  src = (const uint8_t *)word;
+  for (; n >= 2; n -= 2)
+  {
+    line[0] = lut[*src >> 4];
+    line[1] = lut[*src++ & 0xF];
+    line += 2;
+  }
+  if (n)
+    *line = lut[*src >> 4];
+}
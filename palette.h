@@ -0,0 +1,31 @@
+#ifndef _PALETTEH_
+#define _PALETTEH_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PALETTE_LINE_PIXELS 320 // widest screen
+
+// Colour lookup for 8 and 4 bit indexed images. The 565 colours are held in bus byte order
+// so expanded rows go to the panel as they are. 4 bit rows have the left pixel in the high
+// nibble and start on a byte.
+typedef struct
+{
+  uint16_t lut[256];
+  uint8_t bpp; // 8 or 4
+} palette_t;
+
+void palette_set(palette_t *p, const uint16_t *colors, uint16_t count, uint8_t bpp); // 565 colours
+void palette_rgb332(palette_t *p); // RRRGGGBB as color8to16()
+const palette_t *palette_332(void); // built on first use, for 8 bit sprites
+
+// Bytes in a row "w" pixels wide
+static inline uint32_t palette_stride(const palette_t *p, uint32_t w)
+{
+  return (p->bpp == 4) ? (w + 1) >> 1 : w;
+}
+
+// Pixels x to x + n - 1 of an image row into a line of bus order colours
+void palette_line(const palette_t *p, const uint8_t *row, uint32_t x, uint32_t n, uint16_t *line);
+
+#endif
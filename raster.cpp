@@ -0,0 +1,269 @@
+#include "raster.h"
+
+static inline void raster_swap(int32_t &a, int32_t &b)
+{
+  int32_t t = a;
+  a = b;
+  b = t;
+}
+
+/***************************************************************************************
+** Function name:           raster_spans_begin
+** Description:             empty spans for rows top to top + rows - 1
+***************************************************************************************/
+void raster_spans_begin(raster_spans_t *s, int32_t top, int32_t rows)
+{
+  s->top = top;
+  s->rows = (rows < 0) ? 0 : (rows > RASTER_MAX_ROWS) ? RASTER_MAX_ROWS : rows;
+  for (int32_t k = 0; k < s->rows; k++)
+  {
+    s->xs[k] = INT16_MAX;
+    s->xe[k] = INT16_MIN;
+  }
+}
+
+// Grow the span of each row to take in the rectangle
+void raster_spans_rect(void *spans, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+  raster_spans_t *s = (raster_spans_t *)spans;
+  if (w < 1)
+    return;
+  int32_t xe = x + w - 1;
+  if (x < INT16_MIN)
+    x = INT16_MIN;
+  if (xe > INT16_MAX)
+    xe = INT16_MAX;
+
+  for (int32_t row = y - s->top; row < y - s->top + h; row++)
+  {
+    if ((row < 0) || (row >= s->rows))
+      continue;
+    if (x < s->xs[row])
+      s->xs[row] = x;
+    if (xe > s->xe[row])
+      s->xe[row] = xe;
+  }
+}
+
+// Keep the spans on a screen "width" pixels wide
+void raster_spans_clip(raster_spans_t *s, int32_t width)
+{
+  for (int32_t k = 0; k < s->rows; k++)
+  {
+    if (s->xs[k] < 0)
+      s->xs[k] = 0;
+    if (s->xe[k] >= width)
+      s->xe[k] = width - 1;
+  }
+}
+
+// Leftmost and rightmost pixel of all rows, false when every row is empty
+bool raster_spans_bounds(const raster_spans_t *s, int32_t *xs, int32_t *xe)
+{
+  *xs = INT16_MAX;
+  *xe = INT16_MIN;
+  for (int32_t k = 0; k < s->rows; k++)
+  {
+    if (s->xs[k] > s->xe[k])
+      continue;
+    if (s->xs[k] < *xs)
+      *xs = s->xs[k];
+    if (s->xe[k] > *xe)
+      *xe = s->xe[k];
+  }
+  return *xs <= *xe;
+}
+
+/***************************************************************************************
+** Function name:           raster_fill_circle
+** Description:             filled circle as horizontal lines
+***************************************************************************************/
+// Optimised midpoint circle algorithm
+void raster_fill_circle(raster_rect_t rect, void *ctx, int32_t x0, int32_t y0, int32_t r)
+{
+  int32_t x = 0;
+  int32_t dx = 1;
+  int32_t dy = r + r;
+  int32_t p = -(r >> 1);
+
+  rect(ctx, x0 - r, y0, dy + 1, 1);
+
+  while (x < r)
+  {
+    if (p >= 0)
+    {
+      dy -= 2;
+      p -= dy;
+      r--;
+    }
+
+    dx += 2;
+    p += dx;
+
+    x++;
+
+    rect(ctx, x0 - r, y0 + x, 2 * r + 1, 1);
+    rect(ctx, x0 - r, y0 - x, 2 * r + 1, 1);
+    rect(ctx, x0 - x, y0 + r, 2 * x + 1, 1);
+    rect(ctx, x0 - x, y0 - r, 2 * x + 1, 1);
+  }
+}
+
+void raster_fill_circle_helper(raster_rect_t rect, void *ctx, int32_t x0, int32_t y0, int32_t r, uint8_t cornername, int32_t delta)
+{
+  int32_t f = 1 - r;
+  int32_t ddF_x = 1;
+  int32_t ddF_y = -r - r;
+  int32_t y = 0;
+
+  delta++;
+  while (y < r)
+  {
+    if (f >= 0)
+    {
+      r--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    y++;
+    ddF_x += 2;
+    f += ddF_x;
+
+    if (cornername & 0x1)
+    {
+      rect(ctx, x0 - r, y0 + y, r + r + delta, 1);
+      rect(ctx, x0 - y, y0 + r, y + y + delta, 1);
+    }
+    if (cornername & 0x2)
+    {
+      rect(ctx, x0 - r, y0 - y, r + r + delta, 1);
+      rect(ctx, x0 - y, y0 - r, y + y + delta, 1);
+    }
+  }
+}
+
+void raster_fill_ellipse(raster_rect_t rect, void *ctx, int32_t x0, int32_t y0, int32_t rx, int32_t ry)
+{
+  if ((rx < 2) || (ry < 2))
+    return;
+  int32_t x, y;
+  int32_t rx2 = rx * rx;
+  int32_t ry2 = ry * ry;
+  int32_t fx2 = 4 * rx2;
+  int32_t fy2 = 4 * ry2;
+  int32_t s;
+
+  for (x = 0, y = ry, s = 2 * ry2 + rx2 * (1 - 2 * ry); ry2 * x <= rx2 * y; x++)
+  {
+    rect(ctx, x0 - x, y0 - y, x + x + 1, 1);
+    rect(ctx, x0 - x, y0 + y, x + x + 1, 1);
+
+    if (s >= 0)
+    {
+      s += fx2 * (1 - y);
+      y--;
+    }
+    s += ry2 * ((4 * x) + 6);
+  }
+
+  for (x = rx, y = 0, s = 2 * rx2 + ry2 * (1 - 2 * rx); rx2 * y <= ry2 * x; y++)
+  {
+    rect(ctx, x0 - x, y0 - y, x + x + 1, 1);
+    rect(ctx, x0 - x, y0 + y, x + x + 1, 1);
+
+    if (s >= 0)
+    {
+      s += fy2 * (1 - x);
+      x--;
+    }
+    s += rx2 * ((4 * y) + 6);
+  }
+}
+
+void raster_fill_triangle(raster_rect_t rect, void *ctx, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+{
+  int32_t a, b, y, last;
+
+  // Sort coordinates by Y order (y2 >= y1 >= y0)
+  if (y0 > y1)
+  {
+    raster_swap(y0, y1);
+    raster_swap(x0, x1);
+  }
+  if (y1 > y2)
+  {
+    raster_swap(y2, y1);
+    raster_swap(x2, x1);
+  }
+  if (y0 > y1)
+  {
+    raster_swap(y0, y1);
+    raster_swap(x0, x1);
+  }
+
+  if (y0 == y2)
+  { // Handle awkward all-on-same-line case as its own thing
+    a = b = x0;
+    if (x1 < a)
+      a = x1;
+    else if (x1 > b)
+      b = x1;
+    if (x2 < a)
+      a = x2;
+    else if (x2 > b)
+      b = x2;
+    rect(ctx, a, y0, b - a + 1, 1);
+    return;
+  }
+
+  int32_t
+      dx01 = x1 - x0,
+      dy01 = y1 - y0,
+      dx02 = x2 - x0,
+      dy02 = y2 - y0,
+      dx12 = x2 - x1,
+      dy12 = y2 - y1,
+      sa = 0,
+      sb = 0;
+
+  // Scanline y1 goes with the upper part only for a flat bottomed triangle
+  if (y1 == y2)
+    last = y1;
+  else
+    last = y1 - 1;
+
+  for (y = y0; y <= last; y++)
+  {
+    a = x0 + sa / dy01;
+    b = x0 + sb / dy02;
+    sa += dx01;
+    sb += dx02;
+
+    if (a > b)
+      raster_swap(a, b);
+    rect(ctx, a, y, b - a + 1, 1);
+  }
+
+  sa = dx12 * (y - y1);
+  sb = dx02 * (y - y0);
+  for (; y <= y2; y++)
+  {
+    a = x1 + sa / dy12;
+    b = x0 + sb / dy02;
+    sa += dx12;
+    sb += dx02;
+
+    if (a > b)
+      raster_swap(a, b);
+    rect(ctx, a, y, b - a + 1, 1);
+  }
+}
+
+void raster_fill_round_rect(raster_rect_t rect, void *ctx, int32_t x, int32_t y, int32_t w, int32_t h, int32_t r)
+{
+  rect(ctx, x, y + r, w, h - r - r);
+
+  // four corners
+  raster_fill_circle_helper(rect, ctx, x + r, y + h - r - 1, r, 1, w - r - r - 1);
+  raster_fill_circle_helper(rect, ctx, x + r, y + r, r, 2, w - r - r - 1);
+}
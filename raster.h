@@ -0,0 +1,32 @@
+#ifndef _RASTERH_
+#define _RASTERH_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define RASTER_MAX_ROWS 320 // tallest screen
+
+// Where a shape puts its rectangles, lines have a width or height of 1
+typedef void (*raster_rect_t)(void *ctx, int32_t x, int32_t y, int32_t w, int32_t h);
+
+// One span per row, enough for convex shapes. Rows outside [top, top + rows) are dropped.
+typedef struct
+{
+  int32_t top, rows;
+  int16_t xs[RASTER_MAX_ROWS]; // first pixel of the row
+  int16_t xe[RASTER_MAX_ROWS]; // last pixel, below xs when the row is empty
+} raster_spans_t;
+
+void raster_spans_begin(raster_spans_t *s, int32_t top, int32_t rows);
+void raster_spans_rect(void *spans, int32_t x, int32_t y, int32_t w, int32_t h);
+void raster_spans_clip(raster_spans_t *s, int32_t width);
+bool raster_spans_bounds(const raster_spans_t *s, int32_t *xs, int32_t *xe);
+
+// The filled shapes of ST7789, rectangle for rectangle
+void raster_fill_circle(raster_rect_t rect, void *ctx, int32_t x0, int32_t y0, int32_t r);
+void raster_fill_circle_helper(raster_rect_t rect, void *ctx, int32_t x0, int32_t y0, int32_t r, uint8_t cornername, int32_t delta);
+void raster_fill_ellipse(raster_rect_t rect, void *ctx, int32_t x0, int32_t y0, int32_t rx, int32_t ry);
+void raster_fill_triangle(raster_rect_t rect, void *ctx, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+void raster_fill_round_rect(raster_rect_t rect, void *ctx, int32_t x, int32_t y, int32_t w, int32_t h, int32_t r);
+
+#endif
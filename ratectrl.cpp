@@ -0,0 +1,120 @@
+#include <Arduino.h>
+#include <math.h>
+#include "ratectrl.h"
+
+static rc_stats_t rc;
+static uint32_t rc_target = 0;
+static bool rc_max_quality = false;
+static float rc_last_preview = 0;
+
+void rc_init(uint32_t target_size)
+{
+  memset(&rc, 0, sizeof(rc));
+  rc.gain = 1.0f;
+  rc_target = target_size;
+  rc_max_quality = false;
+  rc_last_preview = 0;
+}
+
+void rc_set_target(uint32_t target_size)
+{
+  rc_target = target_size;
+}
+
+void rc_set_max_quality(bool enable)
+{
+  rc_max_quality = enable;
+}
+
+// Preview frames are the same UXGA scene encoded at PREVIEW_QUALITY, their size is a
+// cheap measure of the scene complexity
+void rc_observe_preview(size_t len)
+{
+  if (!len)
+    return;
+
+  if (rc.preview_avg == 0)
+  {
+    rc.preview_avg = len;
+    rc.preview_trend = 0;
+  }
+  else
+  {
+    float delta = (float)len - rc_last_preview;
+    rc.preview_trend += RC_PREVIEW_ALPHA * (delta - rc.preview_trend);
+    rc.preview_avg += RC_PREVIEW_ALPHA * ((float)len - rc.preview_avg);
+  }
+  rc_last_preview = len;
+}
+
+static float rc_predict(float complexity, uint8_t quality)
+{
+  return complexity * rc.gain * powf((float)PREVIEW_QUALITY / quality, RC_EXPONENT);
+}
+
+// Predict the scene complexity "frames_ahead" frames from now and return the best
+// quality that should still fit the target size
+uint8_t rc_pick_quality(uint8_t frames_ahead)
+{
+  uint8_t quality;
+  float complexity = rc.preview_avg + rc.preview_trend * frames_ahead;
+
+  if (complexity < rc.preview_avg / 2)
+    complexity = rc.preview_avg / 2;
+
+  if (rc_max_quality)
+    quality = SNAP_QUALITY_BEST;
+  else if ((!rc_target) || (complexity <= 0))
+    quality = SNAP_QUALITY;
+  else
+  {
+    // invert the size model: quality = PREVIEW_QUALITY * (predict / target) ^ (1 / RC_EXPONENT)
+    float q = PREVIEW_QUALITY * powf(complexity * rc.gain / rc_target, 1.0f / RC_EXPONENT);
+    quality = (q > SNAP_QUALITY_WORST) ? SNAP_QUALITY_WORST : (uint8_t)ceilf(q);
+    if (quality < SNAP_QUALITY_BEST)
+      quality = SNAP_QUALITY_BEST;
+  }
+
+  rc.last_quality = quality;
+  rc.last_target = rc_target;
+  rc.last_predict = (complexity > 0) ? rc_predict(complexity, quality) : 0;
+  return quality;
+}
+
+// Feed back the achieved size of the shot taken with the last picked quality
+void rc_record_shot(size_t len)
+{
+  rc.last_actual = len;
+
+  if ((rc.last_predict) && (len))
+  {
+    // learn in log domain so over and under shoot weigh the same
+    float ratio = (float)len / rc.last_predict;
+    rc.gain *= powf(ratio, RC_GAIN_ALPHA);
+  }
+
+  if ((rc.last_target) && (!rc_max_quality))
+  {
+    rc.shots++;
+    rc.sum_target += rc.last_target;
+    rc.sum_actual += len;
+    if (len > rc.last_target)
+      rc.over_budget++;
+  }
+}
+
+const rc_stats_t *rc_get_stats()
+{
+  return &rc;
+}
+
+void rc_print_stats()
+{
+  Serial.printf("RC: q=%d target=%luKB predict=%luKB actual=%luKB gain=%.2f\n",
+                rc.last_quality, rc.last_target / 1024, rc.last_predict / 1024, rc.last_actual / 1024, rc.gain);
+  if (rc.shots)
+  {
+    Serial.printf("RC: %lu shots, %lu over budget, achieved/target %.1f%%\n",
+                  rc.shots, rc.over_budget, 100.0f * rc.sum_actual / rc.sum_target);
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef _RATECTRLH_
+#define _RATECTRLH_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SNAP_QUALITY 6 // 1-63, 1 is the best, used when rate control is disabled
+// Target size of a single shot, 0 disables rate control and always use SNAP_QUALITY
+#define SNAP_TARGET_SIZE (320 * 1024)
+// Rate control search range, 1-63, 1 is the best
+#define SNAP_QUALITY_BEST 4
+#define SNAP_QUALITY_WORST 24
+// Quality used by the preview frames, all predictions are relative to it
+#define PREVIEW_QUALITY 63
+
+// Size model: snap size = preview size * gain * (PREVIEW_QUALITY / quality) ^ RC_EXPONENT
+#define RC_EXPONENT 0.8f
+#define RC_PREVIEW_ALPHA 0.25f // preview size smoothing
+#define RC_GAIN_ALPHA 0.5f     // model gain learning rate
+
+typedef struct
+{
+  uint32_t shots;        // shots taken under rate control
+  uint32_t over_budget;  // shots larger than the target
+  uint64_t sum_target;   // sum of target sizes
+  uint64_t sum_actual;   // sum of achieved sizes
+  uint32_t last_target;  // target size of the last shot
+  uint32_t last_predict; // predicted size of the last shot
+  uint32_t last_actual;  // achieved size of the last shot
+  uint8_t last_quality;  // quality used by the last shot
+  float gain;            // current model gain
+  float preview_avg;     // smoothed preview frame size
+  float preview_trend;   // smoothed preview size change per frame
+} rc_stats_t;
+
+void rc_init(uint32_t target_size);
+void rc_set_target(uint32_t target_size);
+void rc_set_max_quality(bool enable); // escape hatch, always use SNAP_QUALITY_BEST
+void rc_observe_preview(size_t len);
+uint8_t rc_pick_quality(uint8_t frames_ahead);
+void rc_record_shot(size_t len);
+const rc_stats_t *rc_get_stats();
+void rc_print_stats();
+
+#endif
@@ -0,0 +1,444 @@
+#include <SD.h>
+#include <esp_timer.h>
+#include "sdwriter.h"
+#include "capfile.h"
+
+static SDStorage sdStorage;
+static Storage *storage = &sdStorage;
+static ChunkWriter writer;
+static QueueHandle_t queue = NULL;
+static sdw_callback_t doneCallback = NULL;
+static sdw_stats_t stats = {0};
+static volatile uint32_t pending = 0;
+static portMUX_TYPE pendingMux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t writeSamples[SDW_LATENCY_SAMPLES];
+static uint32_t sampleCount = 0;
+static bool poolReady[SDW_POOL_SIZE + 1];
+static bool poolStalled = false; // a refill failed, wait for the next successful write
+static float sizeEstimate = 0;
+
+static void sdw_pool_path(char *path, size_t size, int k)
+{
+  snprintf(path, size, SDW_POOL_DIR "/P%02d.TMP", k);
+}
+
+static uint32_t sdw_pool_file_size()
+{
+  // largest recent capture plus a margin, in 32KB steps
+  uint32_t size = sizeEstimate * 1.25f;
+  if (size < SDW_PREALLOC_MIN)
+    size = SDW_PREALLOC_MIN;
+  return (size + 0x7FFF) & ~0x7FFF;
+}
+
+// Create one missing pool file, returns false when the pool is full or a refill failed
+static bool sdw_fill_pool()
+{
+  char path[48];
+
+  if (poolStalled)
+    return false;
+  for (int k = 0; k < SDW_POOL_SIZE; k++)
+  {
+    if (poolReady[k])
+      continue;
+    sdw_pool_path(path, sizeof(path), k);
+    int fd = storage->open(path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0)
+    {
+      poolStalled = true;
+      return false;
+    }
+    // FATFS allocates the whole cluster chain at once instead of one cluster at a
+    // time during the capture write
+    stats.prealloc_size = sdw_pool_file_size();
+    poolReady[k] = storage->preallocate(fd, stats.prealloc_size);
+    storage->close(fd);
+    // most likely a full card, retrying every idle period would only wear it
+    if (!poolReady[k])
+    {
+      storage->remove(path);
+      poolStalled = true;
+    }
+    return poolReady[k];
+  }
+  return false;
+}
+
+// Move a preallocated pool file to "path"
+static bool sdw_take_pool(const char *path)
+{
+  char poolPath[48];
+
+  for (int k = 0; k < SDW_POOL_SIZE; k++)
+  {
+    if (!poolReady[k])
+      continue;
+    poolReady[k] = false;
+    sdw_pool_path(poolPath, sizeof(poolPath), k);
+    storage->remove(path);
+    return storage->rename(poolPath, path) == 0;
+  }
+  return false;
+}
+
+// A header replaces the SOI marker of the image, both are streamed into a temporary
+// file that only gets its final name once complete, see capfile.h
+static bool sdw_write_file(const char *filename, const uint8_t *head, size_t headLen, const uint8_t *buf, size_t len)
+{
+  if ((head) && (len >= 2))
+  {
+    buf += 2;
+    len -= 2;
+  }
+  size_t total = headLen + len;
+  capfile_footer_t footer;
+  char temp[SDW_FILENAME_SIZE];
+  capfile_temp_path(filename, temp, sizeof(temp));
+
+  bool pooled = sdw_take_pool(temp);
+  int fd = pooled ? storage->open(temp, O_WRONLY) : storage->open(temp, O_WRONLY | O_CREAT | O_TRUNC);
+  if (fd < 0)
+    return false;
+
+  if (pooled)
+    stats.pooled++;
+  else
+    storage->preallocate(fd, total + sizeof(footer)); // the size is known, allocate the chain before the data
+
+  writer.start(storage, fd);
+  if (head)
+    writer.write(head, headLen);
+  writer.write(buf, len);
+  capfile_footer(&footer, total, writer.crc());
+  writer.write((const uint8_t *)&footer, sizeof(footer));
+  bool ok = writer.finish();
+
+  // give back the unused part of the pool file
+  if ((ok) && (pooled) && (storage->truncate(fd, total + sizeof(footer)) != 0))
+    ok = false;
+
+  ok = (storage->close(fd) == 0) && ok;
+  return ok && capfile_commit(storage, temp, filename);
+}
+
+static void sdw_add_sample(uint32_t write_us)
+{
+  writeSamples[sampleCount % SDW_LATENCY_SAMPLES] = write_us;
+  sampleCount++;
+}
+
+static void sdw_pending_add(int32_t n)
+{
+  portENTER_CRITICAL(&pendingMux);
+  pending += n;
+  portEXIT_CRITICAL(&pendingMux);
+}
+
+static void sdw_task(void *parameter)
+{
+  sdw_job_t job;
+
+  for (;;)
+  {
+    if (xQueueReceive(queue, &job, SDW_IDLE_MS / portTICK_PERIOD_MS) != pdTRUE)
+    {
+      // nothing to write, prepare the next capture files
+      sdw_fill_pool();
+      continue;
+    }
+
+    int64_t start = esp_timer_get_time();
+    bool ok = sdw_write_file(job.filename, job.head, job.head_len, job.buf, job.len);
+    int64_t end = esp_timer_get_time();
+
+    if (job.head)
+    {
+      job.len += job.head_len - 2;
+      free(job.head);
+    }
+    if (job.copy)
+      free(job.copy);
+    else
+      cam_frame_return(&job.frame);
+
+    uint32_t write_us = end - start;
+    uint32_t latency_us = end - job.queued;
+    if (ok)
+    {
+      poolStalled = false;
+      stats.jobs++;
+      stats.bytes += job.len;
+      if (job.len > sizeEstimate)
+        sizeEstimate = job.len;
+      else
+        sizeEstimate += (job.len - sizeEstimate) / 8;
+    }
+    else
+      stats.failed++;
+    if (stats.jobs + stats.failed == 1)
+    {
+      stats.write_avg_us = write_us;
+      stats.latency_avg_us = latency_us;
+    }
+    stats.write_avg_us += ((int32_t)write_us - (int32_t)stats.write_avg_us) / 4;
+    if (write_us > stats.write_max_us)
+      stats.write_max_us = write_us;
+    stats.latency_avg_us += ((int32_t)latency_us - (int32_t)stats.latency_avg_us) / 4;
+    if (latency_us > stats.latency_max_us)
+      stats.latency_max_us = latency_us;
+    sdw_add_sample(write_us);
+
+    if (doneCallback)
+      doneCallback(job.filename, job.len, ok, write_us);
+
+    sdw_pending_add(-1);
+  }
+}
+
+bool sdw_begin(sdw_callback_t callback)
+{
+  if (queue)
+    return true;
+
+  doneCallback = callback;
+  if (!writer.begin(SDW_CHUNK_SIZE))
+    return false;
+
+#if SDW_POOL_SIZE
+  // pool files survive a reboot
+  char path[48];
+  size_t size;
+  storage->mkdir(SDW_POOL_DIR);
+  for (int k = 0; k < SDW_POOL_SIZE; k++)
+  {
+    sdw_pool_path(path, sizeof(path), k);
+    poolReady[k] = (storage->exists(path, &size)) && (size >= SDW_PREALLOC_MIN);
+  }
+#endif
+
+  queue = xQueueCreate(SDW_QUEUE_LEN, sizeof(sdw_job_t));
+  if (!queue)
+    return false;
+
+  return xTaskCreatePinnedToCore(
+             sdw_task,          /* Task function. */
+             "SDWriterTask",    /* String with name of task. */
+             SDW_TASK_STACK,    /* Stack size in bytes. */
+             NULL,              /* Parameter passed as input of the task */
+             SDW_TASK_PRIORITY, /* Priority of the task. */
+             NULL,              /* Task handle. */
+             SDW_TASK_CORE) == pdPASS;
+}
+
+static bool sdw_enqueue(sdw_job_t *job)
+{
+  job->queued = esp_timer_get_time();
+
+  sdw_pending_add(1);
+  if (pending > stats.queue_max)
+    stats.queue_max = pending;
+
+  // back-pressure: wait for the writer when the queue is full
+  if (xQueueSend(queue, job, 0) != pdTRUE)
+  {
+    stats.full++;
+    xQueueSend(queue, job, portMAX_DELAY);
+  }
+  return true;
+}
+
+// Queue a camera frame. With "copy" the frame goes to PSRAM and is returned to the
+// camera at once, otherwise (or when PSRAM is short) the writer holds the frame buffer.
+// An optional malloc'ed "head" (SOI plus APP segments) is written in place of the SOI
+// of the frame and freed by the writer.
+bool sdw_submit(const char *filename, cam_frame_t *frame, bool copy, uint8_t *head, size_t headLen)
+{
+  sdw_job_t job;
+
+  if ((!queue) || (!frame->fb))
+  {
+    free(head);
+    return false;
+  }
+
+  job.head = head;
+  job.head_len = head ? headLen : 0;
+
+  strncpy(job.filename, filename, SDW_FILENAME_SIZE - 1);
+  job.filename[SDW_FILENAME_SIZE - 1] = 0;
+  job.len = frame->fb->len;
+  job.copy = copy ? (uint8_t *)ps_malloc(job.len) : NULL;
+
+  if (job.copy)
+  {
+    memcpy(job.copy, frame->fb->buf, job.len);
+    job.buf = job.copy;
+    job.frame.fb = NULL;
+    cam_frame_return(frame);
+  }
+  else
+  {
+    stats.borrowed++;
+    job.buf = frame->fb->buf;
+    job.frame = *frame;
+    frame->fb = NULL; // owned by the writer now
+  }
+
+  return sdw_enqueue(&job);
+}
+
+// Queue a malloc'ed buffer with an optional "head" as for sdw_submit(), the writer frees both
+bool sdw_submit_buf(const char *filename, uint8_t *buf, size_t len, uint8_t *head, size_t headLen)
+{
+  sdw_job_t job;
+
+  if (!queue)
+  {
+    free(head);
+    return false;
+  }
+
+  strncpy(job.filename, filename, SDW_FILENAME_SIZE - 1);
+  job.filename[SDW_FILENAME_SIZE - 1] = 0;
+  job.head = head;
+  job.head_len = head ? headLen : 0;
+  job.copy = buf;
+  job.buf = buf;
+  job.len = len;
+  job.frame.fb = NULL;
+
+  return sdw_enqueue(&job);
+}
+
+// Route the writer through another storage, for instance one with a latency model
+void sdw_set_storage(Storage *newStorage)
+{
+  sdw_wait_idle();
+  storage = newStorage ? newStorage : &sdStorage;
+}
+
+Storage *sdw_get_storage()
+{
+  return storage;
+}
+
+bool sdw_set_chunk_size(size_t chunkSize)
+{
+  sdw_wait_idle();
+  return writer.begin(chunkSize);
+}
+
+uint32_t sdw_pending()
+{
+  return pending;
+}
+
+// Write time that "percent" of the recent jobs stayed under
+uint32_t sdw_write_percentile(uint8_t percent)
+{
+  uint32_t sorted[SDW_LATENCY_SAMPLES];
+  uint32_t n = (sampleCount < SDW_LATENCY_SAMPLES) ? sampleCount : SDW_LATENCY_SAMPLES;
+  if (!n)
+    return 0;
+
+  memcpy(sorted, writeSamples, n * sizeof(uint32_t));
+  // insertion sort, n is small
+  for (uint32_t k = 1; k < n; k++)
+  {
+    uint32_t v = sorted[k];
+    int32_t j = k - 1;
+    while ((j >= 0) && (sorted[j] > v))
+    {
+      sorted[j + 1] = sorted[j];
+      j--;
+    }
+    sorted[j + 1] = v;
+  }
+  uint32_t idx = (n * percent + 99) / 100;
+  return sorted[(idx ? idx : 1) - 1];
+}
+
+// Block until every queued job has been written
+void sdw_wait_idle()
+{
+  while (pending)
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+}
+
+const sdw_stats_t *sdw_get_stats()
+{
+  return &stats;
+}
+
+void sdw_print_stats()
+{
+  Serial.printf("SD writer: %lu jobs, %lu failed, %lu borrowed, %lu full, queue max %lu\n",
+                stats.jobs, stats.failed, stats.borrowed, stats.full, stats.queue_max);
+  Serial.printf("SD writer: write avg %lums p99 %lums max %lums, latency avg %lums max %lums\n",
+                stats.write_avg_us / 1000, sdw_write_percentile(99) / 1000, stats.write_max_us / 1000, stats.latency_avg_us / 1000, stats.latency_max_us / 1000);
+  Serial.printf("SD writer: %lu pooled, pool file size %luKB\n", stats.pooled, stats.prealloc_size / 1024);
+
+  // card level operations, pool refills included
+  const storage_stats_t *st = storage->stats();
+  uint32_t shots = stats.jobs ? stats.jobs : 1;
+  Serial.printf("SD writer: per shot %.1f opens %.1f writes %.1f truncates %.1f renames, %.1f clusters %.1f FAT sectors\n",
+                (float)st->ops[STORAGE_OPEN] / shots, (float)st->ops[STORAGE_WRITE] / shots, (float)st->ops[STORAGE_TRUNCATE] / shots,
+                (float)st->ops[STORAGE_RENAME] / shots, (float)st->clusters / shots, (float)st->fat_writes / shots);
+}
+
+// Write "total" bytes from PSRAM with each chunk size and report the sustained speed
+void sdw_bench(const char *path, size_t total)
+{
+  static const size_t chunkSizes[] = {512, 1024, 2048, 4096, 8192, 16384, 32768};
+  size_t savedSize = writer.chunkSize();
+
+  uint8_t *data = (uint8_t *)ps_malloc(total);
+  if (!data)
+    return;
+  for (size_t k = 0; k < total; k++)
+    data[k] = k;
+
+  sdw_wait_idle();
+
+  // unaligned single write straight from PSRAM, as before
+  int64_t start = esp_timer_get_time();
+  File file = SD.open(path, FILE_WRITE);
+  file.write(data, total);
+  file.close();
+  int64_t elapsed = esp_timer_get_time() - start;
+  Serial.printf("SD bench: direct     %.2f MB/s\n", (float)total / elapsed);
+
+  for (size_t k = 0; k < sizeof(chunkSizes) / sizeof(chunkSizes[0]); k++)
+  {
+    if (!writer.begin(chunkSizes[k]))
+    {
+      Serial.printf("SD bench: chunk %5u no DMA memory\n", (unsigned)chunkSizes[k]);
+      continue;
+    }
+    start = esp_timer_get_time();
+    int fd = storage->open(path, O_WRONLY | O_CREAT | O_TRUNC);
+    writer.start(storage, fd);
+    writer.write(data, total);
+    writer.finish();
+    storage->close(fd);
+    elapsed = esp_timer_get_time() - start;
+    Serial.printf("SD bench: chunk %5u %.2f MB/s\n", (unsigned)chunkSizes[k], (float)total / elapsed);
+  }
+
+  // same as the capture path, clusters allocated before the data is written
+  writer.begin(savedSize);
+  start = esp_timer_get_time();
+  int fd = storage->open(path, O_WRONLY | O_CREAT | O_TRUNC);
+  storage->preallocate(fd, total);
+  writer.start(storage, fd);
+  writer.write(data, total);
+  writer.finish();
+  storage->close(fd);
+  elapsed = esp_timer_get_time() - start;
+  Serial.printf("SD bench: prealloc   %.2f MB/s\n", (float)total / elapsed);
+
+  SD.remove(path);
+  free(data);
+  writer.begin(savedSize);
+}
@@ -0,0 +1,66 @@
+#ifndef _SDWRITERH_
+#define _SDWRITERH_
+
+#include <Arduino.h>
+#include "camframe.h"
+#include "chunkwriter.h"
+#include "storage.h"
+
+#define SDW_QUEUE_LEN 3       // capture jobs waiting for the card, submit blocks when full
+#define SDW_TASK_STACK 4096
+#define SDW_TASK_PRIORITY 1
+#define SDW_TASK_CORE 0       // loop() runs on core 1
+#define SDW_FILENAME_SIZE 32
+#define SDW_CHUNK_SIZE 8192 // bytes per card write, whole sectors
+// Preallocated capture files, kept full sized so a capture never grows the FAT chain
+#define SDW_POOL_SIZE 2 // 0 to disable the pool
+#define SDW_POOL_DIR "/DCIM/POOL"
+#define SDW_PREALLOC_MIN (256 * 1024)
+#define SDW_IDLE_MS 500 // refill the pool after this long without a job
+#define SDW_LATENCY_SAMPLES 64
+
+// Called from the writer task once a job is done, do not draw on the TFT from here
+typedef void (*sdw_callback_t)(const char *filename, size_t len, bool ok, uint32_t write_us);
+
+typedef struct
+{
+  char filename[SDW_FILENAME_SIZE];
+  uint8_t *head;     // written before the data instead of its SOI, freed after the write
+  size_t head_len;
+  uint8_t *copy;     // owned copy of the data, freed after the write
+  cam_frame_t frame; // or a borrowed camera frame, returned after the write
+  const uint8_t *buf;
+  size_t len;
+  int64_t queued; // esp_timer time of submit, us
+} sdw_job_t;
+
+typedef struct
+{
+  uint32_t jobs;         // jobs written
+  uint32_t failed;       // jobs that could not be written
+  uint32_t borrowed;     // jobs that held a camera frame buffer
+  uint32_t full;         // submits that blocked on a full queue
+  uint32_t queue_max;    // highest queue depth seen
+  uint32_t write_avg_us; // open, write and close
+  uint32_t write_max_us;
+  uint32_t latency_avg_us; // submit to done
+  uint32_t latency_max_us;
+  uint32_t pooled;        // jobs written into a preallocated pool file
+  uint32_t prealloc_size; // current pool file size
+  uint64_t bytes;
+} sdw_stats_t;
+
+bool sdw_begin(sdw_callback_t callback);
+bool sdw_submit(const char *filename, cam_frame_t *frame, bool copy = true, uint8_t *head = NULL, size_t headLen = 0);
+bool sdw_submit_buf(const char *filename, uint8_t *buf, size_t len, uint8_t *head = NULL, size_t headLen = 0);
+void sdw_set_storage(Storage *newStorage);
+Storage *sdw_get_storage();
+bool sdw_set_chunk_size(size_t chunkSize);
+uint32_t sdw_pending();
+uint32_t sdw_write_percentile(uint8_t percent);
+void sdw_wait_idle();
+const sdw_stats_t *sdw_get_stats();
+void sdw_print_stats();
+void sdw_bench(const char *path, size_t total);
+
+#endif
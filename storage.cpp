@@ -0,0 +1,365 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "storage.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+static void storage_sleep_us(uint32_t us)
+{
+  if (us >= 1000)
+    vTaskDelay(us / 1000 / portTICK_PERIOD_MS);
+}
+#else
+static void storage_sleep_us(uint32_t us)
+{
+  usleep(us);
+}
+#endif
+
+/***************************************************************************************
+** SD card latency model
+***************************************************************************************/
+// Rough figures for SPI mode at 20MHz, 32KB clusters
+const sdcard_model_t SDCardLatency::class4 = {32768, 2500, 300, 1.2f, 1500, 900, 4 * 1024 * 1024, 60000};
+const sdcard_model_t SDCardLatency::class10 = {32768, 1200, 150, 1.8f, 800, 500, 8 * 1024 * 1024, 25000};
+
+SDCardLatency::SDCardLatency(const sdcard_model_t *model)
+{
+  _model = model ? *model : class10;
+  _written = 0;
+}
+
+uint32_t SDCardLatency::cost(storage_op_t op, size_t bytes, uint32_t fatSectors)
+{
+  uint32_t us = fatSectors * _model.fat_us;
+
+  switch (op)
+  {
+  case STORAGE_WRITE:
+  {
+    us += _model.write_us + bytes / _model.bytes_per_us;
+    if (bytes & 511)
+      us += _model.unaligned_us;
+    uint64_t before = _written;
+    _written += bytes;
+    if ((_model.stall_bytes) && (before / _model.stall_bytes != _written / _model.stall_bytes))
+      us += _model.stall_us;
+    break;
+  }
+  case STORAGE_READ:
+    us += _model.write_us + bytes / (2 * _model.bytes_per_us);
+    break;
+  case STORAGE_SEEK:
+    break; // no card access until the next read or write
+  default:
+    us += _model.op_us;
+    break;
+  }
+  return us;
+}
+
+/***************************************************************************************
+** Storage
+***************************************************************************************/
+Storage::Storage(const char *root, StorageLatency *latency, bool sleep)
+{
+  strncpy(_root, root, sizeof(_root) - 1);
+  _root[sizeof(_root) - 1] = 0;
+  _latency = latency;
+  _sleep = sleep;
+  for (int k = 0; k < STORAGE_MAX_FILES; k++)
+    _fd[k] = -1;
+  _faultOps = UINT32_MAX;
+  _nextCluster = 2; // first data cluster
+  _fatWindow = UINT32_MAX;
+  _fatDirty = false;
+  resetStats();
+}
+
+void Storage::setLatency(StorageLatency *latency, bool sleep)
+{
+  _latency = latency;
+  _sleep = sleep;
+}
+
+void Storage::resetStats()
+{
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void Storage::fullPath(char *out, const char *path)
+{
+  snprintf(out, STORAGE_PATH_SIZE, "%s%s", _root, path);
+}
+
+// True when the current operation must not happen
+bool Storage::fault()
+{
+  if (_faultOps == UINT32_MAX)
+    return false;
+  if (_faultOps == 0)
+    return true;
+  return --_faultOps == 0;
+}
+
+int Storage::slot(int fd)
+{
+  for (int k = 0; k < STORAGE_MAX_FILES; k++)
+  {
+    if (_fd[k] == fd)
+      return k;
+  }
+  return -1;
+}
+
+// Bring the FAT sector holding the entry of "cluster" into the window, returns the
+// sectors written back to make room
+uint32_t Storage::touchFat(uint32_t cluster)
+{
+  uint32_t sector = cluster / STORAGE_FAT_ENTRIES;
+  uint32_t written = 0;
+  if (sector != _fatWindow)
+  {
+    written = flushFat();
+    _fatWindow = sector;
+  }
+  _fatDirty = true;
+  return written;
+}
+
+uint32_t Storage::flushFat()
+{
+  if (!_fatDirty)
+    return 0;
+  _fatDirty = false;
+  return 1;
+}
+
+// Link "clusters" more clusters to the chain of open file "k", one FAT entry each plus
+// the entry of the old last cluster. Returns the FAT sectors written back meanwhile.
+uint32_t Storage::allocate(int k, uint32_t clusters)
+{
+  uint32_t written = 0;
+  if ((clusters) && (_last[k] != UINT32_MAX) && (_clusters[k]))
+    written += touchFat(_last[k]);
+  for (uint32_t n = 0; n < clusters; n++)
+  {
+    _last[k] = _nextCluster++;
+    written += touchFat(_last[k]);
+  }
+  _clusters[k] += clusters;
+  return written;
+}
+
+// Unlink the last "clusters" clusters of open file "k"
+uint32_t Storage::release(int k, uint32_t clusters)
+{
+  uint32_t written = 0;
+  if (_last[k] == UINT32_MAX)
+  {
+    // chain allocated before the file was opened, somewhere else on the card
+    written = flushFat() + (clusters + STORAGE_FAT_ENTRIES - 1) / STORAGE_FAT_ENTRIES;
+    _fatWindow = UINT32_MAX;
+  }
+  else
+  {
+    // the new last cluster gets the end of chain mark
+    for (uint32_t n = (_clusters[k] > clusters) ? 0 : 1; n <= clusters; n++)
+      written += touchFat(_last[k] - clusters + n);
+    _last[k] -= clusters;
+  }
+  _clusters[k] -= clusters;
+  return written;
+}
+
+void Storage::account(storage_op_t op, size_t bytes, uint32_t clusters, uint32_t fatSectors)
+{
+  _stats.ops[op]++;
+  _stats.clusters += clusters;
+  _stats.fat_writes += fatSectors;
+  if (op == STORAGE_WRITE)
+    _stats.bytes += bytes;
+
+  if (_latency)
+  {
+    uint32_t us = _latency->cost(op, bytes, fatSectors);
+    _stats.busy_us += us;
+    if (_sleep)
+      storage_sleep_us(us);
+  }
+}
+
+int Storage::open(const char *path, int flags)
+{
+  char full[STORAGE_PATH_SIZE];
+  struct stat st;
+  fullPath(full, path);
+
+  if (fault())
+    return -1;
+  int fd = ::open(full, flags, 0666);
+  account(STORAGE_OPEN, 0);
+  if (fd < 0)
+    return fd;
+
+  int k = slot(-1);
+  if (k >= 0)
+  {
+    uint32_t cluster = _latency ? _latency->clusterSize() : 32768;
+    _fd[k] = fd;
+    _pos[k] = 0;
+    _clusters[k] = (fstat(fd, &st) == 0) ? (st.st_size + cluster - 1) / cluster : 0;
+    _last[k] = _clusters[k] ? UINT32_MAX : 0;
+  }
+  return fd;
+}
+
+ssize_t Storage::write(int fd, const void *buf, size_t len)
+{
+  bool tripping = _faultOps == 1;
+  if (fault())
+  {
+    // torn write, the sectors before the power loss made it to the card
+    if ((tripping) && (len > 1))
+      ::write(fd, buf, len / 2);
+    return -1;
+  }
+  ssize_t wb = ::write(fd, buf, len);
+  uint32_t added = 0, fatSectors = 0;
+
+  int k = slot(fd);
+  if ((k >= 0) && (wb > 0))
+  {
+    uint32_t cluster = _latency ? _latency->clusterSize() : 32768;
+    _pos[k] += wb;
+    uint32_t need = (_pos[k] + cluster - 1) / cluster;
+    if (need > _clusters[k])
+    {
+      added = need - _clusters[k];
+      fatSectors = allocate(k, added);
+    }
+  }
+  account(STORAGE_WRITE, (wb > 0) ? wb : 0, added, fatSectors);
+  return wb;
+}
+
+ssize_t Storage::read(int fd, void *buf, size_t len)
+{
+  if (fault())
+    return -1;
+  ssize_t rb = ::read(fd, buf, len);
+  int k = slot(fd);
+  if ((k >= 0) && (rb > 0))
+    _pos[k] += rb;
+  account(STORAGE_READ, (rb > 0) ? rb : 0);
+  return rb;
+}
+
+off_t Storage::seek(int fd, off_t offset, int whence)
+{
+  if (fault())
+    return -1;
+  off_t pos = ::lseek(fd, offset, whence);
+  int k = slot(fd);
+  if ((k >= 0) && (pos >= 0))
+    _pos[k] = pos;
+  account(STORAGE_SEEK, 0);
+  return pos;
+}
+
+int Storage::truncate(int fd, off_t len)
+{
+  if (fault())
+    return -1;
+  int rc = ::ftruncate(fd, len);
+  uint32_t fatSectors = 0;
+
+  int k = slot(fd);
+  if ((k >= 0) && (rc == 0))
+  {
+    uint32_t cluster = _latency ? _latency->clusterSize() : 32768;
+    uint32_t keep = (len + cluster - 1) / cluster;
+    // releasing clusters rewrites their FAT entries just like allocating them
+    if (keep < _clusters[k])
+      fatSectors = release(k, _clusters[k] - keep);
+  }
+  account(STORAGE_TRUNCATE, 0, 0, fatSectors);
+  return rc;
+}
+
+int Storage::close(int fd)
+{
+  int k = slot(fd);
+  if (k >= 0)
+    _fd[k] = -1;
+  // the descriptor is released either way, a lost close just never reaches the card
+  bool lost = fault();
+  account(STORAGE_CLOSE, 0, 0, lost ? 0 : flushFat());
+  ::close(fd);
+  return lost ? -1 : 0;
+}
+
+int Storage::rename(const char *from, const char *to)
+{
+  char fullFrom[STORAGE_PATH_SIZE], fullTo[STORAGE_PATH_SIZE];
+  fullPath(fullFrom, from);
+  fullPath(fullTo, to);
+  if (fault())
+    return -1;
+  account(STORAGE_RENAME, 0);
+  // FATFS does not replace an existing entry, POSIX would
+  struct stat st;
+  if (::stat(fullTo, &st) == 0)
+  {
+    errno = EEXIST;
+    return -1;
+  }
+  return ::rename(fullFrom, fullTo);
+}
+
+int Storage::remove(const char *path)
+{
+  char full[STORAGE_PATH_SIZE];
+  fullPath(full, path);
+  if (fault())
+    return -1;
+  account(STORAGE_REMOVE, 0);
+  return ::unlink(full);
+}
+
+bool Storage::exists(const char *path, size_t *size)
+{
+  char full[STORAGE_PATH_SIZE];
+  struct stat st;
+  fullPath(full, path);
+  if (fault())
+    return false;
+  account(STORAGE_STAT, 0);
+  if (::stat(full, &st) != 0)
+    return false;
+  if (size)
+    *size = st.st_size;
+  return true;
+}
+
+int Storage::mkdir(const char *path)
+{
+  char full[STORAGE_PATH_SIZE];
+  fullPath(full, path);
+  if (fault())
+    return -1;
+  account(STORAGE_MKDIR, 0);
+  return ::mkdir(full, 0777);
+}
+
+// FATFS allocates the whole chain when a write lands past the end of the file
+bool Storage::preallocate(int fd, size_t size)
+{
+  if ((!size) || (seek(fd, size - 1, SEEK_SET) < 0) || (write(fd, "", 1) != 1))
+    return false;
+  return seek(fd, 0, SEEK_SET) == 0;
+}
@@ -0,0 +1,151 @@
+#ifndef _STORAGEH_
+#define _STORAGEH_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <sys/types.h>
+
+#define STORAGE_PATH_SIZE 96
+#define STORAGE_MAX_FILES 8
+#define STORAGE_FAT_ENTRIES 128 // FAT32 entries per 512 byte FAT sector
+
+typedef enum
+{
+  STORAGE_OPEN,
+  STORAGE_CLOSE,
+  STORAGE_WRITE,
+  STORAGE_READ,
+  STORAGE_SEEK,
+  STORAGE_TRUNCATE,
+  STORAGE_RENAME,
+  STORAGE_REMOVE,
+  STORAGE_STAT,
+  STORAGE_MKDIR,
+  STORAGE_OPS
+} storage_op_t;
+
+typedef struct
+{
+  uint32_t ops[STORAGE_OPS]; // calls per operation
+  uint32_t clusters;         // clusters added to cluster chains
+  uint32_t fat_writes;       // FAT sectors written back for those clusters
+  uint64_t bytes;            // bytes written
+  uint64_t busy_us;          // modelled card time, 0 without a latency model
+} storage_stats_t;
+
+// Cost of a card operation. "fatSectors" is the number of FAT sectors the operation
+// writes back, see Storage::allocate().
+class StorageLatency
+{
+public:
+  virtual ~StorageLatency() {}
+  virtual uint32_t cost(storage_op_t op, size_t bytes, uint32_t fatSectors) = 0;
+  virtual uint32_t clusterSize() { return 32768; }
+};
+
+typedef struct
+{
+  uint32_t cluster_size;
+  uint32_t op_us;        // open, close, rename, remove, stat, mkdir: directory entry update
+  uint32_t write_us;     // fixed cost of a write call
+  float bytes_per_us;    // sustained data rate, MB/s
+  uint32_t unaligned_us; // extra cost of a write that is not whole sectors (read-modify-write)
+  uint32_t fat_us;       // per FAT sector written (and its mirror)
+  uint32_t stall_bytes;  // the card stalls for garbage collection after this many bytes
+  uint32_t stall_us;
+} sdcard_model_t;
+
+// Simple SPI mode SD card: fixed cost plus data rate plus FAT updates plus periodic stalls
+class SDCardLatency : public StorageLatency
+{
+public:
+  SDCardLatency(const sdcard_model_t *model = NULL);
+  uint32_t cost(storage_op_t op, size_t bytes, uint32_t fatSectors);
+  uint32_t clusterSize() { return _model.cluster_size; }
+
+  static const sdcard_model_t class4;
+  static const sdcard_model_t class10;
+
+private:
+  sdcard_model_t _model;
+  uint64_t _written;
+};
+
+// File access relative to a root directory. Operations are counted and, with a latency
+// model, the card time they would take is added up (and optionally slept).
+class Storage
+{
+public:
+  Storage(const char *root, StorageLatency *latency = NULL, bool sleep = false);
+  virtual ~Storage() {}
+
+  virtual int open(const char *path, int flags);
+  virtual ssize_t write(int fd, const void *buf, size_t len);
+  virtual ssize_t read(int fd, void *buf, size_t len);
+  virtual off_t seek(int fd, off_t offset, int whence);
+  virtual int truncate(int fd, off_t len);
+  virtual int close(int fd);
+  virtual int rename(const char *from, const char *to); // fails when "to" exists
+  virtual int remove(const char *path);
+  virtual bool exists(const char *path, size_t *size = NULL);
+  virtual int mkdir(const char *path);
+
+  // grow a file to "size" with one allocation, see sdw_prealloc()
+  bool preallocate(int fd, size_t size);
+
+  const char *root() { return _root; }
+  void setLatency(StorageLatency *latency, bool sleep = false);
+  // fault injection: power is lost during the "ops"th operation from now, a write then
+  // only gets half its data through and every later operation fails
+  void setFault(uint32_t ops) { _faultOps = ops; }
+  bool powerLost() { return _faultOps == 0; }
+  const storage_stats_t *stats() { return &_stats; }
+  void resetStats();
+
+protected:
+  void fullPath(char *out, const char *path);
+  void account(storage_op_t op, size_t bytes, uint32_t clusters = 0, uint32_t fatSectors = 0);
+  uint32_t allocate(int k, uint32_t clusters);
+  uint32_t release(int k, uint32_t clusters);
+  uint32_t touchFat(uint32_t cluster);
+  uint32_t flushFat();
+  int slot(int fd);
+  bool fault();
+
+  char _root[32];
+  StorageLatency *_latency;
+  bool _sleep;
+  storage_stats_t _stats;
+  uint32_t _faultOps; // operations left before the power loss, UINT32_MAX when disarmed
+
+  // allocated size per open file, to find writes that extend the cluster chain
+  int _fd[STORAGE_MAX_FILES];
+  uint32_t _clusters[STORAGE_MAX_FILES];
+  uint32_t _last[STORAGE_MAX_FILES]; // last cluster of the chain, UINT32_MAX when not known
+  off_t _pos[STORAGE_MAX_FILES];
+
+  // FATFS keeps one FAT sector in a window and writes it back when another sector is
+  // needed or the file is closed. Free clusters are handed out in order.
+  uint32_t _nextCluster;
+  uint32_t _fatWindow; // FAT sector in the window, UINT32_MAX when empty
+  bool _fatDirty;
+};
+
+// Host files under a directory, usually with a latency model
+class PosixStorage : public Storage
+{
+public:
+  PosixStorage(const char *root, StorageLatency *latency = NULL, bool sleep = false) : Storage(root, latency, sleep) {}
+};
+
+#ifdef ARDUINO
+// The card mounted by the SD library, reached through the VFS like any POSIX file
+class SDStorage : public Storage
+{
+public:
+  SDStorage() : Storage("/sd") {}
+};
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include <string.h>
+#include "textcache.h"
+
+TextCache::TextCache(uint32_t budget)
+{
+  memset(_entries, 0, sizeof(_entries));
+  _budget = budget;
+  _bytes = 0;
+  _clock = 0;
+  resetStats();
+}
+
+TextCache::~TextCache()
+{
+  clear();
+}
+
+void TextCache::resetStats()
+{
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void TextCache::evict(text_cache_entry_t *e)
+{
+  _bytes -= (uint32_t)e->w * e->h * 2;
+  free(e->pixels);
+  e->pixels = NULL;
+}
+
+void TextCache::clear()
+{
+  for (uint8_t k = 0; k < TEXT_CACHE_ENTRIES; k++)
+  {
+    if (_entries[k].pixels)
+      evict(&_entries[k]);
+  }
+}
+
+uint8_t TextCache::entries()
+{
+  uint8_t n = 0;
+  for (uint8_t k = 0; k < TEXT_CACHE_ENTRIES; k++)
+    n += _entries[k].pixels != NULL;
+  return n;
+}
+
+/***************************************************************************************
+** Function name:           find
+** Description:             the entry for a string drawn the same way, or NULL
+***************************************************************************************/
+const text_cache_entry_t *TextCache::find(const char *text, uint8_t font, uint8_t size, uint16_t fg, uint16_t bg)
+{
+  _stats.lookups++;
+  for (uint8_t k = 0; k < TEXT_CACHE_ENTRIES; k++)
+  {
+    text_cache_entry_t *e = &_entries[k];
+    if ((e->pixels) && (e->font == font) && (e->size == size) && (e->fg == fg) && (e->bg == bg) &&
+        (strcmp(e->text, text) == 0))
+    {
+      _stats.hits++;
+      e->used = ++_clock;
+      return e;
+    }
+  }
+  return NULL;
+}
+
+/***************************************************************************************
+** Function name:           insert
+** Description:             make an entry for "w" by "h" pixels, evicting the least recent
+***************************************************************************************/
+text_cache_entry_t *TextCache::insert(const char *text, uint8_t font, uint8_t size, uint16_t fg, uint16_t bg, uint16_t w, uint16_t h)
+{
+  uint32_t need = (uint32_t)w * h * 2;
+  if ((strlen(text) >= TEXT_CACHE_KEY) || (need > _budget) || (!need))
+  {
+    _stats.rejected++;
+    return NULL;
+  }
+
+  text_cache_entry_t *slot = NULL;
+  while (true)
+  {
+    // the free slot, or the least recent entry
+    text_cache_entry_t *oldest = NULL;
+    slot = NULL;
+    for (uint8_t k = 0; k < TEXT_CACHE_ENTRIES; k++)
+    {
+      text_cache_entry_t *e = &_entries[k];
+      if (!e->pixels)
+        slot = e;
+      else if ((!oldest) || (e->used < oldest->used))
+        oldest = e;
+    }
+    if ((slot) && (_bytes + need <= _budget))
+      break;
+    evict(oldest);
+    _stats.evictions++;
+  }
+
+  slot->pixels = (uint16_t *)malloc(need);
+  if (!slot->pixels)
+  {
+    _stats.rejected++;
+    return NULL;
+  }
+
+  strcpy(slot->text, text);
+  slot->font = font;
+  slot->size = size;
+  slot->fg = fg;
+  slot->bg = bg;
+  slot->w = w;
+  slot->h = h;
+  slot->used = ++_clock;
+  _bytes += need;
+  _stats.inserts++;
+  return slot;
+}
@@ -0,0 +1,60 @@
+#ifndef _TEXTCACHEH_
+#define _TEXTCACHEH_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TEXT_CACHE_BYTES 16384 // default budget for the pixels of all entries
+#define TEXT_CACHE_ENTRIES 16
+#define TEXT_CACHE_KEY 32      // longest string kept plus one, longer ones are drawn every time
+
+// A string rendered in RGB565, CPU byte order, rows of w pixels
+typedef struct
+{
+  char text[TEXT_CACHE_KEY];
+  uint8_t font, size;
+  uint16_t fg, bg;
+  uint16_t w, h;
+  uint16_t *pixels; // NULL for a free entry
+  uint32_t used;    // when last found, the least recent goes first
+} text_cache_entry_t;
+
+typedef struct
+{
+  uint32_t lookups;
+  uint32_t hits;
+  uint32_t inserts;
+  uint32_t evictions; // entries dropped to make room
+  uint32_t rejected;  // larger than the budget, or out of memory
+} text_cache_stats_t;
+
+// LRU cache of rendered strings. The drawing code looks a string up and on a miss
+// inserts an entry and renders into its pixels.
+class TextCache
+{
+public:
+  TextCache(uint32_t budget = TEXT_CACHE_BYTES);
+  ~TextCache();
+
+  const text_cache_entry_t *find(const char *text, uint8_t font, uint8_t size, uint16_t fg, uint16_t bg);
+  // NULL when it cannot be made to fit
+  text_cache_entry_t *insert(const char *text, uint8_t font, uint8_t size, uint16_t fg, uint16_t bg, uint16_t w, uint16_t h);
+  void clear();
+
+  uint32_t bytes() { return _bytes; } // pixels held
+  uint32_t budget() { return _budget; }
+  uint8_t entries();
+  float hitRate() { return _stats.lookups ? (float)_stats.hits / _stats.lookups : 0; }
+
+  const text_cache_stats_t *stats() { return &_stats; }
+  void resetStats();
+
+private:
+  text_cache_entry_t _entries[TEXT_CACHE_ENTRIES];
+  uint32_t _budget, _bytes, _clock;
+  text_cache_stats_t _stats;
+
+  void evict(text_cache_entry_t *e);
+};
+
+#endif
@@ -0,0 +1,569 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <rom/tjpgd.h>
+#include <freertos/semphr.h>
+#include "thumbdb.h"
+#include "exif.h"
+
+#define THUMBDB_WORK_SIZE 3800 // tjpgd work area
+
+typedef struct
+{
+  char filename[DCF_PATH_SIZE];
+  thumbdb_record_t *record; // THUMBDB_RECORD_SIZE bytes, kept between shots
+  bool used;
+} thumbdb_pending_t;
+
+// Decoder input is a memory buffer or else a file, output is sampled to the record
+typedef struct
+{
+  const uint8_t *buf;
+  size_t len;
+  size_t pos;
+  int fd;
+  uint16_t *pixels;
+  uint16_t width; // scaled image size
+  uint16_t height;
+} thumbdb_dec_t;
+
+static volatile bool ready = false;
+static uint32_t *keys = NULL; // (folder << 16) | file of every record in file order, 0 once removed
+static uint32_t keyCount = 0;
+static uint32_t lastKey = 0; // newest shot recorded, removed or not
+static uint32_t liveCount = 0;
+static uint32_t keySize = 0;
+static thumbdb_pending_t pending[THUMBDB_PENDING];
+static portMUX_TYPE pendingMux = portMUX_INITIALIZER_UNLOCKED;
+// The writer task commits records while loop() syncs and reads, the file and the keys
+// are only touched with this held. Created by thumbdb_begin(), until then every call
+// finds nothing.
+static SemaphoreHandle_t dbMutex = NULL;
+
+static inline bool thumbdb_lock()
+{
+  return (dbMutex) && (xSemaphoreTake(dbMutex, portMAX_DELAY) == pdTRUE);
+}
+
+static inline void thumbdb_unlock()
+{
+  xSemaphoreGive(dbMutex);
+}
+
+static int thumbdb_number(const char *s, int digits)
+{
+  int value = 0;
+  for (int k = 0; k < digits; k++)
+  {
+    if ((s[k] < '0') || (s[k] > '9'))
+      return -1;
+    value = value * 10 + s[k] - '0';
+  }
+  return value;
+}
+
+// "/DCIM/NNNxxxxx/xxxxNNNN.JPG" to its key
+static bool thumbdb_key(const char *filename, uint32_t *key)
+{
+  const char *name = strrchr(filename, '/');
+  if ((!name) || (name - filename < 8) || (strlen(name) != 13))
+    return false;
+  int folder = thumbdb_number(name - 8, 3);
+  int file = thumbdb_number(name + 5, 4);
+  if ((folder < DCF_FIRST_FOLDER) || (file < 1))
+    return false;
+  *key = (folder << 16) | file;
+  return true;
+}
+
+static bool thumbdb_add_key(uint32_t key)
+{
+  if (keyCount == keySize)
+  {
+    uint32_t size = keySize ? keySize * 2 : 64;
+    uint32_t *grown = (uint32_t *)realloc(keys, size * sizeof(uint32_t));
+    if (!grown)
+      return false;
+    keys = grown;
+    keySize = size;
+  }
+  keys[keyCount++] = key;
+  if (key)
+    liveCount++;
+  if (key > lastKey)
+    lastKey = key;
+  return true;
+}
+
+static bool thumbdb_create()
+{
+  thumbdb_header_t header = {THUMBDB_MAGIC, THUMBDB_WIDTH, THUMBDB_HEIGHT, THUMBDB_RECORD_SIZE};
+  uint8_t sector[THUMBDB_HEADER_SIZE];
+  memset(sector, 0, sizeof(sector));
+  memcpy(sector, &header, sizeof(header));
+
+  keyCount = 0;
+  lastKey = 0;
+  liveCount = 0;
+  int fd = open(DCF_MOUNT THUMBDB_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    return false;
+  bool ok = write(fd, sector, sizeof(sector)) == sizeof(sector);
+  return (close(fd) == 0) && ok;
+}
+
+// Load the record keys, a missing or foreign file is started over
+static bool thumbdb_load()
+{
+  thumbdb_header_t header;
+  struct stat st;
+
+  ready = false;
+  keyCount = 0;
+  lastKey = 0;
+  liveCount = 0;
+  int fd = open(DCF_MOUNT THUMBDB_PATH, O_RDWR);
+  if ((fd < 0) || (fstat(fd, &st) != 0) || (read(fd, &header, sizeof(header)) != sizeof(header)) ||
+      (header.magic != THUMBDB_MAGIC) || (header.width != THUMBDB_WIDTH) || (header.height != THUMBDB_HEIGHT) ||
+      (header.record_size != THUMBDB_RECORD_SIZE) || (st.st_size < THUMBDB_HEADER_SIZE))
+  {
+    if (fd >= 0)
+      close(fd);
+    Serial.println("Thumbs: new " THUMBDB_PATH);
+    ready = thumbdb_create();
+    return ready;
+  }
+
+  uint32_t count = (st.st_size - THUMBDB_HEADER_SIZE) / THUMBDB_RECORD_SIZE;
+  // drop a record cut short by a power loss
+  if (st.st_size != THUMBDB_HEADER_SIZE + count * THUMBDB_RECORD_SIZE)
+    ftruncate(fd, THUMBDB_HEADER_SIZE + count * THUMBDB_RECORD_SIZE);
+
+  for (uint32_t k = 0; k < count; k++)
+  {
+    uint16_t key[2];
+    if ((lseek(fd, THUMBDB_HEADER_SIZE + k * THUMBDB_RECORD_SIZE, SEEK_SET) < 0) || (read(fd, key, sizeof(key)) != sizeof(key)))
+      break;
+    if (!thumbdb_add_key((key[0] << 16) | key[1]))
+      break;
+  }
+  close(fd);
+
+  Serial.printf("Thumbs: %lu records, %lu removed\n", keyCount, keyCount - liveCount);
+  ready = true;
+  return true;
+}
+
+bool thumbdb_begin()
+{
+  if (!dbMutex)
+    dbMutex = xSemaphoreCreateMutex();
+  if (!thumbdb_lock())
+    return false;
+  bool ok = thumbdb_load();
+  thumbdb_unlock();
+  return ok;
+}
+
+static bool thumbdb_append(thumbdb_record_t *record)
+{
+  int fd = open(DCF_MOUNT THUMBDB_PATH, O_WRONLY);
+  if (fd < 0)
+    return false;
+  bool ok = (lseek(fd, THUMBDB_HEADER_SIZE + keyCount * THUMBDB_RECORD_SIZE, SEEK_SET) >= 0) &&
+            (write(fd, record, THUMBDB_RECORD_SIZE) == THUMBDB_RECORD_SIZE);
+  ok = (close(fd) == 0) && ok;
+  if (ok)
+    thumbdb_add_key((record->folder << 16) | record->file);
+  return ok;
+}
+
+// Keep a thumbnail of a shot until its file is written, nearest neighbour from the preview
+bool thumbdb_prepare(const char *filename, const uint16_t *rgb565, uint16_t width, uint16_t height, bool mirror)
+{
+  uint32_t key;
+  if (!thumbdb_key(filename, &key))
+    return false;
+
+  thumbdb_pending_t *slot = NULL;
+  portENTER_CRITICAL(&pendingMux);
+  for (int k = 0; k < THUMBDB_PENDING; k++)
+  {
+    if (!pending[k].used)
+    {
+      slot = &pending[k];
+      slot->used = true;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&pendingMux);
+  if (!slot)
+    return false;
+
+  if (!slot->record)
+    slot->record = (thumbdb_record_t *)ps_malloc(THUMBDB_RECORD_SIZE);
+  if (!slot->record)
+  {
+    slot->used = false;
+    return false;
+  }
+
+  thumbdb_record_t *record = slot->record;
+  memset(record, 0, THUMBDB_RECORD_SIZE);
+  record->folder = key >> 16;
+  record->file = key;
+  uint16_t *dst = record->pixels;
+  for (int y = 0; y < THUMBDB_HEIGHT; y++)
+  {
+    const uint16_t *row = rgb565 + (y * height / THUMBDB_HEIGHT) * width;
+    for (int x = 0; x < THUMBDB_WIDTH; x++)
+    {
+      int sx = x * width / THUMBDB_WIDTH;
+      *dst++ = row[mirror ? width - 1 - sx : sx];
+    }
+  }
+  strncpy(slot->filename, filename, DCF_PATH_SIZE - 1);
+  slot->filename[DCF_PATH_SIZE - 1] = 0;
+  return true;
+}
+
+// Called once the shot is written (or failed), from the SD writer task
+bool thumbdb_commit(const char *filename, bool ok)
+{
+  bool added = false;
+  for (int k = 0; k < THUMBDB_PENDING; k++)
+  {
+    if ((!pending[k].used) || (strcmp(pending[k].filename, filename) != 0))
+      continue;
+    // not loaded yet, the next sync picks the shot up from its Exif thumbnail
+    if (thumbdb_lock())
+    {
+      if ((ok) && (ready))
+        added = thumbdb_append(pending[k].record);
+      thumbdb_unlock();
+    }
+    pending[k].filename[0] = 0;
+    pending[k].used = false;
+  }
+  return added;
+}
+
+static UINT thumbdb_input(JDEC *jd, BYTE *buff, UINT nd)
+{
+  thumbdb_dec_t *dec = (thumbdb_dec_t *)jd->device;
+  if (dec->buf)
+  {
+    if (dec->pos + nd > dec->len)
+      nd = dec->len - dec->pos;
+    if (buff)
+      memcpy(buff, dec->buf + dec->pos, nd);
+    dec->pos += nd;
+    return nd;
+  }
+  if (buff)
+  {
+    int rb = read(dec->fd, buff, nd);
+    return (rb > 0) ? rb : 0;
+  }
+  return (lseek(dec->fd, nd, SEEK_CUR) >= 0) ? nd : 0;
+}
+
+static UINT thumbdb_output(JDEC *jd, void *bitmap, JRECT *rect)
+{
+  thumbdb_dec_t *dec = (thumbdb_dec_t *)jd->device;
+  BYTE *src = (BYTE *)bitmap;
+  for (int y = rect->top; y <= rect->bottom; y++)
+  {
+    // keep the source pixels that thumbdb_prepare() style sampling would pick
+    int dy = (y * THUMBDB_HEIGHT + dec->height - 1) / dec->height;
+    bool row = (dy < THUMBDB_HEIGHT) && (dy * dec->height / THUMBDB_HEIGHT == y);
+    for (int x = rect->left; x <= rect->right; x++, src += 3)
+    {
+      int dx = (x * THUMBDB_WIDTH + dec->width - 1) / dec->width;
+      if ((row) && (dx < THUMBDB_WIDTH) && (dx * dec->width / THUMBDB_WIDTH == x))
+        dec->pixels[dy * THUMBDB_WIDTH + dx] = ((src[0] & 0xF8) << 8) | ((src[1] & 0xFC) << 3) | (src[2] >> 3);
+    }
+  }
+  return 1;
+}
+
+static bool thumbdb_decode(thumbdb_dec_t *dec, void *work)
+{
+  JDEC jd;
+  if (jd_prepare(&jd, thumbdb_input, work, THUMBDB_WORK_SIZE, dec) != JDR_OK)
+    return false;
+
+  // smallest output that still covers the thumbnail
+  uint8_t scale = 3;
+  while ((scale) && (((jd.width >> scale) < THUMBDB_WIDTH) || ((jd.height >> scale) < THUMBDB_HEIGHT)))
+    scale--;
+  dec->width = jd.width >> scale;
+  dec->height = jd.height >> scale;
+  return jd_decomp(&jd, thumbdb_output, scale) == JDR_OK;
+}
+
+// Build a record from a file already on the card, from its Exif thumbnail when it has one
+static bool thumbdb_from_file(const char *path, thumbdb_record_t *record, void *work)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  thumbdb_dec_t dec = {NULL, 0, 0, fd, record->pixels, 0, 0};
+  uint8_t marker[6];
+  uint8_t *app1 = NULL;
+  uint32_t offset, thumbLen;
+  if ((read(fd, marker, 6) == 6) && (marker[2] == 0xFF) && (marker[3] == 0xE1))
+  {
+    size_t len = ((marker[4] << 8) | marker[5]) + 2;
+    app1 = (uint8_t *)ps_malloc(len);
+    if (app1)
+    {
+      memcpy(app1, marker + 2, 4);
+      if ((read(fd, app1 + 4, len - 4) == (int)(len - 4)) && (exif_find_thumbnail(app1, len, &offset, &thumbLen)))
+      {
+        dec.buf = app1 + offset;
+        dec.len = thumbLen;
+      }
+    }
+  }
+  if (!dec.buf)
+    lseek(fd, 0, SEEK_SET);
+
+  bool ok = thumbdb_decode(&dec, work);
+  free(app1);
+  close(fd);
+  return ok;
+}
+
+static int thumbdb_cmp(const void *a, const void *b)
+{
+  uint32_t ka = *(const uint32_t *)a, kb = *(const uint32_t *)b;
+  return (ka > kb) - (ka < kb);
+}
+
+// Zero the key of record "k", its slot stays so the records after it keep their place
+static bool thumbdb_erase(uint32_t k)
+{
+  uint16_t key[2] = {0, 0};
+  int fd = open(DCF_MOUNT THUMBDB_PATH, O_WRONLY);
+  if (fd < 0)
+    return false;
+  bool ok = (lseek(fd, THUMBDB_HEADER_SIZE + k * THUMBDB_RECORD_SIZE, SEEK_SET) >= 0) && (write(fd, key, sizeof(key)) == sizeof(key));
+  ok = (close(fd) == 0) && ok;
+  if (ok)
+  {
+    keys[k] = 0;
+    liveCount--;
+  }
+  return ok;
+}
+
+static int32_t thumbdb_index(uint32_t key)
+{
+  for (int32_t k = keyCount - 1; k >= 0; k--)
+  {
+    if (keys[k] == key)
+      return k;
+  }
+  return -1;
+}
+
+// Every DCF file of this camera on the card, sorted. False when the list is not
+// complete, then nothing can be told missing.
+static bool thumbdb_list(uint32_t **list, uint32_t *count)
+{
+  uint32_t *found = NULL;
+  uint32_t foundCount = 0, foundSize = 0;
+  bool complete = true;
+  char path[64];
+
+  DIR *root = opendir(DCF_MOUNT DCF_ROOT);
+  if (!root)
+    return false;
+  struct dirent *entry;
+  while ((complete) && ((entry = readdir(root)) != NULL))
+  {
+    // only folders and files named by this camera
+    int folder = (strlen(entry->d_name) == 8) ? thumbdb_number(entry->d_name, 3) : -1;
+    if ((folder < DCF_FIRST_FOLDER) || (strcasecmp(entry->d_name + 3, DCF_FOLDER_NAME) != 0))
+      continue;
+    snprintf(path, sizeof(path), DCF_MOUNT DCF_ROOT "/%s", entry->d_name);
+    DIR *dir = opendir(path);
+    if (!dir)
+    {
+      complete = false;
+      break;
+    }
+    struct dirent *fileEntry;
+    while ((fileEntry = readdir(dir)) != NULL)
+    {
+      const char *name = fileEntry->d_name;
+      int file = (strlen(name) == 12) ? thumbdb_number(name + 4, 4) : -1;
+      if ((file < 1) || (strncasecmp(name, DCF_FILE_NAME, 4) != 0) || (strcasecmp(name + 8, ".JPG") != 0))
+        continue;
+      if (foundCount == foundSize)
+      {
+        foundSize = foundSize ? foundSize * 2 : 32;
+        uint32_t *grown = (uint32_t *)realloc(found, foundSize * sizeof(uint32_t));
+        if (!grown)
+        {
+          complete = false;
+          break;
+        }
+        found = grown;
+      }
+      found[foundCount++] = (folder << 16) | file;
+    }
+    closedir(dir);
+  }
+  closedir(root);
+
+  if (foundCount)
+    qsort(found, foundCount, sizeof(uint32_t), thumbdb_cmp);
+  *list = found;
+  *count = foundCount;
+  return complete;
+}
+
+// Catch up with the card: drop the records of files that were deleted or moved, then
+// add every DCF file newer than the last record. Shots the writer could not record are
+// found here, a card renumbered from scratch (newest record past the current DCF file)
+// starts the database over.
+static uint32_t thumbdb_sync_locked()
+{
+  uint32_t last = lastKey;
+  uint32_t current = ((uint32_t)dcf_folder() << 16) | dcf_file();
+  if ((current) && (last > current))
+  {
+    thumbdb_create();
+    last = 0;
+  }
+
+  uint32_t *found, foundCount;
+  bool complete = thumbdb_list(&found, &foundCount);
+
+  uint32_t removed = 0;
+  for (uint32_t k = 0; (complete) && (k < keyCount); k++)
+  {
+    if ((keys[k]) && (!bsearch(&keys[k], found, foundCount, sizeof(uint32_t), thumbdb_cmp)) && (thumbdb_erase(k)))
+      removed++;
+  }
+
+  // the list is sorted, the new files are at its end in shot order
+  uint32_t first = foundCount;
+  while ((first) && (found[first - 1] > last))
+    first--;
+
+  uint32_t added = 0;
+  if (first < foundCount)
+  {
+    char path[64];
+    thumbdb_record_t *record = (thumbdb_record_t *)ps_malloc(THUMBDB_RECORD_SIZE);
+    void *work = malloc(THUMBDB_WORK_SIZE);
+    for (uint32_t k = first; (record) && (work) && (k < foundCount); k++)
+    {
+      snprintf(path, sizeof(path), DCF_MOUNT DCF_ROOT "/%03lu" DCF_FOLDER_NAME "/" DCF_FILE_NAME "%04lu.JPG", found[k] >> 16, found[k] & 0xFFFF);
+      memset(record, 0, THUMBDB_RECORD_SIZE);
+      record->folder = found[k] >> 16;
+      record->file = found[k];
+      if ((thumbdb_from_file(path, record, work)) && (thumbdb_append(record)))
+        added++;
+    }
+    free(work);
+    free(record);
+  }
+  free(found);
+
+  if ((added) || (removed))
+    Serial.printf("Thumbs: %lu added, %lu removed, %lu records\n", added, removed, keyCount);
+  return added;
+}
+
+uint32_t thumbdb_sync()
+{
+  if (!thumbdb_lock())
+    return 0;
+  uint32_t added = ready ? thumbdb_sync_locked() : 0;
+  thumbdb_unlock();
+  return added;
+}
+
+// Drop the record of a shot that was moved or deleted
+bool thumbdb_remove(const char *filename)
+{
+  uint32_t key;
+  if (!thumbdb_key(filename, &key))
+    return false;
+  if (!thumbdb_lock())
+    return false;
+  int32_t k = ready ? thumbdb_index(key) : -1;
+  bool ok = (k >= 0) && (thumbdb_erase(k));
+  thumbdb_unlock();
+  return ok;
+}
+
+// Records in the file, removed ones included
+uint32_t thumbdb_count()
+{
+  if (!thumbdb_lock())
+    return 0;
+  uint32_t count = keyCount;
+  thumbdb_unlock();
+  return count;
+}
+
+uint32_t thumbdb_live()
+{
+  if (!thumbdb_lock())
+    return 0;
+  uint32_t count = liveCount;
+  thumbdb_unlock();
+  return count;
+}
+
+// First record of the span that holds the newest "count" live records
+uint32_t thumbdb_newest(uint32_t count)
+{
+  if (!thumbdb_lock())
+    return 0;
+  uint32_t k = keyCount;
+  while ((k) && (count))
+  {
+    if (keys[--k])
+      count--;
+  }
+  thumbdb_unlock();
+  return k;
+}
+
+int32_t thumbdb_find(uint16_t folder, uint16_t file)
+{
+  if (!thumbdb_lock())
+    return -1;
+  int32_t k = thumbdb_index(((uint32_t)folder << 16) | file);
+  thumbdb_unlock();
+  return k;
+}
+
+// Read "count" consecutive records into "buf" (count * THUMBDB_RECORD_SIZE bytes) with
+// one read, returns the number of records read
+uint32_t thumbdb_read(uint32_t first, uint32_t count, uint8_t *buf)
+{
+  if (!thumbdb_lock())
+    return 0;
+  if (first >= keyCount)
+    count = 0;
+  else if (first + count > keyCount)
+    count = keyCount - first;
+
+  int fd = count ? open(DCF_MOUNT THUMBDB_PATH, O_RDONLY) : -1;
+  int rb = -1;
+  if ((fd >= 0) && (lseek(fd, THUMBDB_HEADER_SIZE + first * THUMBDB_RECORD_SIZE, SEEK_SET) >= 0))
+    rb = read(fd, buf, count * THUMBDB_RECORD_SIZE);
+  if (fd >= 0)
+    close(fd);
+  thumbdb_unlock();
+  return (rb > 0) ? rb / THUMBDB_RECORD_SIZE : 0;
+}
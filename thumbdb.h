@@ -0,0 +1,46 @@
+#ifndef _THUMBDBH_
+#define _THUMBDBH_
+
+#include <Arduino.h>
+#include "dcf.h"
+
+// One append-only file of fixed size thumbnail records. Records are whole sectors so
+// a gallery page is a single aligned sequential read. The record of a shot that is
+// moved or deleted keeps its slot with a zero key. Safe to call from the SD writer
+// task and loop() at the same time.
+#define THUMBDB_PATH DCF_ROOT "/THUMBS.DB"
+#define THUMBDB_MAGIC 0x31424454 // "TDB1"
+#define THUMBDB_WIDTH 80
+#define THUMBDB_HEIGHT 60
+#define THUMBDB_HEADER_SIZE 512
+#define THUMBDB_RECORD_SIZE 9728 // 8 byte key plus 80x60 RGB565, padded to 19 sectors
+#define THUMBDB_PENDING 4        // shots waiting for their file to be written
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t width;
+  uint16_t height;
+  uint32_t record_size;
+} thumbdb_header_t;
+
+typedef struct
+{
+  uint16_t folder; // DCF folder and file number of the shot, both 0 once removed
+  uint16_t file;
+  uint32_t reserved;
+  uint16_t pixels[THUMBDB_WIDTH * THUMBDB_HEIGHT]; // native byte order, like the preview
+} thumbdb_record_t;
+
+bool thumbdb_begin();
+bool thumbdb_prepare(const char *filename, const uint16_t *rgb565, uint16_t width, uint16_t height, bool mirror);
+bool thumbdb_commit(const char *filename, bool ok);
+uint32_t thumbdb_sync();
+bool thumbdb_remove(const char *filename);
+uint32_t thumbdb_count();
+uint32_t thumbdb_live();
+uint32_t thumbdb_newest(uint32_t count);
+int32_t thumbdb_find(uint16_t folder, uint16_t file);
+uint32_t thumbdb_read(uint32_t first, uint32_t count, uint8_t *buf);
+
+#endif
@@ -0,0 +1,381 @@
+#include "ui.h"
+#include "Sprite.h"
+
+static ST7789 *tft = NULL;
+static TFT_eSprite *canvas = NULL;
+static ui_widget_t widgets[UI_MAX_WIDGETS];
+static int widgetCount = 0;
+static ui_rect_t dirty[UI_MAX_DIRTY];
+static int dirtyCount = 0;
+static ui_stats_t stats;
+
+static int32_t rect_area(const ui_rect_t &r)
+{
+  return (int32_t)r.w * r.h;
+}
+
+static bool rect_intersects(const ui_rect_t &a, const ui_rect_t &b)
+{
+  return (a.x < b.x + b.w) && (b.x < a.x + a.w) && (a.y < b.y + b.h) && (b.y < a.y + a.h);
+}
+
+static bool rect_contains(const ui_rect_t &outer, const ui_rect_t &inner)
+{
+  return (inner.x >= outer.x) && (inner.y >= outer.y) && (inner.x + inner.w <= outer.x + outer.w) &&
+         (inner.y + inner.h <= outer.y + outer.h);
+}
+
+static ui_rect_t rect_union(const ui_rect_t &a, const ui_rect_t &b)
+{
+  ui_rect_t u;
+  u.x = min(a.x, b.x);
+  u.y = min(a.y, b.y);
+  u.w = ((a.x + a.w > b.x + b.w) ? a.x + a.w : b.x + b.w) - u.x;
+  u.h = ((a.y + a.h > b.y + b.h) ? a.y + a.h : b.y + b.h) - u.y;
+  return u;
+}
+
+// One window for the union is cheaper than a window each when the pixels it adds
+// cost less than the window it saves
+static bool rect_merge_pays(const ui_rect_t &a, const ui_rect_t &b)
+{
+  ui_rect_t u = rect_union(a, b);
+  return UI_WINDOW_BYTES + 2 * rect_area(u) <= 2 * UI_WINDOW_BYTES + 2 * (rect_area(a) + rect_area(b));
+}
+
+static bool valid(int id)
+{
+  return (id >= 0) && (id < widgetCount);
+}
+
+/***************************************************************************************
+** Function name:           ui_mark
+** Description:             add a rectangle to the dirty list, merging where it pays
+***************************************************************************************/
+static void ui_mark(ui_rect_t r)
+{
+  if (!tft)
+    return;
+
+  // clip to the screen
+  if (r.x < 0)
+  {
+    r.w += r.x;
+    r.x = 0;
+  }
+  if (r.y < 0)
+  {
+    r.h += r.y;
+    r.y = 0;
+  }
+  r.w = min((int32_t)r.w, (int32_t)tft->width() - r.x);
+  r.h = min((int32_t)r.h, (int32_t)tft->height() - r.y);
+  if ((r.w < 1) || (r.h < 1))
+    return;
+
+  // a grown rectangle can now pay to merge with ones it skipped, so start over
+  bool merged = true;
+  while (merged)
+  {
+    merged = false;
+    for (int k = 0; k < dirtyCount; k++)
+    {
+      if (rect_contains(dirty[k], r))
+        return;
+      if (rect_merge_pays(dirty[k], r))
+      {
+        r = rect_union(dirty[k], r);
+        dirty[k] = dirty[--dirtyCount];
+        merged = true;
+        break;
+      }
+    }
+  }
+
+  if (dirtyCount < UI_MAX_DIRTY)
+  {
+    dirty[dirtyCount++] = r;
+    return;
+  }
+
+  // list full, grow the rectangle that grows least
+  int best = 0;
+  int32_t bestGrowth = INT32_MAX;
+  for (int k = 0; k < dirtyCount; k++)
+  {
+    int32_t growth = rect_area(rect_union(dirty[k], r)) - rect_area(dirty[k]);
+    if (growth < bestGrowth)
+    {
+      best = k;
+      bestGrowth = growth;
+    }
+  }
+  dirty[best] = rect_union(dirty[best], r);
+}
+
+bool ui_begin(ST7789 *display)
+{
+  tft = display;
+  widgetCount = 0;
+  dirtyCount = 0;
+  memset(&stats, 0, sizeof(stats));
+  if (!canvas)
+    canvas = new TFT_eSprite(tft);
+  if (canvas)
+    canvas->setTextCache(tft->getTextCache());
+  return canvas != NULL;
+}
+
+int ui_add(ui_type_t type, const char *name, int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  if (widgetCount >= UI_MAX_WIDGETS)
+    return -1;
+
+  ui_widget_t *wd = &widgets[widgetCount];
+  memset(wd, 0, sizeof(*wd));
+  wd->name = name;
+  wd->type = type;
+  wd->box.x = x;
+  wd->box.y = y;
+  wd->box.w = w;
+  wd->box.h = h;
+  wd->visible = true;
+  wd->fg = TFT_WHITE;
+  wd->bg = UI_BACKGROUND;
+  wd->font = 1;
+  wd->size = 1;
+  wd->datum = TL_DATUM;
+  ui_mark(wd->box);
+  return widgetCount++;
+}
+
+int ui_find(const char *name)
+{
+  for (int k = 0; k < widgetCount; k++)
+  {
+    if (strcmp(widgets[k].name, name) == 0)
+      return k;
+  }
+  return -1;
+}
+
+// Count an update and mark the widget dirty if it changed something on screen
+static void ui_changed(int id, bool changed)
+{
+  stats.updates++;
+  if (!changed)
+  {
+    stats.unchanged++;
+    return;
+  }
+  if (widgets[id].visible)
+    ui_mark(widgets[id].box);
+}
+
+void ui_set_text(int id, const char *text)
+{
+  if (!valid(id))
+    return;
+  bool changed = strncmp(widgets[id].text, text, UI_TEXT_SIZE - 1) != 0;
+  if (changed)
+  {
+    strncpy(widgets[id].text, text, UI_TEXT_SIZE - 1);
+    widgets[id].text[UI_TEXT_SIZE - 1] = 0;
+  }
+  ui_changed(id, changed);
+}
+
+void ui_set_colors(int id, uint16_t fg, uint16_t bg)
+{
+  if (!valid(id))
+    return;
+  bool changed = (widgets[id].fg != fg) || (widgets[id].bg != bg);
+  widgets[id].fg = fg;
+  widgets[id].bg = bg;
+  ui_changed(id, changed);
+}
+
+void ui_set_font(int id, uint8_t font, uint8_t size, uint8_t datum)
+{
+  if (!valid(id))
+    return;
+  bool changed = (widgets[id].font != font) || (widgets[id].size != size) || (widgets[id].datum != datum);
+  widgets[id].font = font;
+  widgets[id].size = size;
+  widgets[id].datum = datum;
+  ui_changed(id, changed);
+}
+
+// The pixels are read at the next flush, they are always taken as changed
+void ui_set_image(int id, const uint16_t *pixels)
+{
+  if (!valid(id))
+    return;
+  widgets[id].pixels = pixels;
+  ui_changed(id, true);
+}
+
+void ui_show(int id, bool visible)
+{
+  if ((!valid(id)) || (widgets[id].visible == visible))
+    return;
+  widgets[id].visible = visible;
+  // what was under the widget shows again
+  ui_mark(widgets[id].box);
+}
+
+void ui_invalidate(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  ui_rect_t r = {x, y, w, h};
+  ui_mark(r);
+}
+
+/***************************************************************************************
+** Function name:           ui_draw_widget
+** Description:             draw a widget into the canvas, which sits at "band"
+***************************************************************************************/
+static void ui_draw_widget(const ui_widget_t *wd, const ui_rect_t &band)
+{
+  int32_t x = wd->box.x - band.x, y = wd->box.y - band.y;
+
+  switch (wd->type)
+  {
+  case UI_FILL:
+    canvas->fillRect(x, y, wd->box.w, wd->box.h, wd->bg);
+    break;
+  case UI_TEXT:
+  {
+    canvas->fillRect(x, y, wd->box.w, wd->box.h, wd->bg);
+    canvas->setTextFont(wd->font);
+    canvas->setTextSize(wd->size);
+    canvas->setTextColor(wd->fg, wd->bg);
+    canvas->setTextDatum(wd->datum);
+
+    // text stays inside its box, anything past the right edge is dropped
+    char text[UI_TEXT_SIZE];
+    strcpy(text, wd->text);
+    size_t len = strlen(text);
+    while ((len > 0) && (canvas->textWidth(text) > wd->box.w))
+      text[--len] = 0;
+
+    if (wd->datum == TC_DATUM)
+      x += wd->box.w / 2;
+    else if (wd->datum == TR_DATUM)
+      x += wd->box.w;
+    canvas->drawString(text, x, y);
+    break;
+  }
+  case UI_IMAGE:
+    if (wd->pixels)
+      canvas->pushImage(x, y, wd->box.w, wd->box.h, wd->pixels);
+    else
+      canvas->fillRect(x, y, wd->box.w, wd->box.h, wd->bg);
+    break;
+  }
+}
+
+/***************************************************************************************
+** Function name:           ui_direct
+** Description:             send an image widget as it is when nothing is drawn over it
+***************************************************************************************/
+// Saves composing a copy of a large image, at the cost of sending all of it
+static bool ui_direct(const ui_rect_t &r)
+{
+  int top = -1;
+  for (int k = widgetCount - 1; k >= 0; k--)
+  {
+    if ((widgets[k].visible) && (rect_intersects(widgets[k].box, r)))
+    {
+      top = k;
+      break;
+    }
+  }
+  if ((top < 0) || (widgets[top].type != UI_IMAGE) || (!widgets[top].pixels) || (!rect_contains(widgets[top].box, r)))
+    return false;
+  // the whole image is sent, so it must not cover later widgets anywhere
+  for (int k = top + 1; k < widgetCount; k++)
+  {
+    if ((widgets[k].visible) && (rect_intersects(widgets[k].box, widgets[top].box)))
+      return false;
+  }
+
+  const ui_widget_t *wd = &widgets[top];
+  bool swap = tft->getSwapBytes();
+  tft->setSwapBytes(true);
+  tft->pushImageDMA(wd->box.x, wd->box.y, wd->box.w, wd->box.h, wd->pixels);
+  tft->setSwapBytes(swap);
+
+  stats.direct++;
+  stats.windows++;
+  stats.last_bytes += UI_WINDOW_BYTES + 2 * rect_area(wd->box);
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           ui_flush
+** Description:             redraw the dirty regions, returns the bytes sent
+***************************************************************************************/
+uint32_t ui_flush()
+{
+  if ((!tft) || (!dirtyCount))
+    return 0;
+
+  stats.flushes++;
+  stats.last_bytes = 0;
+
+  for (int d = 0; d < dirtyCount; d++)
+  {
+    const ui_rect_t &r = dirty[d];
+    stats.regions++;
+    if (ui_direct(r))
+      continue;
+
+    // regions too big for the canvas are composed in bands of whole rows
+    int16_t rows = min((int)r.h, (int)(UI_BAND_PIXELS / r.w));
+    if (rows < 1)
+      rows = 1;
+    for (int16_t y = r.y; y < r.y + r.h; y += rows)
+    {
+      ui_rect_t band = {r.x, y, r.w, (int16_t)min((int)rows, r.y + r.h - y)};
+      // out of memory, what is not drawn yet stays dirty for the next flush
+      if (!canvas->createSprite(band.w, band.h))
+      {
+        dirty[d].h = r.y + r.h - y;
+        dirty[d].y = y;
+        dirtyCount -= d;
+        memmove(dirty, dirty + d, dirtyCount * sizeof(ui_rect_t));
+        stats.spi_bytes += stats.last_bytes;
+        return stats.last_bytes;
+      }
+
+      canvas->fillSprite(UI_BACKGROUND);
+      for (int k = 0; k < widgetCount; k++)
+      {
+        if ((widgets[k].visible) && (rect_intersects(widgets[k].box, band)))
+          ui_draw_widget(&widgets[k], band);
+      }
+      canvas->pushSpriteDMA(band.x, band.y);
+
+      stats.windows++;
+      stats.last_bytes += UI_WINDOW_BYTES + 2 * rect_area(band);
+    }
+  }
+
+  dirtyCount = 0;
+  stats.spi_bytes += stats.last_bytes;
+  return stats.last_bytes;
+}
+
+const ui_stats_t *ui_get_stats()
+{
+  return &stats;
+}
+
+void ui_print_stats()
+{
+  uint32_t flushes = stats.flushes ? stats.flushes : 1;
+  Serial.printf("UI: %lu flushes, %lu regions, %lu windows, %lu direct, %lu of %lu updates unchanged\n",
+                stats.flushes, stats.regions, stats.windows, stats.direct, stats.unchanged, stats.updates);
+  Serial.printf("UI: %lluKB sent, %luB per flush, last %luB\n",
+                stats.spi_bytes / 1024, (uint32_t)(stats.spi_bytes / flushes), stats.last_bytes);
+}
@@ -0,0 +1,66 @@
+#ifndef _UIH_
+#define _UIH_
+
+#include <Arduino.h>
+#include "ST7789.h"
+
+// Retained UI: widgets keep their state, changing one marks its box dirty and ui_flush()
+// redraws only the dirty regions, each composed off screen and sent in one window.
+// Later widgets are drawn over earlier ones. Only call from loop().
+#define UI_MAX_WIDGETS 8
+#define UI_MAX_DIRTY 8
+#define UI_TEXT_SIZE 64
+#define UI_BAND_PIXELS (240 * 32) // compose buffer, taller regions go in bands
+#define UI_WINDOW_BYTES 11        // CASET, PASET, RAMWR and their parameters
+#define UI_BACKGROUND TFT_BLACK   // where no widget is
+
+typedef enum
+{
+  UI_FILL,  // bg colour
+  UI_TEXT,  // text on bg colour
+  UI_IMAGE  // RGB565 pixels in native byte order, the size of the box
+} ui_type_t;
+
+typedef struct
+{
+  int16_t x, y, w, h;
+} ui_rect_t;
+
+typedef struct
+{
+  const char *name;
+  ui_type_t type;
+  ui_rect_t box;
+  bool visible;
+  uint16_t fg, bg;
+  uint8_t font, size, datum; // datum: TL_DATUM, TC_DATUM or TR_DATUM
+  char text[UI_TEXT_SIZE];
+  const uint16_t *pixels;
+} ui_widget_t;
+
+typedef struct
+{
+  uint32_t flushes;
+  uint32_t updates;    // widget changes
+  uint32_t unchanged;  // updates that changed nothing and were dropped
+  uint32_t regions;    // merged dirty regions drawn
+  uint32_t windows;    // address windows opened
+  uint32_t direct;     // regions sent straight from an image
+  uint64_t spi_bytes;  // commands and pixels
+  uint32_t last_bytes; // of the last flush
+} ui_stats_t;
+
+bool ui_begin(ST7789 *tft);
+int ui_add(ui_type_t type, const char *name, int16_t x, int16_t y, int16_t w, int16_t h);
+int ui_find(const char *name);
+void ui_set_text(int id, const char *text);
+void ui_set_colors(int id, uint16_t fg, uint16_t bg);
+void ui_set_font(int id, uint8_t font, uint8_t size, uint8_t datum = TL_DATUM);
+void ui_set_image(int id, const uint16_t *pixels);
+void ui_show(int id, bool visible);
+void ui_invalidate(int16_t x, int16_t y, int16_t w, int16_t h);
+uint32_t ui_flush();
+const ui_stats_t *ui_get_stats();
+void ui_print_stats();
+
+#endif